@@ -0,0 +1,118 @@
+#include "atomicfile.h"
+
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "exception.h"
+
+/**
+ * Constructor AtomicFile
+ *
+ * Crea (o svuota) il file temporaneo per il file con nome filename.
+ */
+AtomicFile::AtomicFile(const std::string& filename) :
+    filename(filename), tmpname(filename + ".tmp")
+{
+  fd = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw file_error("In AtomicFile::AtomicFile");
+} // End constructor
+
+/**
+ * Destructor ~AtomicFile
+ *
+ * Se il metodo commit non e` stato invocato chiude ed elimina il file
+ * temporaneo.
+ */
+AtomicFile::~AtomicFile() {
+  if (fd >= 0) {
+    ::close(fd);
+    std::remove(tmpname.c_str());
+  }
+}
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method write
+ *
+ * Aggiunge al file i size bytes passati.
+ */
+void AtomicFile::write(const void* data, std::size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  std::size_t done = 0;
+  while (done < size) {
+    ssize_t n = ::write(fd, bytes + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) throw file_error("In AtomicFile::write");
+    done += n;
+  }
+  return;
+} // End method write
+
+/**
+ * Method writeAt
+ *
+ * Sovrascrive i size bytes del file a partire dalla posizione pos (gia`
+ * scritti), ad esempio per completare un header, senza spostare la posizione
+ * da cui il metodo write continua a scrivere.
+ */
+void AtomicFile::writeAt(std::size_t pos, const void* data, std::size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  std::size_t done = 0;
+  while (done < size) {
+    ssize_t n = ::pwrite(fd, bytes + done, size - done, pos + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) throw file_error("In AtomicFile::writeAt");
+    done += n;
+  }
+  return;
+} // End method writeAt
+
+/**
+ * Method commit
+ *
+ * Sincronizza su disco il file temporaneo, lo chiude e lo rinomina nel file
+ * di destinazione, sincronizzando poi la directory (vedere syncDirectory).
+ */
+void AtomicFile::commit() {
+  if (::fsync(fd) != 0) throw file_error("In AtomicFile::commit");
+  const int result = ::close(fd);
+  fd = -1;
+  if (result != 0) {
+    std::remove(tmpname.c_str());
+    throw file_error("In AtomicFile::commit");
+  }
+  if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+    std::remove(tmpname.c_str());
+    throw file_error("In AtomicFile::commit");
+  }
+  syncDirectory(filename);
+  return;
+} // End method commit
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Method syncDirectory
+ *
+ * Sincronizza su disco la directory che contiene il file filename, in modo
+ * che la sua ultima rinomina sopravviva a un crash del sistema.
+ */
+void AtomicFile::syncDirectory(const std::string& filename) {
+  const std::string::size_type slash = filename.rfind('/');
+  std::string dir = ".";
+  if (slash == 0) dir = "/";
+  else if (slash != std::string::npos) dir = filename.substr(0, slash);
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) throw file_error("In AtomicFile::syncDirectory");
+  const int result = ::fsync(fd);
+  ::close(fd);
+  if (result != 0) throw file_error("In AtomicFile::syncDirectory");
+  return;
+} // End method syncDirectory
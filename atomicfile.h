@@ -0,0 +1,42 @@
+#ifndef ATOMICFILE_H_
+#define ATOMICFILE_H_
+
+#include <string>
+#include <cstddef>
+
+/**
+ * Class AtomicFile
+ *
+ * File binario scritto in modo atomico: i bytes vengono scritti in un file
+ * temporaneo (con il nome del file seguito da .tmp) che, con il metodo commit,
+ * viene sincronizzato su disco (fsync), rinominato nel file di destinazione e
+ * infine viene sincronizzata anche la directory che lo contiene. Dopo un crash
+ * (anche del sistema) il file di destinazione e` quindi quello precedente
+ * oppure quello nuovo e completo, mai uno troncato.
+ * Se l'oggetto viene distrutto senza commit (ad esempio per un'eccezione) il
+ * file temporaneo viene eliminato e il file di destinazione non cambia. Gli
+ * errori vengono segnalati con l'eccezione file_error.
+ * Utilizzato per i checkpoint, le reti e i datasets in formato binario e le
+ * cache delle attivazioni.
+ */
+class AtomicFile
+{
+  public:
+    AtomicFile ( const std::string& filename );
+    virtual ~AtomicFile ( );
+
+    void write ( const void* data, std::size_t size );
+    void writeAt ( std::size_t pos, const void* data, std::size_t size );
+    void commit ( );
+
+  private:
+    std::string filename, tmpname;
+    int fd;
+
+    AtomicFile ( const AtomicFile& );
+    AtomicFile& operator= ( const AtomicFile& );
+    static void syncDirectory ( const std::string& filename );
+
+}; // End class AtomicFile
+
+#endif /* ATOMICFILE_H_ */
@@ -1,6 +1,7 @@
 #include "backpropagation.h"
 
 #include <cassert>
+#include <stdexcept>
 #include "global.h"
 #include "neuralnetwork.h"
 
@@ -100,18 +101,53 @@ real BackPropagation::getRegularizationRate() const {
   return lambda;
 } // End method getRegularizationRate
 
+/**
+ * Method getMomentum
+ *
+ * Copia nel vettore passato il contenuto della tabella del momentum (l'ultima
+ * modifica applicata ai pesi di ogni unita`), in ordine di strato e di unita`.
+ * Insieme ai pesi della rete costituisce lo stato dell'algoritmo.
+ */
+void BackPropagation::getMomentum(std::vector<real>& momentum) const {
+  momentum.clear();
+  if (momentumtable == NULL) return;
+  for (uint i = 0; i < momentumtable->size(); ++i)
+    momentum.insert(momentum.end(), momentumtable->at(i)->begin(),
+        momentumtable->at(i)->end());
+  return;
+} // End method getMomentum
+
+/**
+ * Method setMomentum
+ *
+ * Imposta la tabella del momentum con i valori passati (nello stesso ordine
+ * del metodo getMomentum). Dev'essere gia` stato impostato il modello.
+ */
+void BackPropagation::setMomentum(const std::vector<real>& momentum) {
+  assert( momentumtable != NULL );
+  uint k = 0;
+  for (uint i = 0; i < momentumtable->size(); ++i)
+    for (uint j = 0; j < momentumtable->at(i)->size(); ++j) {
+      if (k >= momentum.size())
+        throw std::out_of_range("In BackPropagation::setMomentum");
+      momentumtable->at(i)->at(j) = momentum[k++];
+    }
+  if (k != momentum.size())
+    throw std::out_of_range("In BackPropagation::setMomentum");
+  return;
+} // End method setMomentum
+
 /**
  * Method compute
  *
  * Applica un passo dell'algoritmo back-propagation alla rete neurale.
  * I parametri passati sono i seguenti:
- *   - inputs : vettore con gli inputs dell'istanza di training
- *   - desiredResponse : risposta desiderata per gli inputs passati
+ *   - inputs : inputs dell'istanza di training (uno per ogni input della rete)
+ *   - desiredResponse : risposta desiderata per gli inputs passati (uno per
+ *     ogni output della rete)
  */
-void BackPropagation::compute(const std::vector<real>& inputs,
-    const std::vector<real>& desiredResponse) {
-  assert(inputs.size() == neuralnetwork->getInputs().size());
-  assert(desiredResponse.size() == neuralnetwork->getNumberOfOutputs());
+void BackPropagation::compute(const real* inputs,
+    const real* desiredResponse) {
   // Forward phase
   neuralnetwork->setInputs(inputs);
   neuralnetwork->compute();
@@ -39,8 +39,9 @@ class BackPropagation
     real getLearningRate ( ) const;
     real getMomentumRate ( ) const;
     real getRegularizationRate ( ) const;
-    void compute ( const std::vector<real>& inputs,
-        const std::vector<real>& desiredResponse );
+    void getMomentum ( std::vector<real>& momentum ) const;
+    void setMomentum ( const std::vector<real>& momentum );
+    void compute ( const real* inputs, const real* desiredResponse );
 
   private:
     NeuralNetwork* neuralnetwork;
@@ -0,0 +1,204 @@
+#include "checkpoint.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "global.h"
+#include "atomicfile.h"
+#include "exception.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+const char Checkpoint::MAGIC[8] = { 'N', 'N', 'C', 'H', 'K', 'P', 'T', '\0' };
+const uint Checkpoint::VERSION = 6;
+
+// =================
+// RELATED FUNCTIONS
+// =================
+
+/**
+ * Function checksum
+ *
+ * Restituisce il checksum (FNV-1a a 64 bit) dei bytes passati.
+ */
+static unsigned long long checksum(const std::string& data) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (std::string::size_type i = 0; i < data.size(); ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+} // End function checksum
+
+/**
+ * Function put
+ *
+ * Appende al buffer la rappresentazione binaria del valore passato.
+ */
+template <class T>
+static void put(std::string& buffer, const T& value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+} // End function put
+
+/**
+ * Function put
+ *
+ * Appende al buffer la dimensione e gli elementi del vettore passato.
+ */
+template <class T>
+static void put(std::string& buffer, const std::vector<T>& values) {
+  put(buffer, (unsigned long long) values.size());
+  if (!values.empty())
+    buffer.append(reinterpret_cast<const char*>(&values[0]),
+        values.size() * sizeof(T));
+} // End function put
+
+/**
+ * Function get
+ *
+ * Legge dal buffer, a partire dalla posizione pos (che viene aggiornata), un
+ * valore del tipo richiesto.
+ */
+template <class T>
+static void get(const std::string& buffer, std::size_t& pos, T& value) {
+  if (pos + sizeof(T) > buffer.size()) throw read_error("In Checkpoint::load");
+  std::memcpy(&value, buffer.data() + pos, sizeof(T));
+  pos += sizeof(T);
+} // End function get
+
+/**
+ * Function get
+ *
+ * Legge dal buffer, a partire dalla posizione pos (che viene aggiornata), un
+ * vettore scritto con la funzione put.
+ */
+template <class T>
+static void get(const std::string& buffer, std::size_t& pos,
+    std::vector<T>& values) {
+  unsigned long long size;
+  get(buffer, pos, size);
+  if (size > (buffer.size() - pos) / sizeof(T))
+    throw read_error("In Checkpoint::load");
+  values.resize(size);
+  if (size > 0) std::memcpy(&values[0], buffer.data() + pos, size * sizeof(T));
+  pos += size * sizeof(T);
+} // End function get
+
+/**
+ * Constructor Checkpoint
+ *
+ * Costruisce un checkpoint vuoto (all'inizio del primo fold).
+ */
+Checkpoint::Checkpoint() :
+    rseed(0), rcount(0),
+    fold(0), epoch(0),
+    stopped(false)
+{
+  for (int i = 0; i < 4; ++i) rstate[i] = 0;
+} // End constructor
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method save
+ *
+ * Scrive il checkpoint nel file con nome passato, sovrascrivendolo in modo
+ * atomico (vedere la classe AtomicFile).
+ */
+void Checkpoint::save(const std::string& filename) const {
+  std::string buffer(MAGIC, sizeof(MAGIC));
+  put(buffer, VERSION);
+  put(buffer, rseed);
+  for (int i = 0; i < 4; ++i) put(buffer, rstate[i]);
+  put(buffer, rcount);
+  put(buffer, fold);
+  put(buffer, epoch);
+  put(buffer, (uint) stopped);
+  put(buffer, weights);
+  put(buffer, bestweights);
+  put(buffer, momentum);
+  put(buffer, av);
+  put(buffer, trav);
+  put(buffer, vasample);
+  put(buffer, vastrata);
+  put(buffer, results);
+  put(buffer, totals);
+  put(buffer, checksum(buffer));
+  // scrive il file (vedere la classe AtomicFile)
+  AtomicFile file(filename);
+  file.write(buffer.data(), buffer.size());
+  file.commit();
+  return;
+} // End method save
+
+/**
+ * Method load
+ *
+ * Legge il checkpoint dal file con nome passato. Se il file non e` un
+ * checkpoint valido (o e` danneggiato) viene lanciata un'eccezione read_error.
+ */
+void Checkpoint::load(const std::string& filename) {
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.is_open()) throw file_error("In Checkpoint::load");
+  std::ostringstream oss;
+  oss <<ifs.rdbuf();
+  std::string buffer = oss.str();
+  // controlla l'intestazione e il checksum
+  unsigned long long sum;
+  if (buffer.size() < sizeof(MAGIC) + sizeof(VERSION) + sizeof(sum) ||
+      buffer.compare(0, sizeof(MAGIC), std::string(MAGIC, sizeof(MAGIC))) != 0)
+    throw read_error("In Checkpoint::load");
+  std::size_t pos = buffer.size() - sizeof(sum);
+  get(buffer, pos, sum);
+  buffer.resize(buffer.size() - sizeof(sum));
+  if (sum != checksum(buffer)) throw read_error("In Checkpoint::load");
+  // legge i campi
+  uint version, stop;
+  pos = sizeof(MAGIC);
+  get(buffer, pos, version);
+  if (version != VERSION) throw read_error("In Checkpoint::load");
+  get(buffer, pos, rseed);
+  for (int i = 0; i < 4; ++i) get(buffer, pos, rstate[i]);
+  get(buffer, pos, rcount);
+  get(buffer, pos, fold);
+  get(buffer, pos, epoch);
+  get(buffer, pos, stop);
+  stopped = (stop != 0);
+  get(buffer, pos, weights);
+  get(buffer, pos, bestweights);
+  get(buffer, pos, momentum);
+  get(buffer, pos, av);
+  get(buffer, pos, trav);
+  get(buffer, pos, vasample);
+  get(buffer, pos, vastrata);
+  get(buffer, pos, results);
+  get(buffer, pos, totals);
+  return;
+} // End method load
+
+// =====================
+// PUBLIC STATIC METHODS
+// =====================
+
+/**
+ * Method isCheckpoint
+ *
+ * Restituisce true se il file con nome passato inizia con l'intestazione di
+ * un file di checkpoint.
+ */
+bool Checkpoint::isCheckpoint(const std::string& filename) {
+  char magic[sizeof(MAGIC)];
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.is_open()) return false;
+  ifs.read(magic, sizeof(magic));
+  return ifs.good() && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+} // End method isCheckpoint
@@ -0,0 +1,62 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+#include "global.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class Checkpoint
+ *
+ * Contiene lo stato completo di un processo di training, sufficiente per
+ * riprenderlo esattamente dal punto in cui e` stato salvato: lo stato del
+ * generatore di numeri casuali, il fold e l'epoca correnti, i pesi del modello
+ * (corrente e migliore), lo stato dell'algoritmo di training (momentum),
+ * l'ordine delle istanze del dataset (e il sottoinsieme estratto per la
+ * validation), i risultati dell'epoca corrente e i migliori raggiunti, i
+ * risultati accumulati sui folds gia` completati.
+ * Con i metodi save e load lo stato viene scritto e letto in un file binario
+ * con il seguente formato:
+ *   magic (8 bytes), versione, campi, checksum
+ * La scrittura e` atomica (vedere la classe AtomicFile), percui un file di
+ * checkpoint e` sempre completo, anche dopo un crash del sistema.
+ */
+class Checkpoint
+{
+  public:
+    Checkpoint ( );
+    virtual ~Checkpoint ( ) { }
+
+    // seme, stato e numeri generati dal generatore del trainer (vedere
+    // Trainer::setRandStream)
+    uint rseed;
+    unsigned long long rstate[4];
+    unsigned long long rcount;
+    // fold corrente ed epoca da cui riprendere
+    uint fold, epoch;
+    bool stopped;
+    // pesi del modello, del modello migliore e stato dell'algoritmo
+    std::vector<real> weights, bestweights, momentum;
+    // ordine delle istanze nel dataset e nel training set
+    std::vector<uint> av, trav;
+    // sottoinsieme del validation set (vedere Trainer::setValidationSample)
+    std::vector<uint> vasample, vastrata;
+    // risultati dell'epoca corrente e valori migliori (vedere Trainer)
+    std::vector<real> results;
+    // risultati accumulati sui folds completati (vedere NNTraining)
+    std::vector<real> totals;
+
+    void save ( const std::string& filename ) const;
+    void load ( const std::string& filename );
+    static bool isCheckpoint ( const std::string& filename );
+
+  private:
+    static const char MAGIC[8];
+    static const uint VERSION;
+
+}; // End class Checkpoint
+
+#endif /* CHECKPOINT_H_ */
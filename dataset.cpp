@@ -4,23 +4,675 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <charconv>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <cmath>
 #include <cassert>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_F16C_INTRINSICS
+#endif
 #include "global.h"
 #include "exception.h"
+#include "atomicfile.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
 
+// =================
+// RELATED FUNCTIONS
+// =================
+
+/**
+ * Function isBlank
+ *
+ * Restituisce true se il carattere passato e` uno spazio o un tab.
+ */
+static inline bool isBlank(char c) {
+  return c == ' ' || c == '\t';
+} // End function isBlank
+
+/**
+ * Function parseReal
+ *
+ * Converte i caratteri nell'intervallo [first,last) nel corrispondente numero
+ * reale con std::from_chars, senza copiarli. Il risultato e` lo stesso di
+ * Global::toReal (strtod): se il campo non e` un numero decimale semplice
+ * (ad esempio un numero esadecimale o fuori dall'intervallo) la conversione
+ * viene fatta con strtod su una copia del campo.
+ */
+static real parseReal(const char* first, const char* last) {
+  while (first < last && std::isspace((unsigned char) *first)) ++first;
+  const char* begin = first;
+  if (begin + 1 < last && *begin == '+' && begin[1] != '-') ++begin;
+  real value = 0.0;
+  std::from_chars_result r = std::from_chars(begin, last, value);
+  if (r.ec == std::errc() && (r.ptr == last ||
+      std::isspace((unsigned char) *r.ptr) ||
+      std::strchr("xXpP", *r.ptr) == NULL))
+    return value;
+  return strtod(std::string(first, last).c_str(), NULL);
+} // End function parseReal
+
+/**
+ * Function appendId
+ *
+ * Aggiunge alla stringa ids l'id nel campo [first,last), senza gli spazi
+ * iniziali e finali.
+ */
+static inline void appendId(const char* first, const char* last,
+    std::string& ids) {
+  while (first < last && *first == ' ') ++first;
+  while (last > first && last[-1] == ' ') --last;
+  ids.append(first, last);
+} // End function appendId
+
+/**
+ * Function rowId
+ *
+ * Restituisce l'id (il primo campo, come appendId) della riga [first,last),
+ * per i messaggi di errore.
+ */
+static std::string rowId(const char* first, const char* last) {
+  std::string id;
+  const char* comma = static_cast<const char*>(
+      std::memchr(first, ',', last - first));
+  appendId(first, (comma == NULL) ? last : comma, id);
+  return id;
+} // End function rowId
+
+/**
+ * Function align
+ *
+ * Restituisce la prima posizione allineata a 64 bytes non minore di pos.
+ */
+static inline std::size_t align(std::size_t pos) {
+  return (pos + 63) / 64 * 64;
+} // End function align
+
+/**
+ * Function checksum
+ *
+ * Restituisce il checksum (FNV-1a a 64 bit) dei bytes passati.
+ */
+static unsigned long long checksum(const char* data, std::size_t size) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+} // End function checksum
+
+/**
+ * Function putValue
+ *
+ * Scrive il valore passato in posizione i della matrice matrix, con la
+ * precisione indicata (64 o 32 bits).
+ */
+static inline void putValue(char* matrix, std::size_t i, uint precision,
+    real value) {
+  if (precision == 64) std::memcpy(matrix + i * 8, &value, 8);
+  else {
+    float f = value;
+    std::memcpy(matrix + i * 4, &f, 4);
+  }
+} // End function putValue
+
+/**
+ * Function getValue
+ *
+ * Restituisce il valore in posizione i della matrice matrix, memorizzato con
+ * la precisione indicata (64 o 32 bits).
+ */
+static inline real getValue(const char* matrix, std::size_t i,
+    uint precision) {
+  if (precision == 64) {
+    real value;
+    std::memcpy(&value, matrix + i * 8, 8);
+    return value;
+  }
+  float f;
+  std::memcpy(&f, matrix + i * 4, 4);
+  return f;
+} // End function getValue
+
+/**
+ * Function floatToHalf
+ *
+ * Converte un float nel corrispondente half (IEEE 754 a 16 bits), con
+ * arrotondamento al piu` vicino (pari in caso di parita`): il risultato e`
+ * identico a quello dell'istruzione vcvtps2ph (F16C).
+ */
+static std::uint16_t floatToHalf(float value) {
+  std::uint32_t x;
+  std::memcpy(&x, &value, 4);
+  const std::uint32_t sign = (x >> 16) & 0x8000;
+  const std::uint32_t exp = (x >> 23) & 0xff;
+  std::uint32_t mant = x & 0x7fffff;
+  if (exp == 0xff) // infinito o NaN (silenzioso)
+    return sign | 0x7c00 | (mant != 0 ? 0x200 | (mant >> 13) : 0);
+  const int e = int(exp) - 127 + 15;
+  if (e >= 31) return sign | 0x7c00;
+  if (e <= 0) {
+    // denormalizzato (o zero)
+    if (e < -10) return sign;
+    mant |= 0x800000;
+    const std::uint32_t shift = 14 - e;
+    std::uint32_t h = mant >> shift;
+    const std::uint32_t rem = mant & ((1u << shift) - 1);
+    const std::uint32_t half = 1u << (shift - 1);
+    if (rem > half || (rem == half && (h & 1))) ++h;
+    return sign | h;
+  }
+  std::uint32_t h = (std::uint32_t(e) << 10) | (mant >> 13);
+  const std::uint32_t rem = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+  return sign | h;
+} // End function floatToHalf
+
+/**
+ * Function halfToFloat
+ *
+ * Converte un half (IEEE 754 a 16 bits) nel corrispondente float (senza
+ * perdita di precisione).
+ */
+static float halfToFloat(std::uint16_t h) {
+  const std::uint32_t sign = std::uint32_t(h & 0x8000) << 16;
+  std::uint32_t exp = (h >> 10) & 0x1f;
+  std::uint32_t mant = h & 0x3ff;
+  std::uint32_t x;
+  if (exp == 0x1f) x = sign | 0x7f800000 | (mant << 13);
+  else if (exp != 0) x = sign | ((exp + 112) << 23) | (mant << 13);
+  else if (mant == 0) x = sign;
+  else {
+    // denormalizzato: normalizza la mantissa
+    exp = 113;
+    while ((mant & 0x400) == 0) {
+      mant <<= 1;
+      --exp;
+    }
+    x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+  }
+  float value;
+  std::memcpy(&value, &x, 4);
+  return value;
+} // End function halfToFloat
+
+#ifdef HAVE_F16C_INTRINSICS
+/**
+ * Function packHalfF16c
+ *
+ * Converte n reali (n multiplo di 8) in half con le istruzioni F16C.
+ */
+__attribute__((target("avx,f16c")))
+static void packHalfF16c(const real* src, std::size_t n, unsigned char* dest) {
+  float f[8];
+  for (std::size_t i = 0; i < n; i += 8) {
+    for (uint j = 0; j < 8; ++j) f[j] = src[i+j];
+    const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(f),
+        _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 2 * i), h);
+  }
+  return;
+} // End function packHalfF16c
+
+/**
+ * Function unpackHalfF16c
+ *
+ * Converte n half (n multiplo di 8) in reali con le istruzioni F16C.
+ */
+__attribute__((target("avx,f16c")))
+static void unpackHalfF16c(const unsigned char* src, std::size_t n,
+    real* dest) {
+  float f[8];
+  for (std::size_t i = 0; i < n; i += 8) {
+    const __m128i h = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(src + 2 * i));
+    _mm256_storeu_ps(f, _mm256_cvtph_ps(h));
+    for (uint j = 0; j < 8; ++j) dest[i+j] = f[j];
+  }
+  return;
+} // End function unpackHalfF16c
+#endif
+
+/**
+ * Function hasF16c
+ *
+ * Restituisce true se il processore supporta le istruzioni F16C.
+ */
+static bool hasF16c() {
+#ifdef HAVE_F16C_INTRINSICS
+  static const bool f16c = __builtin_cpu_supports("f16c");
+  return f16c;
+#else
+  return false;
+#endif
+} // End function hasF16c
+
+/**
+ * Function packHalf
+ *
+ * Converte n reali in half (a 16 bits, little endian) nel buffer dest.
+ */
+static void packHalf(const real* src, std::size_t n, unsigned char* dest) {
+  std::size_t i = 0;
+#ifdef HAVE_F16C_INTRINSICS
+  if (hasF16c()) {
+    i = n / 8 * 8;
+    packHalfF16c(src, i, dest);
+  }
+#endif
+  for (; i < n; ++i) {
+    const std::uint16_t h = floatToHalf(float(src[i]));
+    std::memcpy(dest + 2 * i, &h, 2);
+  }
+  return;
+} // End function packHalf
+
+/**
+ * Function unpackHalf
+ *
+ * Converte n half (a 16 bits) del buffer src in reali.
+ */
+static void unpackHalf(const unsigned char* src, std::size_t n, real* dest) {
+  std::size_t i = 0;
+#ifdef HAVE_F16C_INTRINSICS
+  if (hasF16c()) {
+    i = n / 8 * 8;
+    unpackHalfF16c(src, i, dest);
+  }
+#endif
+  for (; i < n; ++i) {
+    std::uint16_t h;
+    std::memcpy(&h, src + 2 * i, 2);
+    dest[i] = halfToFloat(h);
+  }
+  return;
+} // End function unpackHalf
+
+/**
+ * Function share
+ *
+ * Restituisce uno shared_ptr ai dati del contenitore passato (un vettore o una
+ * stringa), il cui contenuto viene spostato (senza copie) in un nuovo oggetto
+ * di cui lo shared_ptr mantiene la proprieta`.
+ */
+template <class C>
+static std::shared_ptr<const typename C::value_type> share(C& container) {
+  std::shared_ptr<C> owner(new C());
+  owner->swap(container);
+  return std::shared_ptr<const typename C::value_type>(owner, owner->data());
+} // End function share
+
+/**
+ * Struct Unmap
+ *
+ * Deleter degli shared_ptr ai file mappati in memoria (vedere Dataset::load).
+ */
+struct Unmap {
+  std::size_t size;
+  void operator()(const char* data) const {
+    munmap(const_cast<char*>(data), size);
+  }
+}; // End struct Unmap
+
+// ============
+// CLASS VALUES
+// ============
+
+/**
+ * Method decode
+ *
+ * Converte in reali, nel buffer dest, i valori della vista compressa (vedere
+ * Dataset::setStoragePrecision).
+ */
+void Dataset::Values::decode(real* dest) const {
+  if (bits == 32) {
+    for (uint i = 0; i < n; ++i) {
+      float f;
+      std::memcpy(&f, packed + 4 * i, 4);
+      dest[i] = f;
+    }
+  }
+  else if (bits == 16) unpackHalf(packed, n, dest);
+  else for (uint i = 0; i < n; ++i)
+    dest[i] = affine[2*i] + affine[2*i+1] * packed[i];
+  return;
+} // End method decode
+
+/**
+ * Method decode
+ *
+ * Restituisce l'i-esimo valore della vista compressa, convertito in reale.
+ */
+real Dataset::Values::decode(uint i) const {
+  if (bits == 32) {
+    float f;
+    std::memcpy(&f, packed + 4 * i, 4);
+    return f;
+  }
+  if (bits == 16) {
+    std::uint16_t h;
+    std::memcpy(&h, packed + 2 * i, 2);
+    return halfToFloat(h);
+  }
+  return affine[2*i] + affine[2*i+1] * packed[i];
+} // End method decode
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+uint Dataset::loadthreads = 0;
+std::vector<uint> Dataset::columns;
+std::vector<uint> Dataset::colslot;
+uint Dataset::storagebits = 64;
+std::string Dataset::cachedir;
+const std::size_t Dataset::MIN_CHUNK = 1 << 20;
+const std::size_t Dataset::MIN_GATHER = 1 << 14;
+const char Dataset::MAGIC[8] = { 'N', 'N', 'D', 'S', 'B', 'I', 'N', '\0' };
+const uint Dataset::VERSION = 1;
+
 /**
  * Default constructor
  *
  * Costruisce un dataset vuoto
  */
 Dataset::Dataset() :
-    folds(0), vafold(0)
-{ } // End default constructor
+    rows(0), ninputs(0), noutputs(0), inbits(64),
+    folds(0), vafold(0),
+    loadbytes(0), loadtime(0.0)
+{
+  std::vector<unsigned long long> pos(1, 0);
+  idpos = share(pos);
+} // End default constructor
+
+// =====================
+// PUBLIC STATIC METHODS
+// =====================
+
+/**
+ * Method setLoadThreads
+ *
+ * Imposta il numero di threads utilizzati dal metodo load per analizzare il
+ * file; con 0 (default) viene utilizzato il numero di processori disponibili.
+ * Ogni thread analizza almeno MIN_CHUNK bytes, percui i file piccoli vengono
+ * comunque analizzati da un solo thread.
+ */
+void Dataset::setLoadThreads(uint n) {
+  loadthreads = n;
+  return;
+} // End method setLoadThreads
+
+/**
+ * Method getLoadThreads
+ *
+ * Restituisce il numero di threads impostato con setLoadThreads.
+ */
+uint Dataset::getLoadThreads() {
+  return loadthreads;
+} // End method getLoadThreads
+
+/**
+ * Method setColumns
+ *
+ * Imposta le colonne dei file csv caricate dai metodi load e loadBlock. La
+ * specifica e` una lista, separata da virgole, di colonne o intervalli di
+ * colonne (estremi inclusi), ad esempio "1-300,2001": le colonne sono numerate
+ * da 1 dopo l'id (che viene sempre letto). Le colonne selezionate, nell'ordine
+ * della lista, sono gli inputs e poi gli outputs dell'istanza (le colonne in
+ * piu` vengono ignorate, ad esempio se il dataset viene caricato senza
+ * outputs); le altre colonne vengono saltate senza essere convertite e la
+ * riga non viene analizzata oltre l'ultima colonna selezionata. Con una
+ * specifica vuota (default) vengono caricate tutte le colonne. Le colonne
+ * non si applicano ai file binari, che contengono gia` solo inputs e outputs.
+ * Se la specifica non e` valida (colonne nulle o ripetute, intervalli vuoti)
+ * viene lanciata l'eccezione std::invalid_argument.
+ */
+void Dataset::setColumns(const std::string& spec) {
+  std::vector<uint> selected;
+  std::vector<std::string>* items = Global::split(spec, ',');
+  for (uint i = 0; i < items->size(); ++i) {
+    std::string item = (*items)[i];
+    Global::trim(item);
+    const std::string::size_type dash = item.find('-');
+    std::string from = item.substr(0, dash);
+    std::string to = (dash == std::string::npos) ? from : item.substr(dash+1);
+    Global::trim(from);
+    Global::trim(to);
+    if (from.empty() || to.empty() ||
+        from.find_first_not_of("0123456789") != std::string::npos ||
+        to.find_first_not_of("0123456789") != std::string::npos) {
+      delete items;
+      throw std::invalid_argument("Invalid column " + item);
+    }
+    const uint a = Global::toUint(from), b = Global::toUint(to);
+    if (a == 0 || b < a) {
+      delete items;
+      throw std::invalid_argument("Invalid column " + item);
+    }
+    for (uint c = a; c <= b; ++c) selected.push_back(c);
+  }
+  delete items;
+  std::vector<uint> slot;
+  for (uint i = 0; i < selected.size(); ++i) {
+    if (selected[i] >= slot.size()) slot.resize(selected[i] + 1, 0);
+    if (slot[selected[i]] != 0)
+      throw std::invalid_argument("Repeated column " +
+          Global::toString(selected[i]));
+    slot[selected[i]] = i + 1;
+  }
+  columns.swap(selected);
+  colslot.swap(slot);
+  return;
+} // End method setColumns
+
+/**
+ * Method getColumns
+ *
+ * Restituisce le colonne impostate con setColumns (vuoto se vengono caricate
+ * tutte le colonne).
+ */
+const std::vector<uint>& Dataset::getColumns() {
+  return columns;
+} // End method getColumns
+
+/**
+ * Method setStoragePrecision
+ *
+ * Imposta la precisione (bits per valore) con cui vengono memorizzati gli
+ * inputs dei dataset caricati (e sostituiti con setInputs):
+ *   64 : reali (default), senza conversioni;
+ *   32 : float;
+ *   16 : half (IEEE 754), convertiti con le istruzioni F16C se disponibili;
+ *    8 : interi senza segno, con una trasformazione affine per colonna
+ *        (x = min + q (max - min) / 255, con min e max della colonna).
+ * Gli outputs restano reali. I valori vengono convertiti in reali quando le
+ * viste compresse vengono copiate (vedere Values), percui il training e` piu`
+ * veloce con il training set copiato nell'ordine dell'epoca o con il
+ * Prefetcher. Durante il caricamento di un file csv gli inputs di ogni
+ * blocco vengono compressi prima di essere concatenati. Per precisioni
+ * diverse viene lanciata l'eccezione std::invalid_argument.
+ */
+void Dataset::setStoragePrecision(uint bits) {
+  if (bits != 64 && bits != 32 && bits != 16 && bits != 8)
+    throw std::invalid_argument("Invalid storage precision");
+  storagebits = bits;
+  return;
+} // End method setStoragePrecision
+
+/**
+ * Method getStoragePrecision
+ *
+ * Restituisce la precisione impostata con setStoragePrecision.
+ */
+uint Dataset::getStoragePrecision() {
+  return storagebits;
+} // End method getStoragePrecision
+
+/**
+ * Method setCacheDirectory
+ *
+ * Imposta la directory della cache dei file csv caricati con il metodo load
+ * (con una stringa vuota, default, la cache non viene utilizzata). Vedere il
+ * metodo loadCached.
+ */
+void Dataset::setCacheDirectory(const std::string& dir) {
+  cachedir = dir;
+  while (cachedir.size() > 1 && cachedir[cachedir.size()-1] == '/')
+    cachedir.erase(cachedir.size()-1);
+  return;
+} // End method setCacheDirectory
+
+/**
+ * Method getCacheDirectory
+ *
+ * Restituisce la directory impostata con setCacheDirectory.
+ */
+const std::string& Dataset::getCacheDirectory() {
+  return cachedir;
+} // End method getCacheDirectory
+
+/**
+ * Method getCacheName
+ *
+ * Restituisce il nome del file di cache (nella directory impostata con
+ * setCacheDirectory) del file csv filename caricato con ninputs inputs e
+ * noutputs outputs. Il nome contiene il checksum del percorso assoluto, della
+ * dimensione e della data di modifica del file, del numero di inputs e di
+ * outputs, delle colonne selezionate (vedere setColumns) e della precisione
+ * del file di cache, percui un file modificato ha un nuovo file di cache.
+ */
+std::string Dataset::getCacheName(const std::string& filename, uint ninputs,
+    uint noutputs) {
+  struct stat st;
+  char* path = realpath(filename.c_str(), NULL);
+  if (path == NULL || stat(path, &st) != 0) {
+    std::free(path);
+    throw file_error("In Dataset::getCacheName");
+  }
+  std::string key(path);
+  std::free(path);
+  key += '\0' + Global::toString(uint(storagebits == 32 ? 32 : 64));
+  const unsigned long long values[] = { (unsigned long long) st.st_size,
+      (unsigned long long) st.st_mtim.tv_sec,
+      (unsigned long long) st.st_mtim.tv_nsec, ninputs, noutputs };
+  key.append(reinterpret_cast<const char*>(values), sizeof(values));
+  for (std::size_t i = 0; i < columns.size(); ++i)
+    key += ',' + Global::toString(columns[i]);
+  char name[32];
+  std::snprintf(name, sizeof(name), "nn-%016llx.nnds",
+      checksum(key.data(), key.size()));
+  return cachedir + "/" + name;
+} // End method getCacheName
+
+/**
+ * Method isBinary
+ *
+ * Restituisce true se il file passato e` un dataset in formato binario (vedere
+ * il metodo saveBinary).
+ */
+bool Dataset::isBinary(const std::string& filename) {
+  char magic[sizeof(MAGIC)];
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+} // End method isBinary
+
+/**
+ * Method checkBinary
+ *
+ * Controlla l'integrita` del dataset in formato binario nel file passato:
+ * restituisce true se l'header e` valido, la dimensione del file corrisponde
+ * e il checksum dei dati e` corretto.
+ */
+bool Dataset::checkBinary(const std::string& filename) {
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.is_open()) throw file_error("In Dataset::checkBinary");
+  BinaryHeader header;
+  if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION)
+    return false;
+  std::size_t offsets[4];
+  getBinaryLayout(header, offsets);
+  std::string body((std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+  return body.size() + sizeof(header) == offsets[3] + header.idbytes &&
+      checksum(body.data(), body.size()) == header.checksum;
+} // End method checkBinary
+
+/**
+ * Method getNumberOfBlocks
+ *
+ * Restituisce il numero di blocchi in cui viene diviso il file passato
+ * leggendolo a blocchi di blockbytes bytes (vedere il metodo loadBlock); il
+ * numero di blocchi e` almeno 1.
+ */
+uint Dataset::getNumberOfBlocks(const std::string& filename,
+    std::size_t blockbytes) {
+  if (blockbytes == 0)
+    throw std::invalid_argument("In Dataset::getNumberOfBlocks");
+  std::size_t size = 0;
+  std::shared_ptr<const char> map = mapFile(filename, size);
+  std::size_t n = (size + blockbytes - 1) / blockbytes;
+  if (size >= sizeof(BinaryHeader) &&
+      std::memcmp(map.get(), MAGIC, sizeof(MAGIC)) == 0) {
+    BinaryHeader header;
+    std::memcpy(&header, map.get(), sizeof(header));
+    const std::size_t rows = getBlockRows(header, blockbytes);
+    n = (header.rows + rows - 1) / rows;
+  }
+  return std::max<std::size_t>(n, 1);
+} // End method getNumberOfBlocks
+
+/**
+ * Method mapFile
+ *
+ * Mappa in memoria (in sola lettura) il file passato, restituendo il puntatore
+ * ai dati (nullo per un file vuoto), che rilascia la mappatura quando non e`
+ * piu` utilizzato, e la dimensione del file in size. Con il costruttore di
+ * aliasing di std::shared_ptr si possono ricavare puntatori a parti del file
+ * (ad esempio una matrice, vedere setInputs) che mantengono la mappatura.
+ */
+std::shared_ptr<const char> Dataset::mapFile(const std::string& filename,
+    std::size_t& size) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) throw file_error("In Dataset::mapFile");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw file_error("In Dataset::mapFile");
+  }
+  size = st.st_size;
+  std::shared_ptr<const char> map;
+  if (size > 0) {
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw file_error("In Dataset::mapFile");
+    }
+    Unmap unmap = { size };
+    map.reset(static_cast<const char*>(data), unmap);
+  }
+  close(fd);
+  return map;
+} // End method mapFile
 
 // ==============
 // PUBLIC METHODS
@@ -37,33 +689,187 @@ Dataset::Dataset() :
  *   - file : nome del file (.csv) da cui caricare il dataset
  *   - ninputs : numero degli inputs per ogni istanza
  *   - noutputs : numero degli outputs per ogni istanza
+ * Le righe vuote o che iniziano con # vengono ignorate. Il file viene mappato
+ * in memoria e ogni riga viene analizzata direttamente sul file mappato (vedere
+ * il metodo parseLine); i valori letti sono identici a quelli ottenuti con
+ * Global::split e Global::toReal.
+ * Il file viene diviso in blocchi (uno per thread, vedere setLoadThreads) che
+ * terminano a fine riga; ogni blocco viene analizzato da un thread in matrici
+ * separate che vengono poi concatenate nell'ordine dei blocchi, percui il
+ * dataset e` identico a quello letto da un solo thread.
+ * Se il file e` in formato binario (vedere saveBinary) il dataset viene letto
+ * direttamente dalle matrici del file, senza analisi del testo: con precisione
+ * a 64 bits le matrici e gli ids del dataset sono quelli del file mappato in
+ * memoria, che resta mappato finche' esiste una copia del dataset (il file non
+ * deve quindi essere troncato o riscritto sul posto nel frattempo).
+ * Con la cache impostata (vedere setCacheDirectory) un file csv viene letto
+ * dal corrispondente file binario di cache (vedere loadCached).
+ * Con le colonne impostate (vedere setColumns) vengono caricate dal file csv
+ * solo le colonne selezionate, che devono essere almeno ninputs + noutputs,
+ * altrimenti viene lanciata l'eccezione std::invalid_argument.
  */
 void Dataset::load(const std::string& filename, uint ninputs, uint noutputs) {
-  std::string line;
-  std::ifstream file(filename.c_str());
-  if (!file.is_open()) throw file_error("In Dataset::load");
-  dataset.clear();
+  if (!cachedir.empty() && !isBinary(filename))
+    loadCached(filename, ninputs, noutputs);
+  else loadBlock(filename, ninputs, noutputs, 0, 0);
+  return;
+} // End method load
+
+/**
+ * Method loadBlock
+ *
+ * Carica (come il metodo load) solamente il k-esimo blocco del file, per
+ * leggere a blocchi file piu` grandi della memoria disponibile (vedere la
+ * classe DatasetStream). Per un file csv il blocco k contiene le righe che
+ * iniziano nei bytes [k*blockbytes,(k+1)*blockbytes) del file; per un file
+ * binario contiene le istanze [k*n,(k+1)*n), con n il numero di istanze (di
+ * almeno un'istanza) i cui valori occupano blockbytes bytes. Con blockbytes
+ * uguale a 0 viene caricato l'intero file. Solo le pagine del file relative al
+ * blocco vengono lette dal disco.
+ */
+void Dataset::loadBlock(const std::string& filename, uint ninputs,
+    uint noutputs, uint k, std::size_t blockbytes) {
+  timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+  std::size_t size = 0;
+  std::shared_ptr<const char> map = mapFile(filename, size);
+  const char* data = map.get();
   av.clear();
-  while (file.good()) {
-    std::getline(file, line);
-    Global::trim(line, " \t");
-    if (!line.empty() && line[0] != '#') {
-      std::vector<std::string>* csvline = Global::split(line, ',');
-      assert( ninputs + noutputs + 1 == csvline->size() );
-      dataset.push_back(Instance());
-      dataset.back().id = Global::trim(csvline->at(0));
-      for (uint i = 0; i < ninputs; ++i)
-        dataset.back().input.push_back(Global::toReal(csvline->at(i+1)));
-      for (uint i = 0; i < noutputs; ++i)
-        dataset.back().output.push_back(Global::toReal(
-            csvline->at(i+1+ninputs) ));
-      delete csvline;
-    } // end if
-  } // end while (file.good())
-  av.resize(dataset.size());
+  this->ninputs = ninputs;
+  this->noutputs = noutputs;
+  if (size >= sizeof(BinaryHeader) &&
+      std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0) {
+    BinaryHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t first = 0, last = header.rows;
+    if (blockbytes > 0) {
+      const std::size_t n = getBlockRows(header, blockbytes);
+      first = std::min<std::size_t>(k * n, header.rows);
+      last = std::min<std::size_t>(first + n, header.rows);
+    }
+    loadBinary(map, size, first, last);
+    if (storagebits != inbits)
+      packInputs(std::vector<const real*>(1, inputs.get()),
+          std::vector<std::size_t>(1, rows));
+    loadbytes = (blockbytes == 0) ? size :
+        (last - first) * (ninputs + noutputs) * (header.precision / 8);
+  }
+  else {
+    if (!columns.empty() && columns.size() < ninputs + noutputs)
+      throw std::invalid_argument("In Dataset::loadBlock: too few columns");
+    const char* first = data;
+    const char* last = data + size;
+    if (blockbytes > 0) {
+      first = lineStart(data, size, std::size_t(k) * blockbytes);
+      last = lineStart(data, size, std::size_t(k+1) * blockbytes);
+    }
+    if (last > first) {
+      // consiglia la lettura sequenziale (da un indirizzo allineato)
+      const std::size_t page = sysconf(_SC_PAGESIZE);
+      const std::size_t offset = (first - data) / page * page;
+      madvise(const_cast<char*>(data + offset), last - data - offset,
+          MADV_SEQUENTIAL);
+    }
+    loadText(first, last - first);
+    loadbytes = last - first;
+  }
+  av.resize(rows);
   for (uint i = 0; i < av.size(); ++i) av[i] = i;
+  gettimeofday(&tend, NULL);
+  loadtime = (tend.tv_sec - tstart.tv_sec) +
+      (tend.tv_usec - tstart.tv_usec) / 1000000.0;
   return;
-} // End method load
+} // End method loadBlock
+
+/**
+ * Method select
+ *
+ * Mantiene nel dataset solamente le istanze indicate (con gli indici nell'
+ * ordine corrente), nell'ordine in cui sono indicate. Le istanze vengono
+ * copiate in nuove matrici (le copie del dataset non vengono modificate) e le
+ * partizioni vengono eliminate. Gli inputs compressi restano compressi.
+ */
+void Dataset::select(const std::vector<uint>& indices) {
+  std::vector<real> in, out;
+  std::vector<unsigned char> pin;
+  std::string id;
+  std::vector<unsigned long long> pos(1, 0);
+  const std::size_t bytes = std::size_t(ninputs) * (inbits / 8);
+  if (packed) pin.resize(indices.size() * bytes);
+  else in.reserve(indices.size() * ninputs);
+  out.reserve(indices.size() * noutputs);
+  pos.reserve(indices.size() + 1);
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    const Instance instance = this->at(indices[i]);
+    if (packed)
+      std::memcpy(pin.data() + i * bytes,
+          packed.get() + std::size_t(av[indices[i]]) * bytes, bytes);
+    else in.insert(in.end(), instance.input.begin(), instance.input.end());
+    out.insert(out.end(), instance.output.begin(), instance.output.end());
+    id.append(instance.id.data(), instance.id.size());
+    pos.push_back(id.size());
+  }
+  rows = indices.size();
+  if (packed) packed = share(pin);
+  else inputs = share(in);
+  outputs = share(out);
+  ids = share(id);
+  idpos = share(pos);
+  merge();
+  av.resize(rows);
+  for (uint i = 0; i < av.size(); ++i) av[i] = i;
+  return;
+} // End method select
+
+/**
+ * Method saveBinary
+ *
+ * Salva il dataset (nell'ordine originale delle istanze) nel file passato, nel
+ * formato binario descritto nella documentazione della classe, con i valori
+ * memorizzati con la precisione indicata (64 o 32 bits). La scrittura e`
+ * atomica (vedere la classe AtomicFile).
+ */
+void Dataset::saveBinary(const std::string& filename, uint precision) const {
+  if (precision != 64 && precision != 32)
+    throw std::invalid_argument("In Dataset::saveBinary");
+  BinaryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.precision = precision;
+  header.rows = rows;
+  header.ninputs = ninputs;
+  header.noutputs = noutputs;
+  const unsigned long long* pos = idpos.get();
+  header.idbytes = pos[rows] - pos[0];
+  std::size_t offsets[4];
+  getBinaryLayout(header, offsets);
+  // costruisce il contenuto del file (dopo l'header)
+  std::string buffer(offsets[3] + header.idbytes - sizeof(header), '\0');
+  std::vector<real> in(ninputs);
+  for (std::size_t r = 0; r < rows; ++r) {
+    row(r).input.copy(in.data());
+    for (uint c = 0; c < ninputs; ++c)
+      putValue(&buffer[offsets[0] - sizeof(header)], r * ninputs + c,
+          precision, in[c]);
+  }
+  for (std::size_t i = 0; i < rows * noutputs; ++i)
+    putValue(&buffer[offsets[1] - sizeof(header)], i, precision,
+        outputs.get()[i]);
+  unsigned long long* outpos = reinterpret_cast<unsigned long long*>(
+      &buffer[offsets[2] - sizeof(header)]);
+  for (std::size_t i = 0; i <= rows; ++i) outpos[i] = pos[i] - pos[0];
+  if (header.idbytes > 0)
+    std::memcpy(&buffer[offsets[3] - sizeof(header)], ids.get() + pos[0],
+        header.idbytes);
+  header.checksum = checksum(buffer.data(), buffer.size());
+  // scrive il file
+  AtomicFile file(filename);
+  file.write(&header, sizeof(header));
+  file.write(buffer.data(), buffer.size());
+  file.commit();
+  return;
+} // End method saveBinary
 
 /**
  * Method setFolds
@@ -74,7 +880,7 @@ void Dataset::load(const std::string& filename, uint ninputs, uint noutputs) {
  * Il numero di folds dev'essere minore della dimensione del dataset.
  */
 void Dataset::setFolds(uint n) {
-  if (n > dataset.size()) throw std::out_of_range("In Dataset::setFolds");
+  if (n > rows) throw std::out_of_range("In Dataset::setFolds");
   if (n == 0) {
     merge();
     return;
@@ -120,7 +926,7 @@ void Dataset::merge ( ) {
  * altrimenti
  */
 bool Dataset::isEmpty ( ) const {
-  return dataset.empty();
+  return rows == 0;
 } // End method isEmpty
 
 /**
@@ -129,9 +935,46 @@ bool Dataset::isEmpty ( ) const {
  * Restituisce la dimensione del dataset (numero di istanze presenti)
  */
 uint Dataset::getSize() const {
-  return dataset.size();
+  return rows;
 } // End method getSize
 
+/**
+ * Method getNumberOfInputs
+ *
+ * Restituisce il numero di inputs di ogni istanza
+ */
+uint Dataset::getNumberOfInputs() const {
+  return ninputs;
+} // End method getNumberOfInputs
+
+/**
+ * Method getNumberOfOutputs
+ *
+ * Restituisce il numero di outputs di ogni istanza
+ */
+uint Dataset::getNumberOfOutputs() const {
+  return noutputs;
+} // End method getNumberOfOutputs
+
+/**
+ * Method getInputsPrecision
+ *
+ * Restituisce la precisione (bits per valore) con cui sono memorizzati gli
+ * inputs del dataset (vedere setStoragePrecision).
+ */
+uint Dataset::getInputsPrecision() const {
+  return inbits;
+} // End method getInputsPrecision
+
+/**
+ * Method getInputsBytes
+ *
+ * Restituisce la memoria (in bytes) occupata dagli inputs del dataset.
+ */
+std::size_t Dataset::getInputsBytes() const {
+  return rows * ninputs * (inbits / 8);
+} // End method getInputsBytes
+
 /**
  * Method getFolds
  *
@@ -174,30 +1017,106 @@ uint Dataset::getVaSetSize() const {
 /**
  * Method getId
  *
- * Restituisce un riferimento (costante) all'id dell'i-esimo elemento
+ * Restituisce (una copia del) l'id dell'i-esimo elemento
  */
-const std::string& Dataset::getId (uint i) const {
-  if (i >= dataset.size()) throw std::out_of_range("In Dataset::operator[]");
-  return this->at(i).id;
+std::string Dataset::getId (uint i) const {
+  return std::string(this->at(i).id);
 } // End method getId
 
 /**
  * Method getInputs
  *
- * Restituisce un riferimento (costante) all'input dell'i-esimo elemento
+ * Restituisce gli inputs dell'i-esimo elemento
  */
-const std::vector<real>& Dataset::getInputs ( uint i ) const {
-  if (i >= dataset.size()) throw std::out_of_range("In Dataset::operator[]");
+Dataset::Values Dataset::getInputs ( uint i ) const {
   return this->at(i).input;
 } // End method getInputs
 
+/**
+ * Method getLoadBytes
+ *
+ * Restituisce la dimensione (in bytes) del file da cui e` stato caricato il
+ * dataset con l'ultima invocazione del metodo load.
+ */
+std::size_t Dataset::getLoadBytes() const {
+  return loadbytes;
+} // End method getLoadBytes
+
+/**
+ * Method getLoadTime
+ *
+ * Restituisce il tempo (in secondi) impiegato dall'ultima invocazione del
+ * metodo load.
+ */
+double Dataset::getLoadTime() const {
+  return loadtime;
+} // End method getLoadTime
+
+/**
+ * Method setInputs
+ *
+ * Sostituisce gli inputs di tutti gli elementi con la matrice passata, con una
+ * riga di ninputs valori per ogni elemento (nell'ordine corrente). Il numero di
+ * inputs puo` essere diverso da quello iniziale, ad esempio con le attivazioni
+ * di alcuni strati di una rete neurale (vedere la classe FrozenLayers). Le
+ * copie del dataset mantengono gli inputs precedenti. I nuovi inputs vengono
+ * memorizzati con la precisione impostata (vedere setStoragePrecision).
+ */
+void Dataset::setInputs(const std::vector<real>& inputs, uint ninputs) {
+  if (inputs.size() != rows * ninputs)
+    throw std::invalid_argument("In Dataset::setInputs");
+  std::vector<real> matrix(inputs.size());
+  for (uint i = 0; i < rows; ++i)
+    std::copy(inputs.begin() + std::size_t(i) * ninputs,
+        inputs.begin() + std::size_t(i+1) * ninputs,
+        matrix.begin() + std::size_t(av[i]) * ninputs);
+  this->ninputs = ninputs;
+  this->inputs = share(matrix);
+  packed.reset();
+  affine.reset();
+  inbits = 64;
+  if (storagebits != 64)
+    packInputs(std::vector<const real*>(1, this->inputs.get()),
+        std::vector<std::size_t>(1, rows));
+  return;
+} // End method setInputs
+
+/**
+ * Method setInputs
+ *
+ * Come il metodo precedente, ma con la matrice (rows x ninputs, nell'ordine
+ * corrente) in memoria condivisa, ad esempio in un file mappato in memoria
+ * (vedere mapFile). Se l'ordine corrente e` quello in cui sono memorizzate le
+ * istanze la matrice viene adottata senza copiarla (e mantenuta finche` il
+ * dataset la utilizza), altrimenti viene copiata nell'ordine di memorizzazione.
+ */
+void Dataset::setInputs(const std::shared_ptr<const real>& inputs,
+    uint ninputs) {
+  bool ordered = true;
+  for (std::size_t i = 0; ordered && i < av.size(); ++i)
+    ordered = (av[i] == i);
+  if (!ordered) {
+    setInputs(std::vector<real>(inputs.get(), inputs.get() + rows * ninputs),
+        ninputs);
+    return;
+  }
+  this->ninputs = ninputs;
+  this->inputs = inputs;
+  packed.reset();
+  affine.reset();
+  inbits = 64;
+  if (storagebits != 64)
+    packInputs(std::vector<const real*>(1, this->inputs.get()),
+        std::vector<std::size_t>(1, rows));
+  return;
+} // End method setInputs (shared)
+
 /**
  * Method getOutputs
  *
- * Restituisce un riferimento (costante) output dell'i-esimo elemento
+ * Restituisce gli outputs dell'i-esimo elemento
  */
-const std::vector<real>& Dataset::getOutputs ( uint i ) const {
-  if (i >= dataset.size()) throw std::out_of_range("In Dataset::operator[]");
+Dataset::Values Dataset::getOutputs ( uint i ) const {
   return this->at(i).output;
 } // End method getOutputs
 
@@ -206,7 +1125,7 @@ const std::vector<real>& Dataset::getOutputs ( uint i ) const {
  *
  * Restituisce l'i-esimo elemento (istanza) del training set
  */
-const Dataset::Instance& Dataset::trAt(uint i) {
+Dataset::Instance Dataset::trAt(uint i) {
   if (i >= trav.size()) throw std::out_of_range("In Dataset::trAt");
   return this->at(trav[i]);
 } // End method trAt
@@ -216,7 +1135,7 @@ const Dataset::Instance& Dataset::trAt(uint i) {
  *
  * Restituisce l'i-esimo elemento (istanza) del validation set
  */
-const Dataset::Instance& Dataset::vaAt(uint i) {
+Dataset::Instance Dataset::vaAt(uint i) {
   if (i >= foldDimension(vafold) || folds <= 1)
     throw std::out_of_range("In Dataset::vaAt");
   return this->at(startIndexFold(vafold)+i);
@@ -225,45 +1144,113 @@ const Dataset::Instance& Dataset::vaAt(uint i) {
 /**
  * Method at
  *
- * Restituisce un riferimento (costante) all'i-esimo elemento (istanza) del
- * dataset
+ * Restituisce l'i-esimo elemento (istanza) del dataset
  */
-const Dataset::Instance& Dataset::at(uint i) const {
-  if (i >= dataset.size()) throw std::out_of_range("In Dataset::operator[]");
-  return dataset[av[i]];
+Dataset::Instance Dataset::at(uint i) const {
+  if (i >= rows) throw std::out_of_range("In Dataset::operator[]");
+  return row(av[i]);
 } // End method at
 
 /**
  * Method operator[]
  *
- * Restituisce un riferimento (costante) all'i-esimo elemento (istanza) del
- * dataset
+ * Restituisce l'i-esimo elemento (istanza) del dataset
  */
-const Dataset::Instance& Dataset::operator[](uint i) const {
-  if (i >= dataset.size()) throw std::out_of_range("In Dataset::operator[]");
+Dataset::Instance Dataset::operator[](uint i) const {
   return this->at(i);
 } // End method operator[]
 
 /**
  * randomShuffleTrainingSet
  *
- * Crea una permutazione casuale delle istanze del training set
+ * Crea una permutazione casuale delle istanze del training set, con il
+ * generatore di numeri casuali passato (di default quello globale).
+ * Se blockrows e` maggiore di 1 la permutazione e` a blocchi: le istanze
+ * vengono ordinate per posizione in memoria e divise in blocchi di blockrows
+ * istanze, riordinando in modo casuale i blocchi e le istanze all'interno di
+ * ogni blocco; le istanze consecutive restano cosi` vicine in memoria.
  */
-void Dataset::randomShuffleTrainingSet() {
-  for (uint i = trav.size(); i != 0; --i)
-    std::swap( trav[i-1], trav[Global::getRand(0,i-1)] );
+void Dataset::randomShuffleTrainingSet(Random& random, uint blockrows) {
+  if (blockrows <= 1) {
+    for (uint i = trav.size(); i != 0; --i)
+      std::swap( trav[i-1], trav[random.uniform(i)] );
+    return;
+  }
+  // ordina il training set per posizione in memoria (riga del dataset)
+  const uint none = std::numeric_limits<uint>::max();
+  std::vector<uint> byrow(rows, none);
+  for (uint i = 0; i < trav.size(); ++i) byrow[av[trav[i]]] = trav[i];
+  trav.clear();
+  for (std::size_t r = 0; r < rows; ++r)
+    if (byrow[r] != none) trav.push_back(byrow[r]);
+  // riordina i blocchi
+  std::vector<uint> blocks((trav.size() + blockrows - 1) / blockrows);
+  for (uint b = 0; b < blocks.size(); ++b) blocks[b] = b;
+  for (uint i = blocks.size(); i != 0; --i)
+    std::swap( blocks[i-1], blocks[random.uniform(i)] );
+  // riordina le istanze all'interno di ogni blocco
+  std::vector<uint> shuffled;
+  shuffled.reserve(trav.size());
+  for (uint b = 0; b < blocks.size(); ++b) {
+    std::size_t first = std::size_t(blocks[b]) * blockrows;
+    std::size_t last = std::min(first + blockrows, trav.size());
+    const std::size_t offset = shuffled.size();
+    shuffled.insert(shuffled.end(), trav.begin() + first, trav.begin() + last);
+    for (std::size_t i = last - first; i != 0; --i)
+      std::swap( shuffled[offset+i-1], shuffled[offset+random.uniform(i)] );
+  }
+  trav.swap(shuffled);
   return;
 } // End method randomShuffleTrainingSet
 
+/**
+ * Method gatherTrainingSet
+ *
+ * Copia le istanze del training set, nell'ordine corrente, nelle matrici
+ * contigue inputs (istanze x inputs) e outputs (istanze x outputs), dividendo
+ * la copia tra il numero di threads indicato (ognuno con almeno MIN_GATHER
+ * istanze, percui i training set piccoli vengono copiati da un solo thread).
+ * Gli inputs compressi vengono convertiti in reali durante la copia.
+ */
+void Dataset::gatherTrainingSet(std::vector<real>& inputs,
+    std::vector<real>& outputs, uint threads) const {
+  const std::size_t size = trav.size();
+  inputs.resize(size * ninputs);
+  outputs.resize(size * noutputs);
+  std::size_t n = std::max(1u, threads);
+  n = std::min(n, size / MIN_GATHER + 1);
+  std::vector<std::thread> workers;
+  for (std::size_t k = 0; k < n; ++k) {
+    const std::size_t first = size * k / n;
+    const std::size_t last = size * (k + 1) / n;
+    real* in = inputs.data() + first * ninputs;
+    real* out = outputs.data() + first * noutputs;
+    auto gather = [this, first, last, in, out]() {
+      real* i = in;
+      real* o = out;
+      for (std::size_t r = first; r < last; ++r) {
+        const Instance instance = this->at(trav[r]);
+        i = instance.input.copy(i);
+        o = std::copy(instance.output.begin(), instance.output.end(), o);
+      }
+    };
+    if (k + 1 < n) workers.push_back(std::thread(gather));
+    else gather();
+  }
+  for (std::size_t k = 0; k < workers.size(); ++k) workers[k].join();
+  return;
+} // End method gatherTrainingSet
+
 /**
  * randomShuffle
  *
- * Crea una permutazione casuale del dataset. Se sono impostate dei folds
+ * Crea una permutazione casuale del dataset, con il generatore di numeri
+ * casuali passato (di default quello globale). Se sono impostate dei folds
  * i loro elementi vengono mischiati in modo casuale
  */
-void Dataset::randomShuffle() {
+void Dataset::randomShuffle(Random& random) {
   for (uint i = av.size(); i != 0; --i)
-    std::swap( av[i-1], av[Global::getRand(0,i-1)] );
+    std::swap( av[i-1], av[random.uniform(i)] );
   return;
 } // End method randomShuffle
 
@@ -279,10 +1266,472 @@ void Dataset::restore() {
   return;
 } // End method restore
 
+/**
+ * Method getAccessVectors
+ *
+ * Copia nei vettori passati l'ordine corrente delle istanze del dataset (av)
+ * e del training set (trav), che insieme alle partizioni impostate
+ * identificano lo stato del dataset (vedere setAccessVectors).
+ */
+void Dataset::getAccessVectors(std::vector<uint>& av,
+    std::vector<uint>& trav) const {
+  av = this->av;
+  trav = this->trav;
+  return;
+} // End method getAccessVectors
+
+/**
+ * Method setAccessVectors
+ *
+ * Ripristina l'ordine delle istanze del dataset e del training set (letti con
+ * getAccessVectors). Le partizioni devono essere gia` impostate come al
+ * momento della lettura.
+ */
+void Dataset::setAccessVectors(const std::vector<uint>& av,
+    const std::vector<uint>& trav) {
+  if (av.size() != this->av.size() || trav.size() != this->trav.size())
+    throw std::out_of_range("In Dataset::setAccessVectors");
+  this->av = av;
+  this->trav = trav;
+  return;
+} // End method setAccessVectors
+
 // ===============
 // PRIVATE METHODS
 // ===============
 
+/**
+ * Method loadCached
+ *
+ * Carica il file csv filename dal suo file di cache (vedere getCacheName),
+ * creandolo se non esiste: il file csv viene analizzato (senza compressione
+ * degli inputs) e salvato in formato binario, a 32 bits se gli inputs vengono
+ * memorizzati come float e a 64 bits altrimenti, per poterlo mappare in
+ * memoria senza copie. La creazione e` protetta da un lock (flock) sul file
+ * <cache>.lock, percui tra processi concorrenti solo il primo analizza il
+ * file e gli altri attendono il file di cache. Un file di cache esistente ma
+ * non valido (vedere isValidCache), ad esempio troncato, viene ricreato. In
+ * ogni caso il dataset viene poi caricato dal file di cache, le cui pagine
+ * sono condivise tra tutti i processi che lo hanno mappato. I file di cache
+ * non vengono mai eliminati.
+ */
+void Dataset::loadCached(const std::string& filename, uint ninputs,
+    uint noutputs) {
+  timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+  const std::string cache = getCacheName(filename, ninputs, noutputs);
+  const std::string lock = cache + ".lock";
+  int fd = open(lock.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+    if (fd >= 0) close(fd);
+    throw file_error("In Dataset::loadCached");
+  }
+  if (!isValidCache(cache, ninputs, noutputs)) {
+    const uint bits = storagebits;
+    try {
+      storagebits = 64;
+      loadBlock(filename, ninputs, noutputs, 0, 0);
+      storagebits = bits;
+      saveBinary(cache, (bits == 32) ? 32 : 64);
+    } catch (...) {
+      storagebits = bits;
+      close(fd);
+      throw;
+    }
+  }
+  close(fd);
+  loadBlock(cache, ninputs, noutputs, 0, 0);
+  gettimeofday(&tend, NULL);
+  loadtime = (tend.tv_sec - tstart.tv_sec) +
+      (tend.tv_usec - tstart.tv_usec) / 1000000.0;
+  return;
+} // End method loadCached
+
+/**
+ * Method isValidCache
+ *
+ * Restituisce true se il file di cache cache esiste e ha un header valido
+ * (magic, versione, precisione, numero di inputs e di outputs) e la
+ * dimensione corrispondente all'header. Il checksum non viene controllato,
+ * per non dover leggere l'intero file (vedere checkBinary).
+ */
+bool Dataset::isValidCache(const std::string& cache, uint ninputs,
+    uint noutputs) {
+  struct stat st;
+  if (stat(cache.c_str(), &st) != 0) return false;
+  BinaryHeader header;
+  std::ifstream ifs(cache.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION ||
+      (header.precision != 64 && header.precision != 32) ||
+      header.ninputs != ninputs || header.noutputs != noutputs)
+    return false;
+  std::size_t offsets[4];
+  getBinaryLayout(header, offsets);
+  return std::size_t(st.st_size) == offsets[3] + header.idbytes;
+} // End method isValidCache
+
+/**
+ * Method loadText
+ *
+ * Carica il dataset dal file csv mappato in memoria [data,data+size) (vedere
+ * il metodo load).
+ */
+void Dataset::loadText(const char* data, std::size_t size) {
+  const char* end = data + size;
+  // divide il file in blocchi di righe
+  uint nchunks = loadthreads;
+  if (nchunks == 0) nchunks = std::max(1u, std::thread::hardware_concurrency());
+  nchunks = std::max<std::size_t>(1, std::min<std::size_t>(nchunks,
+      size / MIN_CHUNK));
+  std::vector<const char*> bounds(nchunks+1, end);
+  bounds[0] = data;
+  for (uint k = 1; k < nchunks; ++k) {
+    const char* p = std::max(bounds[k-1], data + size / nchunks * k);
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    bounds[k] = (eol == NULL) ? end : eol + 1;
+  }
+  // analizza i blocchi (il primo nel thread corrente)
+  std::vector<Chunk> chunks(nchunks);
+  std::vector<std::thread> threads;
+  for (uint k = 1; k < nchunks; ++k)
+    threads.push_back(std::thread(&Dataset::parseChunk, bounds[k],
+        bounds[k+1], ninputs, noutputs, &chunks[k]));
+  parseChunk(bounds[0], bounds[1], ninputs, noutputs, &chunks[0]);
+  for (uint k = 0; k < threads.size(); ++k) threads[k].join();
+  // il primo errore nell'ordine del file
+  for (uint k = 0; k < nchunks; ++k)
+    if (chunks[k].error) std::rethrow_exception(chunks[k].error);
+  // comprime gli inputs dei blocchi (vedere setStoragePrecision)
+  if (storagebits != 64) {
+    std::vector<const real*> parts(nchunks);
+    std::vector<std::size_t> sizes(nchunks);
+    for (uint k = 0; k < nchunks; ++k) {
+      parts[k] = chunks[k].inputs.data();
+      sizes[k] = chunks[k].idpos.size() - 1;
+    }
+    packInputs(parts, sizes);
+    for (uint k = 0; k < nchunks; ++k)
+      std::vector<real>().swap(chunks[k].inputs);
+  }
+  // concatena i blocchi nell'ordine del file
+  Chunk& all = chunks[0];
+  if (nchunks > 1) {
+    std::size_t ni = 0, no = 0, nids = 0, npos = 0;
+    for (uint k = 0; k < nchunks; ++k) {
+      ni += chunks[k].inputs.size();
+      no += chunks[k].outputs.size();
+      nids += chunks[k].ids.size();
+      npos += chunks[k].idpos.size();
+    }
+    all.inputs.reserve(ni);
+    all.outputs.reserve(no);
+    all.ids.reserve(nids);
+    all.idpos.reserve(npos);
+    for (uint k = 1; k < nchunks; ++k) {
+      Chunk& chunk = chunks[k];
+      const unsigned long long base = all.ids.size();
+      all.inputs.insert(all.inputs.end(), chunk.inputs.begin(),
+          chunk.inputs.end());
+      all.outputs.insert(all.outputs.end(), chunk.outputs.begin(),
+          chunk.outputs.end());
+      all.ids.append(chunk.ids);
+      for (std::size_t j = 1; j < chunk.idpos.size(); ++j)
+        all.idpos.push_back(base + chunk.idpos[j]);
+      chunk = Chunk();
+    }
+  }
+  rows = all.idpos.size() - 1;
+  if (storagebits == 64) {
+    inputs = share(all.inputs);
+    packed.reset();
+    affine.reset();
+    inbits = 64;
+  }
+  outputs = share(all.outputs);
+  ids = share(all.ids);
+  idpos = share(all.idpos);
+  return;
+} // End method loadText
+
+/**
+ * Method packInputs
+ *
+ * Memorizza come inputs del dataset le matrici parts (di sizes[k] istanze
+ * ciascuna), concatenate e compresse con la precisione impostata (vedere
+ * setStoragePrecision). Con 8 bits per valore l'offset e il passo di ogni
+ * colonna sono calcolati dal minimo e dal massimo della colonna su tutte le
+ * matrici.
+ */
+void Dataset::packInputs(const std::vector<const real*>& parts,
+    const std::vector<std::size_t>& sizes) {
+  const uint bytes = storagebits / 8;
+  std::size_t total = 0;
+  for (std::size_t k = 0; k < sizes.size(); ++k) total += sizes[k];
+  std::vector<unsigned char> matrix(total * ninputs * bytes);
+  std::vector<real> params;
+  if (storagebits == 8) {
+    // minimo e massimo di ogni colonna
+    std::vector<real> lo(ninputs, std::numeric_limits<real>::max());
+    std::vector<real> hi(ninputs, std::numeric_limits<real>::lowest());
+    for (std::size_t k = 0; k < parts.size(); ++k)
+      for (std::size_t i = 0; i < sizes[k] * ninputs; ++i) {
+        lo[i % ninputs] = std::min(lo[i % ninputs], parts[k][i]);
+        hi[i % ninputs] = std::max(hi[i % ninputs], parts[k][i]);
+      }
+    params.resize(2 * ninputs, 0.0);
+    for (uint c = 0; c < ninputs && total > 0; ++c) {
+      params[2*c] = lo[c];
+      params[2*c+1] = (hi[c] - lo[c]) / 255;
+    }
+  }
+  unsigned char* dest = matrix.data();
+  for (std::size_t k = 0; k < parts.size(); ++k) {
+    const real* src = parts[k];
+    const std::size_t n = sizes[k] * ninputs;
+    if (storagebits == 32)
+      for (std::size_t i = 0; i < n; ++i) {
+        const float f = src[i];
+        std::memcpy(dest + 4 * i, &f, 4);
+      }
+    else if (storagebits == 16) packHalf(src, n, dest);
+    else for (std::size_t i = 0; i < n; ++i) {
+      const real step = params[2*(i % ninputs)+1];
+      if (step == 0) continue;
+      const real q = std::round((src[i] - params[2*(i % ninputs)]) / step);
+      dest[i] = (unsigned char) std::min<real>(255, std::max<real>(0, q));
+    }
+    dest += n * bytes;
+  }
+  inputs.reset();
+  packed = share(matrix);
+  affine = share(params);
+  inbits = storagebits;
+  return;
+} // End method packInputs
+
+/**
+ * Method loadBinary
+ *
+ * Carica le istanze [first,last) dal file in formato binario mappato in
+ * memoria (vedere il metodo saveBinary), senza analisi del testo. Il numero di
+ * inputs e di outputs nel file deve essere quello passato al metodo load. Gli
+ * ids e, con precisione a 64 bits, le matrici del dataset puntano direttamente
+ * al file mappato (che viene mantenuto fino al rilascio delle matrici); con
+ * precisione a 32 bits e gli inputs memorizzati come float (vedere
+ * setStoragePrecision) gli inputs compressi sono quelli del file mappato.
+ */
+void Dataset::loadBinary(const std::shared_ptr<const char>& map,
+    std::size_t size, std::size_t first, std::size_t last) {
+  const char* data = map.get();
+  BinaryHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.version != VERSION ||
+      (header.precision != 64 && header.precision != 32) ||
+      header.ninputs != ninputs || header.noutputs != noutputs)
+    throw read_error("In Dataset::loadBinary");
+  std::size_t offsets[4];
+  getBinaryLayout(header, offsets);
+  if (size != offsets[3] + header.idbytes)
+    throw read_error("In Dataset::loadBinary");
+  // controlla le posizioni degli ids delle istanze da caricare
+  const unsigned long long* pos =
+      reinterpret_cast<const unsigned long long*>(data + offsets[2]);
+  if ((first == 0 && pos[0] != 0) || pos[last] > header.idbytes ||
+      (last == header.rows && pos[last] != header.idbytes))
+    throw read_error("In Dataset::loadBinary");
+  for (std::size_t i = first; i < last; ++i)
+    if (pos[i] > pos[i+1]) throw read_error("In Dataset::loadBinary");
+  rows = last - first;
+  packed.reset();
+  affine.reset();
+  inbits = 64;
+  idpos = std::shared_ptr<const unsigned long long>(map, pos + first);
+  ids = std::shared_ptr<const char>(map, data + offsets[3]);
+  if (header.precision == 64) {
+    inputs = std::shared_ptr<const real>(map,
+        reinterpret_cast<const real*>(data + offsets[0]) + first * ninputs);
+    outputs = std::shared_ptr<const real>(map,
+        reinterpret_cast<const real*>(data + offsets[1]) + first * noutputs);
+  }
+  else {
+    std::vector<real> in, out(rows * noutputs);
+    if (storagebits == 32) {
+      packed = std::shared_ptr<const unsigned char>(map,
+          reinterpret_cast<const unsigned char*>(data + offsets[0]) +
+          first * ninputs * 4);
+      inbits = 32;
+      inputs.reset();
+    }
+    else {
+      in.resize(rows * ninputs);
+      for (std::size_t i = 0; i < in.size(); ++i)
+        in[i] = getValue(data + offsets[0], first * ninputs + i,
+            header.precision);
+      inputs = share(in);
+    }
+    for (std::size_t i = 0; i < out.size(); ++i)
+      out[i] = getValue(data + offsets[1], first * noutputs + i,
+          header.precision);
+    outputs = share(out);
+  }
+  return;
+} // End method loadBinary
+
+/**
+ * Method getBlockRows
+ *
+ * Restituisce il numero di istanze (almeno una) di un blocco di blockbytes
+ * bytes del file binario con l'header passato (vedere il metodo loadBlock).
+ */
+std::size_t Dataset::getBlockRows(const BinaryHeader& header,
+    std::size_t blockbytes) {
+  const std::size_t rowbytes = std::max<std::size_t>(1,
+      std::size_t(header.ninputs + header.noutputs) * (header.precision / 8));
+  return std::max<std::size_t>(1, blockbytes / rowbytes);
+} // End method getBlockRows
+
+/**
+ * Method lineStart
+ *
+ * Restituisce l'inizio della prima riga del file csv [data,data+size) che
+ * inizia in una posizione non minore di pos (o la fine del file).
+ */
+const char* Dataset::lineStart(const char* data, std::size_t size,
+    std::size_t pos) {
+  if (pos == 0) return data;
+  if (pos >= size) return data + size;
+  const char* eol = static_cast<const char*>(
+      std::memchr(data + pos - 1, '\n', size - pos + 1));
+  return (eol == NULL) ? data + size : eol + 1;
+} // End method lineStart
+
+/**
+ * Method getBinaryLayout
+ *
+ * Calcola la posizione nel file (dall'inizio) delle sezioni del formato
+ * binario con l'header passato: inputs, outputs, posizioni degli ids e ids.
+ */
+void Dataset::getBinaryLayout(const BinaryHeader& header,
+    std::size_t offsets[4]) {
+  const std::size_t bytes = header.precision / 8;
+  offsets[0] = align(sizeof(header));
+  offsets[1] = align(offsets[0] + header.rows * header.ninputs * bytes);
+  offsets[2] = align(offsets[1] + header.rows * header.noutputs * bytes);
+  offsets[3] = offsets[2] + (header.rows + 1) * sizeof(unsigned long long);
+  return;
+} // End method getBinaryLayout
+
+/**
+ * Method parseChunk
+ *
+ * Aggiunge al blocco chunk le istanze contenute nelle righe del blocco
+ * [first,last) del file (vedere il metodo load). Le posizioni degli ids nel
+ * blocco iniziano da 0. Poiche' il metodo viene eseguito anche in thread
+ * separati, un'eccezione durante l'analisi interrompe il blocco e viene
+ * salvata in chunk->error (vedere loadText).
+ */
+void Dataset::parseChunk(const char* first, const char* last, uint ninputs,
+    uint noutputs, Chunk* chunk) {
+  const std::size_t lines = std::count(first, last, '\n') + 1;
+  chunk->inputs.reserve(lines * ninputs);
+  chunk->outputs.reserve(lines * noutputs);
+  chunk->idpos.reserve(lines + 1);
+  chunk->idpos.push_back(0);
+  try {
+    for (const char* line = first; line < last; ) {
+      const char* eol = static_cast<const char*>(
+          std::memchr(line, '\n', last - line));
+      if (eol == NULL) eol = last;
+      parseLine(line, eol, ninputs, noutputs, *chunk);
+      line = eol + 1;
+    }
+  }
+  catch (...) {
+    chunk->error = std::current_exception();
+  }
+  return;
+} // End method parseChunk
+
+/**
+ * Method parseLine
+ *
+ * Aggiunge al blocco chunk l'istanza contenuta nella riga [first,last) del
+ * file (senza il carattere di fine riga), se la riga non e` vuota o un
+ * commento. I campi vengono individuati sulla riga stessa e i valori
+ * convertiti direttamente nelle matrici degli inputs e degli outputs. Con le
+ * colonne impostate (vedere setColumns) ogni campo viene convertito nella
+ * posizione della propria colonna e i campi non selezionati vengono saltati.
+ * Se la riga non contiene tutti i campi attesi (o, senza colonne impostate,
+ * ne contiene di piu`) viene lanciata l'eccezione std::invalid_argument con
+ * l'id della riga.
+ */
+void Dataset::parseLine(const char* first, const char* last, uint ninputs,
+    uint noutputs, Chunk& chunk) {
+  while (first < last && isBlank(*first)) ++first;
+  while (last > first && (isBlank(last[-1]) || last[-1] == '\r')) --last;
+  if (first == last || *first == '#') return;
+  const std::size_t in = chunk.inputs.size();
+  const std::size_t out = chunk.outputs.size();
+  chunk.inputs.resize(in + ninputs);
+  chunk.outputs.resize(out + noutputs);
+  uint n = 0;
+  if (!colslot.empty()) {
+    // solo le colonne selezionate, fino all'ultima
+    for (const char* field = first; field < last && n < colslot.size(); ++n) {
+      const char* comma = static_cast<const char*>(
+          std::memchr(field, ',', last - field));
+      if (comma == NULL) comma = last;
+      const uint slot = colslot[n];
+      if (n == 0) appendId(field, comma, chunk.ids);
+      else if (slot != 0 && slot <= ninputs)
+        chunk.inputs[in+slot-1] = parseReal(field, comma);
+      else if (slot > ninputs && slot <= ninputs + noutputs)
+        chunk.outputs[out+slot-1-ninputs] = parseReal(field, comma);
+      field = comma + 1;
+    }
+    if (n != colslot.size()) throw std::invalid_argument(
+        "In Dataset::parseLine: too few columns in row " + rowId(first, last));
+    chunk.idpos.push_back(chunk.ids.size());
+    return;
+  }
+  for (const char* field = first; field < last; ++n) {
+    const char* comma = static_cast<const char*>(
+        std::memchr(field, ',', last - field));
+    if (comma == NULL) comma = last;
+    if (n == 0) appendId(field, comma, chunk.ids);
+    else if (n <= ninputs) chunk.inputs[in+n-1] = parseReal(field, comma);
+    else if (n <= ninputs + noutputs)
+      chunk.outputs[out+n-1-ninputs] = parseReal(field, comma);
+    field = comma + 1;
+  }
+  if (ninputs + noutputs + 1 != n) throw std::invalid_argument(
+      "In Dataset::parseLine: wrong number of columns in row " +
+      rowId(first, last));
+  chunk.idpos.push_back(chunk.ids.size());
+  return;
+} // End method parseLine
+
+/**
+ * Method row
+ *
+ * Restituisce la vista sulla riga r delle matrici del dataset (l'istanza in
+ * posizione r nell'ordine del file).
+ */
+inline
+Dataset::Instance Dataset::row(uint r) const {
+  const unsigned long long* pos = idpos.get();
+  Instance instance = {
+    std::string_view(ids.get() + pos[r], pos[r+1] - pos[r]),
+    packed ? Values(packed.get() + std::size_t(r) * ninputs * (inbits / 8),
+        ninputs, inbits, affine.get()) :
+        Values(inputs.get() + std::size_t(r) * ninputs, ninputs),
+    Values(outputs.get() + std::size_t(r) * noutputs, noutputs)
+  };
+  return instance;
+} // End method row
+
 /**
  * Method makeTrAccessVector
  *
@@ -294,9 +1743,9 @@ inline
 void Dataset::makeTrAccessVector() {
   trav.clear();
   if (folds == 1)
-    for (uint i = 0; i < dataset.size(); ++i) trav.push_back(i);
+    for (uint i = 0; i < rows; ++i) trav.push_back(i);
   else
-    for (uint i = 0; i < dataset.size(); ++i)
+    for (uint i = 0; i < rows; ++i)
       if (i < startIndexFold(vafold) || i >= endIndexFold(vafold))
         trav.push_back(i);
   return;
@@ -310,9 +1759,9 @@ void Dataset::makeTrAccessVector() {
 inline
 uint Dataset::startIndexFold(uint k) const {
   assert(k < folds);
-  uint rest = dataset.size()%folds;
-  if (k <= rest) return k * ( floor(dataset.size()/double(folds)) + 1 );
-  return (k * floor(dataset.size()/double(folds)) ) + rest;
+  uint rest = rows%folds;
+  if (k <= rest) return k * ( floor(rows/double(folds)) + 1 );
+  return (k * floor(rows/double(folds)) ) + rest;
 } // End method startIndexFold
 
 /**
@@ -323,7 +1772,7 @@ uint Dataset::startIndexFold(uint k) const {
 inline
 uint Dataset::endIndexFold(uint k) const {
   assert(k < folds);
-  if (k == (folds-1)) return dataset.size();
+  if (k == (folds-1)) return rows;
   return startIndexFold(k+1);
 } // End method endIndexFold
 
@@ -3,6 +3,10 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <exception>
+#include <algorithm>
 #include "global.h"
 
 typedef Global::uint uint;
@@ -11,11 +15,57 @@ typedef Global::real real;
 /**
  * Rappresenta un dataset di istanze della forma <id,inputs,outputs>. Con il
  * metodo load si puo` indicare il nome di un file (in formato csv) da dove
- * caricare le istanze.
+ * caricare le istanze: il file viene mappato in memoria e analizzato senza
+ * copie intermedie; con i metodi getLoadBytes e getLoadTime si possono leggere
+ * la dimensione del file e il tempo impiegato per caricarlo. I file grandi
+ * vengono divisi in blocchi di righe analizzati in parallelo (vedere il metodo
+ * setLoadThreads); l'ordine delle istanze e` sempre quello del file.
+ * Con il metodo loadBlock si puo` caricare solamente un blocco del file, per
+ * leggere file piu` grandi della memoria disponibile (vedere DatasetStream).
+ * Con il metodo saveBinary il dataset viene salvato in un formato binario (che
+ * il metodo load riconosce e carica senza analisi del testo) con il seguente
+ * formato:
+ *   header (64 bytes): magic, versione, precisione (bits per valore), numero
+ *     di istanze, di inputs e di outputs, dimensione degli ids, checksum
+ *   matrice degli inputs (istanza per istanza)
+ *   matrice degli outputs (istanza per istanza)
+ *   posizioni degli ids (numero di istanze + 1)
+ *   ids (concatenati)
+ * Le sezioni iniziano a indirizzi allineati a 64 bytes. Il checksum (dei bytes
+ * dopo l'header) viene controllato solo dal metodo checkBinary.
+ * Le istanze sono memorizzate per colonne: tutti gli inputs in un'unica matrice
+ * (istanza per istanza) di dimensione N x ninputs, tutti gli outputs in una
+ * matrice N x noutputs e tutti gli ids concatenati in un'unica stringa (con la
+ * posizione di ognuno), senza allocazioni per le singole istanze. Le matrici
+ * sono condivise tra le copie del dataset (la copia non duplica i dati) e, per
+ * un file binario a 64 bits, sono direttamente quelle del file mappato in
+ * memoria (senza copie).
  * Con altri metodi e` possibile accedere alle varie istanze (all'id, agli
- * inputs o agli outputs). Con il metodo randomShuffle si crea una permutazione
- * casuale delle istanze; con il metodo restore si ripristina l'ordine
- * originale delle istanze.
+ * inputs o agli outputs), restituite come viste (Instance e Values) sulle
+ * righe delle matrici, valide finche' il dataset non viene modificato. Con il
+ * metodo randomShuffle si crea una permutazione casuale delle istanze; con il
+ * metodo restore si ripristina l'ordine originale delle istanze.
+ * Poiche' i riordinamenti cambiano solo l'ordine di accesso, e non la
+ * posizione in memoria delle istanze, con il metodo gatherTrainingSet si puo`
+ * copiare il training set, nell'ordine corrente, in matrici contigue, e con
+ * il metodo randomShuffleTrainingSet si possono riordinare le istanze a
+ * blocchi di istanze vicine in memoria.
+ * Con il metodo setColumns si possono selezionare le colonne dei file csv da
+ * caricare (ad esempio poche centinaia di features da un file con migliaia di
+ * colonne): le colonne escluse vengono saltate durante l'analisi delle righe,
+ * senza essere convertite in numeri.
+ * Con il metodo setStoragePrecision gli inputs vengono memorizzati con una
+ * precisione ridotta (float a 32 bits, half a 16 bits o interi a 8 bits con
+ * una trasformazione affine per colonna), per mantenere in memoria dataset
+ * piu` grandi: le viste sugli inputs (Values) vengono convertite in reali
+ * solo quando vengono copiate (vedere Values::copy), ad esempio nella copia
+ * del training set (gatherTrainingSet) o nei batch del Prefetcher.
+ * Con il metodo setCacheDirectory i file csv caricati vengono salvati in
+ * formato binario in una directory di cache (ad esempio /dev/shm, in memoria
+ * condivisa), da cui vengono poi mappati in memoria: i processi che caricano
+ * lo stesso file condividono le stesse pagine (a 64 bits, o a 32 bits con
+ * gli inputs memorizzati come float) e mantengono solo i propri vettori di
+ * accesso (partizioni e permutazioni).
  * Con il metodo setFolds e` possibile dividere il dataset in partizioni uguali
  * e impostarne una come validation set con il metodo setValidationFold. Con i
  * metodi trAt e vaAt is puo` accedere agli elementi del training set e del
@@ -27,13 +77,81 @@ class Dataset
     Dataset();
     virtual ~Dataset() { }
 
+    /**
+     * Vista (costante) su una riga di una matrice del dataset: gli inputs o
+     * gli outputs di un'istanza. Se gli inputs sono memorizzati con una
+     * precisione ridotta (vedere setStoragePrecision) la vista e` compressa:
+     * i metodi data() senza parametri, begin ed end sono validi solo per le
+     * viste non compresse, mentre copy e data(buffer) convertono i valori in
+     * reali (senza copie per le viste non compresse).
+     */
+    class Values {
+      public:
+        Values ( const real* values, uint n ) :
+            values(values), packed(NULL), n(n), bits(64), affine(NULL) { }
+        Values ( const unsigned char* packed, uint n, uint bits,
+            const real* affine ) :
+            values(NULL), packed(packed), n(n), bits(bits), affine(affine) { }
+        const real* data ( ) const { return values; }
+        const real* data ( std::vector<real>& buffer ) const {
+          if (packed == NULL) return values;
+          buffer.resize(n);
+          decode(buffer.data());
+          return buffer.data();
+        }
+        real* copy ( real* dest ) const {
+          if (packed == NULL) return std::copy(values, values + n, dest);
+          decode(dest);
+          return dest + n;
+        }
+        const real* begin ( ) const { return values; }
+        const real* end ( ) const { return values + n; }
+        uint size ( ) const { return n; }
+        bool empty ( ) const { return n == 0; }
+        bool isPacked ( ) const { return packed != NULL; }
+        real operator[] ( uint i ) const {
+          return (packed == NULL) ? values[i] : decode(i);
+        }
+      private:
+        const real* values;
+        const unsigned char* packed; // valori compressi (bits per valore)
+        uint n, bits;
+        const real* affine; // offset e passo di ogni colonna (8 bits)
+
+        void decode ( real* dest ) const;
+        real decode ( uint i ) const;
+    };
+
+    /**
+     * Vista su un'istanza del dataset: id, inputs e outputs.
+     */
     struct Instance {
-      std::string id;
-      std::vector<real> input;
-      std::vector<real> output;
+      std::string_view id;
+      Values input;
+      Values output;
     };
 
+    static void setLoadThreads ( uint n );
+    static uint getLoadThreads ( );
+    static void setColumns ( const std::string& spec );
+    static const std::vector<uint>& getColumns ( );
+    static void setStoragePrecision ( uint bits );
+    static uint getStoragePrecision ( );
+    static void setCacheDirectory ( const std::string& dir );
+    static const std::string& getCacheDirectory ( );
+    static std::string getCacheName ( const std::string& filename,
+        uint ninputs, uint noutputs );
+    static bool isBinary ( const std::string& filename );
+    static bool checkBinary ( const std::string& filename );
+    static uint getNumberOfBlocks ( const std::string& filename,
+        std::size_t blockbytes );
+    static std::shared_ptr<const char> mapFile ( const std::string& filename,
+        std::size_t& size );
     void load ( const std::string& filename, uint ninputs, uint noutputs );
+    void loadBlock ( const std::string& filename, uint ninputs,
+        uint noutputs, uint k, std::size_t blockbytes );
+    void select ( const std::vector<uint>& indices );
+    void saveBinary ( const std::string& filename, uint precision = 64 ) const;
     void setFolds ( uint n );
     void setValidationFold ( uint k );
     void merge ( );
@@ -43,22 +161,97 @@ class Dataset
     uint getFoldSize ( uint i ) const;
     uint getTrSetSize ( ) const;
     uint getVaSetSize ( ) const;
-    const std::string& getId ( uint i ) const;
-    const std::vector<real>& getInputs ( uint i ) const;
-    const std::vector<real>& getOutputs ( uint i ) const;
-    const Instance& trAt ( uint i );
-    const Instance& vaAt ( uint i );
-    const Instance& at ( uint i ) const;
-    const Instance& operator[] ( uint i ) const;
-    void randomShuffleTrainingSet ( );
-    void randomShuffle ( );
+    std::size_t getLoadBytes ( ) const;
+    double getLoadTime ( ) const;
+    uint getNumberOfInputs ( ) const;
+    uint getNumberOfOutputs ( ) const;
+    uint getInputsPrecision ( ) const;
+    std::size_t getInputsBytes ( ) const;
+    std::string getId ( uint i ) const;
+    Values getInputs ( uint i ) const;
+    Values getOutputs ( uint i ) const;
+    void setInputs ( const std::vector<real>& inputs, uint ninputs );
+    void setInputs ( const std::shared_ptr<const real>& inputs,
+        uint ninputs );
+    Instance trAt ( uint i );
+    Instance vaAt ( uint i );
+    Instance at ( uint i ) const;
+    Instance operator[] ( uint i ) const;
+    void randomShuffleTrainingSet ( Random& random = Global::getRandom(),
+        uint blockrows = 0 );
+    void gatherTrainingSet ( std::vector<real>& inputs,
+        std::vector<real>& outputs, uint threads = 1 ) const;
+    void randomShuffle ( Random& random = Global::getRandom() );
     void restore ( );
+    void getAccessVectors ( std::vector<uint>& av,
+        std::vector<uint>& trav ) const;
+    void setAccessVectors ( const std::vector<uint>& av,
+        const std::vector<uint>& trav );
 
   private:
-    std::vector<Instance> dataset;
+    static uint loadthreads;
+    static std::vector<uint> columns; // colonne selezionate (in ordine)
+    static std::vector<uint> colslot; // posizione (+1) di ogni colonna
+    static uint storagebits; // precisione degli inputs caricati
+    static std::string cachedir; // directory della cache dei file csv
+    static const std::size_t MIN_CHUNK;
+    static const std::size_t MIN_GATHER;
+    static const char MAGIC[8];
+    static const uint VERSION;
+
+    struct BinaryHeader {
+      char magic[8];
+      uint version, precision;
+      unsigned long long rows;
+      uint ninputs, noutputs;
+      unsigned long long idbytes, checksum;
+      char reserved[16];
+    };
+    /**
+     * Blocco di istanze lette da un file csv (vedere il metodo parseChunk).
+     */
+    struct Chunk {
+      std::vector<real> inputs, outputs;
+      std::string ids;
+      std::vector<unsigned long long> idpos;
+      std::exception_ptr error; // errore dell'analisi (vedere parseChunk)
+    };
+    // dati (condivisi tra le copie del dataset)
+    std::size_t rows;
+    uint ninputs, noutputs;
+    std::shared_ptr<const real> inputs; // matrice rows x ninputs
+    std::shared_ptr<const unsigned char> packed; // inputs compressi
+    std::shared_ptr<const real> affine; // offset e passo (inputs a 8 bits)
+    uint inbits; // bits per input (64 se non compressi)
+    std::shared_ptr<const real> outputs; // matrice rows x noutputs
+    std::shared_ptr<const char> ids; // ids concatenati
+    std::shared_ptr<const unsigned long long> idpos; // posizioni (rows + 1)
     std::vector<uint> av; // access vector
     std::vector<uint> trav; // training set access vector
     uint folds, vafold;
+    std::size_t loadbytes;
+    double loadtime;
+
+    void loadCached ( const std::string& filename, uint ninputs,
+        uint noutputs );
+    static bool isValidCache ( const std::string& cache, uint ninputs,
+        uint noutputs );
+    void loadText ( const char* data, std::size_t size );
+    void packInputs ( const std::vector<const real*>& parts,
+        const std::vector<std::size_t>& sizes );
+    void loadBinary ( const std::shared_ptr<const char>& map,
+        std::size_t size, std::size_t first, std::size_t last );
+    static std::size_t getBlockRows ( const BinaryHeader& header,
+        std::size_t blockbytes );
+    static const char* lineStart ( const char* data, std::size_t size,
+        std::size_t pos );
+    static void getBinaryLayout ( const BinaryHeader& header,
+        std::size_t offsets[4] );
+    static void parseChunk ( const char* first, const char* last,
+        uint ninputs, uint noutputs, Chunk* chunk );
+    static void parseLine ( const char* first, const char* last,
+        uint ninputs, uint noutputs, Chunk& chunk );
+    Instance row ( uint r ) const;
 
     void makeTrAccessVector();
     uint startIndexFold(uint k) const;
@@ -0,0 +1,224 @@
+#include "datasetstream.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "global.h"
+#include "dataset.h"
+#include "random.h"
+
+typedef Global::uint uint;
+
+/**
+ * Constructor DatasetStream
+ *
+ * Costruisce un oggetto DatasetStream che legge il file passato (con istanze
+ * di ninputs inputs e noutputs outputs) a blocchi di blockbytes bytes, nell'
+ * ordine del file e con un solo fold (l'intero dataset e` il training set).
+ */
+DatasetStream::DatasetStream(const std::string& filename, uint ninputs,
+    uint noutputs, std::size_t blockbytes) :
+    filename(filename),
+    ninputs(ninputs), noutputs(noutputs),
+    blockbytes(blockbytes),
+    cursor(0),
+    shuffled(false),
+    shufkey(0),
+    folds(1), vafold(0),
+    foldsizes(1, 0),
+    counts(1, 0)
+{
+  order.resize(Dataset::getNumberOfBlocks(filename, blockbytes));
+  for (uint k = 0; k < order.size(); ++k) order[k] = k;
+} // End constructor
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method setFolds
+ *
+ * Divide il dataset in n folds (vedere la documentazione della classe), con il
+ * primo come validation set; se n e` 1 non c'e` validation set. Le dimensioni
+ * dei folds vengono azzerate (fino alla prossima lettura completa).
+ */
+void DatasetStream::setFolds(uint n) {
+  if (n == 0) throw std::out_of_range("In DatasetStream::setFolds");
+  folds = n;
+  vafold = 0;
+  foldsizes.assign(n, 0);
+  rewind();
+  return;
+} // End method setFolds
+
+/**
+ * Method setValidationFold
+ *
+ * Imposta il fold k (0 <= k < n, con n il numero di folds) come validation set.
+ */
+void DatasetStream::setValidationFold(uint k) {
+  if (k >= folds)
+    throw std::out_of_range("In DatasetStream::setValidationFold");
+  vafold = k;
+  rewind();
+  return;
+} // End method setValidationFold
+
+/**
+ * Method shuffle
+ *
+ * Crea, con il generatore di numeri casuali passato, un ordine casuale dei
+ * blocchi e un seme per l'ordine casuale delle istanze del training set all'
+ * interno di ogni blocco letto (utilizzati da tutte le letture successive,
+ * fino alla prossima invocazione).
+ */
+void DatasetStream::shuffle(Random& random) {
+  for (uint i = order.size(); i != 0; --i)
+    std::swap( order[i-1], order[random.uniform(i)] );
+  shufkey = random.next();
+  shuffled = true;
+  rewind();
+  return;
+} // End method shuffle
+
+/**
+ * Method rewind
+ *
+ * Ricomincia la lettura dal primo blocco.
+ */
+void DatasetStream::rewind() {
+  cursor = 0;
+  counts.assign(folds, 0);
+  return;
+} // End method rewind
+
+/**
+ * Method next
+ *
+ * Legge nel dataset block le istanze del training set (o, se validation e`
+ * true, del validation set) contenute nel prossimo blocco del file, saltando
+ * i blocchi che non ne contengono. Restituisce false (senza modificare block)
+ * se tutti i blocchi sono gia` stati letti (vedere il metodo rewind).
+ */
+bool DatasetStream::next(Dataset& block, bool validation) {
+  while (cursor < order.size()) {
+    const uint k = order[cursor];
+    block.loadBlock(filename, ninputs, noutputs, k, blockbytes);
+    // seleziona le istanze richieste, contando le istanze di ogni fold
+    std::vector<uint> selected;
+    selected.reserve(block.getSize());
+    for (uint i = 0; i < block.getSize(); ++i) {
+      uint fold = getFold(block[i].id, folds);
+      ++counts[fold];
+      if ((folds > 1 && fold == vafold) == validation) selected.push_back(i);
+    }
+    if (selected.size() != block.getSize()) block.select(selected);
+    if (++cursor == order.size()) foldsizes = counts;
+    if (block.isEmpty()) continue;
+    if (shuffled && !validation) {
+      Random random(shufkey, k);
+      block.randomShuffle(random);
+    }
+    return true;
+  }
+  return false;
+} // End method next
+
+/**
+ * Method getFileName
+ *
+ * Restituisce il nome del file letto.
+ */
+const std::string& DatasetStream::getFileName() const {
+  return filename;
+} // End method getFileName
+
+/**
+ * Method getBlockBytes
+ *
+ * Restituisce la dimensione (in bytes) dei blocchi.
+ */
+std::size_t DatasetStream::getBlockBytes() const {
+  return blockbytes;
+} // End method getBlockBytes
+
+/**
+ * Method getNumberOfBlocks
+ *
+ * Restituisce il numero di blocchi in cui e` diviso il file.
+ */
+uint DatasetStream::getNumberOfBlocks() const {
+  return order.size();
+} // End method getNumberOfBlocks
+
+/**
+ * Method getFolds
+ *
+ * Restituisce il numero di folds impostati.
+ */
+uint DatasetStream::getFolds() const {
+  return folds;
+} // End method getFolds
+
+/**
+ * Method getFoldSize
+ *
+ * Restituisce il numero di istanze dell'i-esimo fold contate nell'ultima
+ * lettura completa del file (0 prima della prima lettura completa).
+ */
+uint DatasetStream::getFoldSize(uint i) const {
+  if (i >= folds) throw std::out_of_range("In DatasetStream::getFoldSize");
+  return foldsizes[i];
+} // End method getFoldSize
+
+/**
+ * Method getSize
+ *
+ * Restituisce il numero di istanze del dataset contate nell'ultima lettura
+ * completa del file.
+ */
+uint DatasetStream::getSize() const {
+  uint size = 0;
+  for (uint i = 0; i < folds; ++i) size += foldsizes[i];
+  return size;
+} // End method getSize
+
+/**
+ * Method getVaSetSize
+ *
+ * Restituisce il numero di istanze del validation set contate nell'ultima
+ * lettura completa del file (0 se c'e` un solo fold).
+ */
+uint DatasetStream::getVaSetSize() const {
+  if (folds <= 1) return 0;
+  return foldsizes[vafold];
+} // End method getVaSetSize
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Method getFold
+ *
+ * Restituisce il fold (tra 0 e folds-1) dell'istanza con l'id passato: il
+ * checksum FNV-1a a 64 bit dell'id modulo il numero di folds. I bits bassi del
+ * checksum dipendono quasi solo dagli ultimi caratteri dell'id (per ids
+ * sequenziali il fold sarebbe determinato dall'ultima cifra), percui prima del
+ * modulo vengono mescolati con il finalizzatore di MurmurHash3.
+ */
+uint DatasetStream::getFold(std::string_view id, uint folds) {
+  if (folds <= 1) return 0;
+  unsigned long long hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < id.size(); ++i) {
+    hash ^= (unsigned char) id[i];
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash % folds;
+} // End method getFold
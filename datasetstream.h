@@ -0,0 +1,72 @@
+#ifndef DATASETSTREAM_H_
+#define DATASETSTREAM_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "global.h"
+#include "dataset.h"
+
+typedef Global::uint uint;
+
+/**
+ * Class DatasetStream
+ *
+ * Legge un dataset a blocchi, senza caricarlo interamente in memoria, per il
+ * training su file piu` grandi della memoria disponibile (vedere il metodo
+ * Trainer::setDataStream). Il file (csv o binario, vedere la classe Dataset)
+ * viene diviso in blocchi di dimensione fissata (vedere Dataset::loadBlock):
+ * con il metodo next si legge il blocco successivo, come oggetto Dataset con
+ * le sole istanze del training set o del validation set, e in memoria resta
+ * un solo blocco alla volta.
+ * Le istanze vengono assegnate ai folds in modo deterministico in base all'id:
+ * l'istanza con id x appartiene al fold h(x) mod n, con h il checksum FNV-1a
+ * (mescolato) dell'id e n il numero di folds, indipendentemente dall'ordine
+ * di lettura dei blocchi; gli ids devono quindi essere univoci e i folds hanno
+ * dimensioni solo approssimativamente uguali.
+ * Con il metodo shuffle si crea un ordine casuale dei blocchi e delle istanze
+ * del training set all'interno di ogni blocco (il blocco fa da shuffle
+ * buffer), mantenuto fino alla successiva invocazione. L'ordine delle istanze
+ * di un blocco e` generato da una sottosequenza casuale propria del blocco
+ * (vedere la classe Random), quindi non dipende dall'ordine di lettura ne'
+ * dal thread che legge il blocco.
+ * Il numero di istanze di ogni fold viene contato durante la lettura dei
+ * blocchi ed e` disponibile dopo la prima lettura completa del file.
+ */
+class DatasetStream
+{
+  public:
+    DatasetStream ( const std::string& filename, uint ninputs, uint noutputs,
+        std::size_t blockbytes );
+    virtual ~DatasetStream ( ) { }
+
+    void setFolds ( uint n );
+    void setValidationFold ( uint k );
+    void shuffle ( Random& random = Global::getRandom() );
+    void rewind ( );
+    bool next ( Dataset& block, bool validation );
+    const std::string& getFileName ( ) const;
+    std::size_t getBlockBytes ( ) const;
+    uint getNumberOfBlocks ( ) const;
+    uint getFolds ( ) const;
+    uint getFoldSize ( uint i ) const;
+    uint getSize ( ) const;
+    uint getVaSetSize ( ) const;
+
+  private:
+    std::string filename;
+    uint ninputs, noutputs;
+    std::size_t blockbytes;
+    std::vector<uint> order; // ordine di lettura dei blocchi
+    uint cursor; // prossimo blocco da leggere
+    bool shuffled;
+    unsigned long long shufkey; // seme per l'ordine delle istanze nei blocchi
+    uint folds, vafold;
+    std::vector<uint> foldsizes; // dimensioni dei folds (ultima lettura)
+    std::vector<uint> counts; // istanze per fold (lettura corrente)
+
+    static uint getFold ( std::string_view id, uint folds );
+
+}; // End class DatasetStream
+
+#endif /* DATASETSTREAM_H_ */
@@ -0,0 +1,186 @@
+#include "ensemble.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include "global.h"
+#include "exception.h"
+#include "neuralnetwork.h"
+#include "unit.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+// =====================
+// PUBLIC STATIC MEMBERS
+// =====================
+
+const uint Ensemble::BLOCK = 64;
+
+/**
+ * Constructor Ensemble
+ *
+ * Costruisce un ensemble vuoto (senza reti).
+ */
+Ensemble::Ensemble() :
+    nmodels(0), ninputs(0)
+{ } // End constructor
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method add
+ *
+ * Aggiunge all'ensemble una copia dei pesi della rete passata. La rete deve
+ * avere la stessa topologia (inputs, strati e unita` per strato) delle reti
+ * gia` aggiunte, altrimenti viene lanciata un'eccezione invalid_argument.
+ */
+void Ensemble::add(const NeuralNetwork& model) {
+  if (nmodels == 0) {
+    ninputs = model.getNumberOfInputs();
+    units.resize(model.getNumberOfLayers());
+    for (uint l = 0; l < units.size(); ++l)
+      units[l] = model.getNumberOfUnits(l);
+    layers.resize(units.size());
+  }
+  // controlla la topologia
+  bool same = model.getNumberOfInputs() == ninputs &&
+      model.getNumberOfLayers() == units.size();
+  for (uint l = 0; same && l < units.size(); ++l)
+    same = model.getNumberOfUnits(l) == units[l];
+  if (!same) throw std::invalid_argument("In Ensemble::add");
+  // accoda i pesi di ogni strato
+  for (uint l = 0; l < units.size(); ++l)
+    for (uint u = 0; u < units[l]; ++u)
+      for (uint w = 0; w < model.getNumberOfWeight(l, u); ++w)
+        layers[l].push_back(model.getWeight(l, u, w));
+  ++nmodels;
+  return;
+} // End method add
+
+/**
+ * Method load
+ *
+ * Aggiunge all'ensemble le k reti salvate nei file prefix-1, ..., prefix-k
+ * (i files prodotti da NNTraining con il parametro --nnsave).
+ */
+void Ensemble::load(const std::string& prefix, uint k) {
+  for (uint i = 1; i <= k; ++i) {
+    NeuralNetwork nn;
+    nn.loadFromFile(prefix + "-" + Global::toString(i));
+    add(nn);
+  }
+  return;
+} // End method load
+
+/**
+ * Method getNumberOfModels
+ *
+ * Restituisce il numero di reti nell'ensemble.
+ */
+uint Ensemble::getNumberOfModels() const {
+  return nmodels;
+} // End method getNumberOfModels
+
+/**
+ * Method getNumberOfInputs
+ *
+ * Restituisce il numero di inputs delle reti.
+ */
+uint Ensemble::getNumberOfInputs() const {
+  return ninputs;
+} // End method getNumberOfInputs
+
+/**
+ * Method getNumberOfOutputs
+ *
+ * Restituisce il numero di outputs delle reti.
+ */
+uint Ensemble::getNumberOfOutputs() const {
+  return units.empty() ? 0 : units.back();
+} // End method getNumberOfOutputs
+
+/**
+ * Method getNumberOfLayers
+ *
+ * Restituisce il numero di strati (nascosti e di output) delle reti.
+ */
+uint Ensemble::getNumberOfLayers() const {
+  return units.size();
+} // End method getNumberOfLayers
+
+/**
+ * Method getNumberOfUnits
+ *
+ * Restituisce il numero di unita` dello strato layer delle reti.
+ */
+uint Ensemble::getNumberOfUnits(uint layer) const {
+  if (layer >= units.size())
+    throw std::out_of_range("In Ensemble::getNumberOfUnits");
+  return units[layer];
+} // End method getNumberOfUnits
+
+/**
+ * Method compute
+ *
+ * Calcola la risposta dell'ensemble sulle n istanze in inputs (una dopo
+ * l'altra, ognuna con getNumberOfInputs valori) e la scrive in outputs (una
+ * dopo l'altra, ognuna con getNumberOfOutputs valori): per ogni istanza
+ * l'output e` la media degli outputs delle reti. Le istanze vengono valutate
+ * a blocchi di BLOCK istanze, calcolando per ogni blocco tutte le reti strato
+ * per strato.
+ */
+void Ensemble::compute(const std::vector<real>& inputs, uint n,
+    std::vector<real>& outputs) {
+  compute(inputs, n, outputs, workspace);
+  return;
+} // End method compute
+
+/**
+ * Method compute
+ *
+ * Come il metodo precedente, ma utilizza i buffers del workspace passato
+ * invece di quelli dell'ensemble, che non viene modificato.
+ */
+void Ensemble::compute(const std::vector<real>& inputs, uint n,
+    std::vector<real>& outputs, Workspace& workspace) const {
+  assert( nmodels > 0 && inputs.size() >= std::size_t(n) * ninputs );
+  const uint noutputs = getNumberOfOutputs();
+  const uint maxunits = *std::max_element(units.begin(), units.end());
+  std::vector<real>& bufin = workspace.bufin;
+  std::vector<real>& bufout = workspace.bufout;
+  bufin.resize(BLOCK * maxunits);
+  bufout.resize(BLOCK * maxunits);
+  outputs.assign(std::size_t(n) * noutputs, 0.0);
+  for (uint first = 0; first < n; first += BLOCK) {
+    const uint size = std::min(BLOCK, n - first);
+    for (uint m = 0; m < nmodels; ++m) {
+      // il primo strato legge direttamente le istanze del blocco
+      const real* in = &inputs[std::size_t(first) * ninputs];
+      uint nin = ninputs;
+      for (uint l = 0; l < units.size(); ++l) {
+        real* out = (l % 2 == 0) ? &bufout[0] : &bufin[0];
+        const real* w = &layers[l][std::size_t(m) * units[l] * (nin+1)];
+        for (uint u = 0; u < units[l]; ++u, w += nin+1)
+          for (uint i = 0; i < size; ++i) {
+            const real* x = in + std::size_t(i) * nin;
+            real net = w[0];
+            for (uint j = 0; j < nin; ++j) net += w[j+1] * x[j];
+            out[i*units[l] + u] = Unit::activationFunction(net);
+          }
+        in = out;
+        nin = units[l];
+      } // end for l
+      // somma gli outputs della rete
+      real* sum = &outputs[std::size_t(first) * noutputs];
+      for (uint i = 0; i < size * noutputs; ++i) sum[i] += in[i];
+    } // end for m
+  } // end for first
+  // calcola la media
+  for (std::size_t i = 0; i < outputs.size(); ++i) outputs[i] /= nmodels;
+  return;
+} // End method compute
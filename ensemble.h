@@ -0,0 +1,67 @@
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <string>
+#include <vector>
+#include "global.h"
+#include "neuralnetwork.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class Ensemble
+ *
+ * Rappresenta un insieme di reti neurali con la stessa topologia (ad esempio
+ * le reti prodotte dal training sui diversi folds, vedere NNTraining) la cui
+ * risposta e` la media delle risposte delle singole reti.
+ * I pesi di tutte le reti vengono impacchettati, strato per strato, in un
+ * unico vettore per strato:
+ *   layer(l) = rete(1) unita`(1..n(l)), ..., rete(k) unita`(1..n(l))
+ * dove i pesi di ogni unita` sono w0 (bias), w1, ..., wm come nella classe
+ * Unit. Con il metodo compute le istanze vengono valutate a blocchi (di BLOCK
+ * istanze): per ogni blocco tutte le reti vengono calcolate sulle stesse
+ * istanze (che restano in cache) e i loro outputs sommati, senza passare
+ * dalle strutture (unita` e inputs memorizzati) della classe NeuralNetwork.
+ * Gli outputs di ogni rete sono identici a quelli calcolati dal metodo
+ * NeuralNetwork::compute.
+ * Il metodo compute con un oggetto Workspace non modifica l'ensemble, per cui
+ * piu` threads possono valutare istanze diverse con gli stessi pesi, ognuno
+ * con il proprio workspace (vedere Tester::setThreads).
+ */
+class Ensemble
+{
+  public:
+    Ensemble ( );
+    virtual ~Ensemble ( ) { }
+
+    static const uint BLOCK;
+
+    /**
+     * Buffers per gli outputs degli strati di un blocco di istanze.
+     */
+    struct Workspace {
+      std::vector<real> bufin, bufout;
+    };
+
+    void add ( const NeuralNetwork& model );
+    void load ( const std::string& prefix, uint k );
+    uint getNumberOfModels ( ) const;
+    uint getNumberOfInputs ( ) const;
+    uint getNumberOfOutputs ( ) const;
+    uint getNumberOfLayers ( ) const;
+    uint getNumberOfUnits ( uint layer ) const;
+    void compute ( const std::vector<real>& inputs, uint n,
+        std::vector<real>& outputs );
+    void compute ( const std::vector<real>& inputs, uint n,
+        std::vector<real>& outputs, Workspace& workspace ) const;
+
+  private:
+    uint nmodels, ninputs;
+    std::vector<uint> units;
+    std::vector< std::vector<real> > layers;
+    Workspace workspace;
+
+}; // End class Ensemble
+
+#endif /* ENSEMBLE_H_ */
@@ -0,0 +1,253 @@
+#include "frozenlayers.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <memory>
+#include "global.h"
+#include "exception.h"
+#include "atomicfile.h"
+#include "neuralnetwork.h"
+#include "dataset.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+const char FrozenLayers::MAGIC[8] = { 'N', 'N', 'F', 'R', 'O', 'Z', 'N', '\0' };
+
+// =================
+// RELATED FUNCTIONS
+// =================
+
+/**
+ * Function copyLayers
+ *
+ * Copia i pesi di n strati della rete from, a partire dallo strato ffirst,
+ * negli n strati della rete to a partire dallo strato tfirst (gli strati
+ * devono avere lo stesso numero di unita` e di pesi).
+ */
+static void copyLayers(const NeuralNetwork& from, uint ffirst,
+    NeuralNetwork& to, uint tfirst, uint n) {
+  for (uint l = 0; l < n; ++l)
+    for (uint u = 0; u < from.getNumberOfUnits(ffirst+l); ++u)
+      for (uint w = 0; w < from.getNumberOfWeight(ffirst+l, u); ++w)
+        to.setWeight(tfirst+l, u, w, from.getWeight(ffirst+l, u, w));
+  return;
+} // End function copyLayers
+
+/**
+ * Function checksum
+ *
+ * Aggiorna il checksum hash (FNV-1a a 64 bit) con i bytes passati.
+ */
+static unsigned long long checksum(unsigned long long hash, const void* data,
+    std::size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+} // End function checksum
+
+/**
+ * Constructor FrozenLayers
+ *
+ * Costruisce un oggetto FrozenLayers che congela i primi k strati della rete
+ * passata (di cui viene mantenuta una copia); k deve essere compreso tra 1 e il
+ * numero di strati nascosti (lo strato di output non puo` essere congelato).
+ * Per il training con la classe BackPropagation devono restare almeno due
+ * strati non congelati.
+ */
+FrozenLayers::FrozenLayers(const NeuralNetwork& model, uint k) :
+    bottom(NULL),
+    top(NULL),
+    nlayers(k)
+{
+  if (k == 0 || k >= model.getNumberOfLayers())
+    throw std::invalid_argument("In FrozenLayers::FrozenLayers");
+  std::vector<uint> units, topunits;
+  for (uint l = 0; l < model.getNumberOfLayers(); ++l)
+    (l < k ? units : topunits).push_back(model.getNumberOfUnits(l));
+  bottom = new NeuralNetwork(model.getNumberOfInputs(), k, units);
+  copyLayers(model, 0, *bottom, 0, k);
+  top = new NeuralNetwork(units.back(), topunits.size(), topunits);
+  copyLayers(model, k, *top, 0, topunits.size());
+} // End constructor
+
+/**
+ * Destructor ~FrozenLayers
+ */
+FrozenLayers::~FrozenLayers() {
+  delete bottom;
+  delete top;
+}
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method getNumberOfLayers
+ *
+ * Restituisce il numero di strati congelati.
+ */
+uint FrozenLayers::getNumberOfLayers() const {
+  return nlayers;
+} // End method getNumberOfLayers
+
+/**
+ * Method makeTopModel
+ *
+ * Costruisce (allocandola) una rete neurale con gli strati non congelati, i
+ * cui inputs sono gli outputs dell'ultimo strato congelato, con i pesi della
+ * rete passata al costruttore.
+ */
+NeuralNetwork* FrozenLayers::makeTopModel() const {
+  std::vector<uint> units;
+  for (uint l = 0; l < top->getNumberOfLayers(); ++l)
+    units.push_back(top->getNumberOfUnits(l));
+  NeuralNetwork* model = new NeuralNetwork(top->getNumberOfInputs(),
+      top->getNumberOfLayers(), units);
+  model->copyWeights(*top);
+  return model;
+} // End method makeTopModel
+
+/**
+ * Method setTopModel
+ *
+ * Copia i pesi della rete trained (costruita con makeTopModel) negli strati
+ * non congelati della rete model (con la topologia della rete passata al
+ * costruttore). I pesi degli strati congelati vengono ripristinati.
+ */
+void FrozenLayers::setTopModel(const NeuralNetwork& trained,
+    NeuralNetwork& model) const {
+  copyLayers(*bottom, 0, model, 0, nlayers);
+  copyLayers(trained, 0, model, nlayers, top->getNumberOfLayers());
+  return;
+} // End method setTopModel
+
+/**
+ * Method computeActivations
+ *
+ * Sostituisce gli inputs di ogni istanza del dataset con gli outputs dell'
+ * ultimo strato congelato, calcolati una sola volta per l'intero dataset. Se
+ * e` indicato un file di cache e questo contiene le attivazioni per gli stessi
+ * pesi e lo stesso dataset vengono lette dal file (restituendo true), che
+ * resta mappato in memoria come matrice degli inputs del dataset, altrimenti
+ * vengono calcolate e salvate nel file (restituendo false).
+ */
+bool FrozenLayers::computeActivations(Dataset& dataset,
+    const std::string& cachefile) {
+  const uint n = dataset.getSize();
+  const uint width = bottom->getNumberOfOutputs();
+  unsigned long long key = 0;
+  if (!cachefile.empty()) {
+    key = makeKey(dataset);
+    std::shared_ptr<const real> cached = loadCache(cachefile, key, n);
+    if (cached) {
+      dataset.setInputs(cached, width);
+      return true;
+    }
+  }
+  // calcola le attivazioni
+  activations.resize(std::size_t(n) * width);
+  std::vector<real> row;
+  for (uint i = 0; i < n; ++i) {
+    bottom->setInputs(dataset.getInputs(i).data(row));
+    bottom->compute();
+    std::copy(bottom->getOutputs().begin(), bottom->getOutputs().end(),
+        activations.begin() + std::size_t(i) * width);
+  }
+  if (!cachefile.empty()) saveCache(cachefile, key);
+  // sostituisce gli inputs del dataset
+  dataset.setInputs(activations, width);
+  activations.clear();
+  return false;
+} // End method computeActivations
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method makeKey
+ *
+ * Restituisce la chiave del file di cache: il checksum dei pesi congelati e
+ * degli inputs del dataset (nell'ordine corrente).
+ */
+unsigned long long FrozenLayers::makeKey(const Dataset& dataset) const {
+  unsigned long long hash = 14695981039346656037ULL;
+  std::vector<real> weights;
+  bottom->getWeights(weights);
+  hash = checksum(hash, &weights[0], weights.size() * sizeof(real));
+  std::vector<real> row;
+  for (uint i = 0; i < dataset.getSize(); ++i) {
+    const Dataset::Values in = dataset.getInputs(i);
+    if (!in.empty())
+      hash = checksum(hash, in.data(row), in.size() * sizeof(real));
+  }
+  return hash;
+} // End method makeKey
+
+/**
+ * Method loadCache
+ *
+ * Mappa in memoria il file di cache (vedere Dataset::mapFile) e restituisce
+ * il puntatore alla matrice delle attivazioni, che mantiene la mappatura.
+ * Restituisce un puntatore nullo se il file non esiste o non corrisponde (per
+ * chiave o dimensioni) al dataset di n istanze.
+ */
+std::shared_ptr<const real> FrozenLayers::loadCache(
+    const std::string& filename, unsigned long long key, uint n) const {
+  const uint width = bottom->getNumberOfOutputs();
+  std::size_t size = 0;
+  std::shared_ptr<const char> map;
+  try {
+    map = Dataset::mapFile(filename, size);
+  }
+  catch (const file_error&) {
+    return std::shared_ptr<const real>();
+  }
+  if (size != sizeof(CacheHeader) + std::size_t(n) * width * sizeof(real))
+    return std::shared_ptr<const real>();
+  CacheHeader header;
+  std::memcpy(&header, map.get(), sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.rows != n || header.width != width || header.key != key)
+    return std::shared_ptr<const real>();
+  return std::shared_ptr<const real>(map,
+      reinterpret_cast<const real*>(map.get() + sizeof(CacheHeader)));
+} // End method loadCache
+
+/**
+ * Method saveCache
+ *
+ * Scrive le attivazioni nel file di cache, con la chiave passata, dopo un
+ * header di 64 bytes (percui la matrice e` allineata nel file mappato). La
+ * scrittura e` atomica (vedere la classe AtomicFile).
+ */
+void FrozenLayers::saveCache(const std::string& filename,
+    unsigned long long key) const {
+  const unsigned long long n = activations.size() /
+      bottom->getNumberOfOutputs();
+  const uint width = bottom->getNumberOfOutputs();
+  CacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.rows = n;
+  header.width = width;
+  header.key = key;
+  AtomicFile file(filename);
+  file.write(&header, sizeof(header));
+  if (!activations.empty())
+    file.write(&activations[0], activations.size() * sizeof(real));
+  file.commit();
+  return;
+} // End method saveCache
@@ -0,0 +1,69 @@
+#ifndef FROZENLAYERS_H_
+#define FROZENLAYERS_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "global.h"
+#include "neuralnetwork.h"
+#include "dataset.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class FrozenLayers
+ *
+ * Permette di addestrare solamente gli strati superiori di una rete neurale,
+ * mantenendo fissi (congelati) i pesi dei primi k strati. Poiche` i primi k
+ * strati non cambiano, le loro attivazioni (gli outputs dello strato k) su
+ * ogni istanza del dataset vengono calcolate una sola volta con il metodo
+ * computeActivations e sostituite agli inputs del dataset: il training viene
+ * poi fatto (con la classe Trainer) sulla rete formata dai soli strati
+ * superiori, costruita con il metodo makeTopModel, i cui pesi addestrati
+ * vengono ricopiati nella rete completa con il metodo setTopModel.
+ * Le attivazioni possono essere salvate in un file di cache binario:
+ *   header (64 bytes: magic, istanze, dimensione, chiave), attivazioni
+ * dove la chiave e` il checksum dei pesi congelati e degli inputs del dataset;
+ * se il file esiste e la chiave corrisponde, il file viene mappato in memoria
+ * e il dataset utilizza direttamente la matrice delle attivazioni del file
+ * (allineata a 64 bytes), senza ricalcolarle ne` copiarle (vedere
+ * Dataset::setInputs).
+ */
+class FrozenLayers
+{
+  public:
+    FrozenLayers ( const NeuralNetwork& model, uint k );
+    virtual ~FrozenLayers ( );
+
+    uint getNumberOfLayers ( ) const;
+    NeuralNetwork* makeTopModel ( ) const;
+    void setTopModel ( const NeuralNetwork& trained,
+        NeuralNetwork& model ) const;
+    bool computeActivations ( Dataset& dataset,
+        const std::string& cachefile = "" );
+
+  private:
+    static const char MAGIC[8];
+
+    struct CacheHeader {
+      char magic[8];
+      unsigned long long rows;
+      uint width, reserved0;
+      unsigned long long key;
+      char reserved[32];
+    };
+    NeuralNetwork* bottom;
+    NeuralNetwork* top;
+    uint nlayers;
+    std::vector<real> activations;
+
+    unsigned long long makeKey ( const Dataset& dataset ) const;
+    std::shared_ptr<const real> loadCache ( const std::string& filename,
+        unsigned long long key, uint n ) const;
+    void saveCache ( const std::string& filename,
+        unsigned long long key ) const;
+
+}; // End class FrozenLayers
+
+#endif /* FROZENLAYERS_H_ */
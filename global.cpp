@@ -7,6 +7,7 @@
 #include <vector>
 #include <cstdlib>
 #include <cassert>
+#include <csignal>
 #include "exception.h"
 
 typedef Global::uint uint;
@@ -17,6 +18,8 @@ typedef Global::real real;
 // ======================
 
 uint Global::rseed;
+Random Global::random;
+volatile std::sig_atomic_t Global::terminate = 0;
 std::map<std::string, std::string> Global::parameters;
 
 // =====================
@@ -218,11 +221,12 @@ bool Global::isNumeric (const std::string& value) {
 /**
  * Function setRandSeed
  *
- * Inizializza il generatore di numeri casuali con il seme passato.
+ * Inizializza il generatore di numeri casuali (vedere la classe Random) con il
+ * seme passato.
  */
 void Global::setRandSeed(uint seed) {
   rseed = seed;
-  srand(rseed);
+  random.seed(rseed);
 } // End method setRandSeed
 
 /**
@@ -237,13 +241,60 @@ uint Global::getRandSeed() {
 /**
  * Function getRand
  *
- * Restituisce un numero casuale (intero) nell'intervallo [start, end].
+ * Restituisce un numero casuale (intero) uniforme nell'intervallo
+ * [start, end].
  */
 int Global::getRand(uint start, uint end) {
   assert(start <= end);
-  return ( rand()%(end-start+1) ) + start;
+  return random.uniform((unsigned long long)(end) - start + 1) + start;
 } // End method getRand
 
+/**
+ * Function getRandom
+ *
+ * Restituisce il generatore di numeri casuali globale (utilizzato da getRand),
+ * da utilizzare da un solo thread alla volta.
+ */
+Random& Global::getRandom() {
+  return random;
+} // End method getRandom
+
+/**
+ * Function getRandStream
+ *
+ * Restituisce un nuovo generatore per la k-esima sottosequenza del seme
+ * impostato, indipendente dal generatore globale e dagli altri stream (vedere
+ * la classe Random): ad esempio un generatore per ogni fold, modello o thread,
+ * con risultati che non dipendono dall'ordine di esecuzione.
+ */
+Random Global::getRandStream(unsigned long long k) {
+  return Random(rseed, k + 1);
+} // End method getRandStream
+
+/**
+ * Function catchTermination
+ *
+ * Intercetta i segnali SIGTERM e SIGINT: invece di terminare il programma
+ * viene registrata la richiesta di terminazione, che puo` essere verificata
+ * con isTerminationRequested (ad esempio per salvare lo stato prima di
+ * uscire).
+ */
+void Global::catchTermination() {
+  std::signal(SIGTERM, requestTermination);
+  std::signal(SIGINT, requestTermination);
+  return;
+} // End method catchTermination
+
+/**
+ * Function isTerminationRequested
+ *
+ * Restituisce true se e` stato ricevuto un segnale di terminazione (vedere
+ * catchTermination).
+ */
+bool Global::isTerminationRequested() {
+  return terminate != 0;
+} // End method isTerminationRequested
+
 /**
  * Function trim
  *
@@ -278,3 +329,17 @@ std::vector<std::string>* Global::split(const std::string& str, char delim) {
   while (std::getline(stream, token, delim)) vector->push_back(token);
   return vector;
 } // End method split
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Function requestTermination
+ *
+ * Gestore dei segnali di terminazione (vedere catchTermination): registra la
+ * richiesta di terminazione.
+ */
+void Global::requestTermination(int) {
+  terminate = 1;
+} // End method requestTermination
@@ -5,6 +5,8 @@
 #include <vector>
 #include <map>
 #include <cstdlib>
+#include <csignal>
+#include "random.h"
 
 /**
  * Class Global
@@ -35,14 +37,22 @@ class Global {
     static void setRandSeed ( uint seed );
     static uint getRandSeed ( );
     static int getRand ( uint start = 0, uint end = RAND_MAX );
+    static Random& getRandom ( );
+    static Random getRandStream ( unsigned long long k );
+    static void catchTermination ( );
+    static bool isTerminationRequested ( );
     static const std::string& trim ( std::string& str, const char* t = " ");
     static std::vector<std::string>* split ( const std::string& str,
         char delim = ' ' );
 
   private:
     static uint rseed;
+    static Random random;
+    static volatile std::sig_atomic_t terminate;
     static std::map<std::string, std::string> parameters;
 
+    static void requestTermination ( int signum );
+
 }; // End class Global
 
 #endif /* GLOBAL_H_ */
@@ -2,16 +2,113 @@
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
+#include <charconv>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "global.h"
 #include "exception.h"
+#include "atomicfile.h"
 #include "unit.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
 
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+const char NeuralNetwork::MAGIC[8] =
+    { 'N', 'N', 'M', 'O', 'D', 'E', 'L', '\0' };
+const uint NeuralNetwork::VERSION = 1;
+
+// =================
+// RELATED FUNCTIONS
+// =================
+
+/**
+ * Function align
+ *
+ * Restituisce la prima posizione allineata a 64 bytes non minore di pos.
+ */
+static inline std::size_t align(std::size_t pos) {
+  return (pos + 63) / 64 * 64;
+} // End function align
+
+/**
+ * Function checksum
+ *
+ * Aggiorna il checksum (FNV-1a a 64 bit) hash con i bytes passati; senza
+ * hash restituisce il checksum dei soli bytes passati.
+ */
+static unsigned long long checksum(const char* data, std::size_t size,
+    unsigned long long hash = 14695981039346656037ULL) {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+} // End function checksum
+
+/**
+ * Function findComma
+ *
+ * Restituisce la posizione della prima virgola in [first,last), oppure last.
+ */
+static inline const char* findComma(const char* first, const char* last) {
+  const char* comma = static_cast<const char*>(
+      std::memchr(first, ',', last - first));
+  return (comma == NULL) ? last : comma;
+} // End function findComma
+
+/**
+ * Function parseUint
+ *
+ * Converte i caratteri nell'intervallo [first,last) nel corrispondente intero
+ * senza segno con std::from_chars, senza copiarli. Il risultato e` lo stesso
+ * di Global::toUint: se il campo non e` un intero semplice la conversione
+ * viene fatta con Global::toUint su una copia del campo.
+ */
+static uint parseUint(const char* first, const char* last) {
+  while (first < last && std::isspace((unsigned char) *first)) ++first;
+  uint value = 0;
+  std::from_chars_result r = std::from_chars(first, last, value);
+  if (r.ec == std::errc() && (r.ptr == last ||
+      std::isspace((unsigned char) *r.ptr)))
+    return value;
+  return Global::toUint(std::string(first, last));
+} // End function parseUint
+
+/**
+ * Function parseReal
+ *
+ * Converte i caratteri nell'intervallo [first,last) nel corrispondente numero
+ * reale con std::from_chars, senza copiarli. Il risultato e` lo stesso di
+ * Global::toReal (strtod), come in Unit::read: se il campo non e` un numero
+ * decimale semplice la conversione viene fatta con strtod su una copia del
+ * campo (vedere la funzione omonima in dataset.cpp).
+ */
+static real parseReal(const char* first, const char* last) {
+  while (first < last && std::isspace((unsigned char) *first)) ++first;
+  const char* begin = first;
+  if (begin + 1 < last && *begin == '+' && begin[1] != '-') ++begin;
+  real value = 0.0;
+  std::from_chars_result r = std::from_chars(begin, last, value);
+  if (r.ec == std::errc() && (r.ptr == last ||
+      std::isspace((unsigned char) *r.ptr) ||
+      std::strchr("xXpP", *r.ptr) == NULL))
+    return value;
+  return strtod(std::string(first, last).c_str(), NULL);
+} // End function parseReal
+
 /**
  * Constructor NeuralNetwork
  *
@@ -86,6 +183,50 @@ NeuralNetwork::~NeuralNetwork() {
   return;
 } // End destructor ~NeuralNetwork
 
+// =====================
+// PUBLIC STATIC METHODS
+// =====================
+
+/**
+ * Method isBinary
+ *
+ * Restituisce true se il file passato contiene una rete neurale in formato
+ * binario (vedere il metodo saveBinary).
+ */
+bool NeuralNetwork::isBinary(const std::string& filename) {
+  char magic[sizeof(MAGIC)];
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+} // End method isBinary
+
+/**
+ * Method checkBinary
+ *
+ * Controlla l'integrita` della rete neurale in formato binario nel file
+ * passato: restituisce true se l'header e` valido, la dimensione del file
+ * corrisponde e il checksum dei dati e` corretto.
+ */
+bool NeuralNetwork::checkBinary(const std::string& filename) {
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.is_open()) throw file_error("In NeuralNetwork::checkBinary");
+  BinaryHeader header;
+  if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION ||
+      (header.precision != 64 && header.precision != 32))
+    return false;
+  std::string body((std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+  if (body.size() < header.nlayers * sizeof(uint)) return false;
+  std::vector<uint> nunits(header.nlayers);
+  std::memcpy(nunits.data(), body.data(), nunits.size() * sizeof(uint));
+  std::vector<std::size_t> offsets;
+  return body.size() + sizeof(header) ==
+      getBinaryLayout(header, nunits.data(), offsets) &&
+      checksum(body.data(), body.size()) == header.checksum;
+} // End method checkBinary
+
 // ==============
 // PUBLIC METHODS
 // ==============
@@ -114,6 +255,18 @@ void NeuralNetwork::setInputs(const std::vector<real>& inputs) {
   return;
 } // End method setInputs
 
+/**
+ * Metod setInputs
+ *
+ * Imposta gli inputs con gli n valori a partire da quello puntato da inputs,
+ * con n il numero di inputs della rete (ad esempio una riga di un dataset,
+ * vedere la classe Dataset).
+ */
+void NeuralNetwork::setInputs(const real* inputs) {
+  std::copy(inputs, inputs + ninputs, this->inputs.begin());
+  return;
+} // End method setInputs (pointer)
+
 /**
  * Metod setWeight
  *
@@ -309,6 +462,78 @@ uint NeuralNetwork::getLayerDimension(uint i) const {
   return network->at(i)->size();
 } // End method getLayerDimension
 
+/**
+ * Metod getNumberOfWeights
+ *
+ * Restituisce il numero totale di pesi della rete neurale (sommato su tutte le
+ * unita` di tutti gli strati)
+ */
+uint NeuralNetwork::getNumberOfWeights() const {
+  uint n = 0;
+  for (uint i = 0; i < nlayers; ++i)
+    for (uint j = 0; j < network->at(i)->size(); ++j)
+      n += network->at(i)->at(j).getNumberOfWeights();
+  return n;
+} // End method getNumberOfWeights
+
+/**
+ * Metod getWeights
+ *
+ * Copia nel vettore passato tutti i pesi della rete, in ordine di strato, di
+ * unita` nello strato e di peso nell'unita`.
+ */
+void NeuralNetwork::getWeights(std::vector<real>& weights) const {
+  weights.resize(getNumberOfWeights());
+  uint k = 0;
+  for (uint i = 0; i < nlayers; ++i)
+    for (uint j = 0; j < network->at(i)->size(); ++j) {
+      const Unit& unit = network->at(i)->at(j);
+      for (uint w = 0; w < unit.getNumberOfWeights(); ++w)
+        weights[k++] = unit.getWeight(w);
+    }
+  return;
+} // End method getWeights
+
+/**
+ * Metod setWeights
+ *
+ * Imposta tutti i pesi della rete con i valori passati, nello stesso ordine
+ * del metodo getWeights. La dimensione del vettore dev'essere uguale al numero
+ * totale di pesi della rete.
+ */
+void NeuralNetwork::setWeights(const std::vector<real>& weights) {
+  if (weights.size() != getNumberOfWeights())
+    throw std::out_of_range("In NeuralNetwork::setWeights");
+  uint k = 0;
+  for (uint i = 0; i < nlayers; ++i)
+    for (uint j = 0; j < network->at(i)->size(); ++j) {
+      Unit& unit = network->at(i)->at(j);
+      for (uint w = 0; w < unit.getNumberOfWeights(); ++w)
+        unit.setWeight(w, weights[k++]);
+    }
+  return;
+} // End method setWeights
+
+/**
+ * Metod copyWeights
+ *
+ * Copia nella rete i pesi della rete passata, che deve avere la stessa
+ * topologia (stesso numero di inputs, strati e unita` per strato). La copia
+ * non alloca memoria.
+ */
+void NeuralNetwork::copyWeights(const NeuralNetwork& neuralnetwork) {
+  if (neuralnetwork.ninputs != ninputs || neuralnetwork.nlayers != nlayers)
+    throw std::out_of_range("In NeuralNetwork::copyWeights");
+  for (uint i = 0; i < nlayers; ++i) {
+    const std::vector<Unit>& layer = *(neuralnetwork.network->at(i));
+    if (layer.size() != network->at(i)->size())
+      throw std::out_of_range("In NeuralNetwork::copyWeights");
+    for (uint j = 0; j < layer.size(); ++j)
+      network->at(i)->at(j).copyWeights(layer[j]);
+  }
+  return;
+} // End method copyWeights
+
 /**
  * Metod sumToWeight
  *
@@ -409,43 +634,14 @@ const NeuralNetwork& NeuralNetwork::write(std::ostream& os) const {
  * Vengono ignorate le righe che iniziano con #.
  */
 NeuralNetwork& NeuralNetwork::read(std::istream& is) {
-  // legge i valori dallo stream
+  // le righe vengono lette in un unico buffer, riutilizzato per ogni riga
   std::string line;
-  uint ninputs, nlayers;
-  std::vector<std::string>* nunitsv;
-  std::vector< std::vector<Unit>* >* network;
-  // legge il numero di input (# number of inputs)
-  if (!readNextGoodLine(is, line)) throw read_error("In NeuralNetwork::read");
-  ninputs = Global::toUint(line);
-  // legge il numero di strati (# number of layers)
-  if (!readNextGoodLine(is, line)) throw read_error("In NeuralNetwork::read");
-  nlayers = Global::toUint(line);
-  // legge il numero di unita` per ogni strato (# units for any layer)
-  if (!readNextGoodLine(is, line)) throw read_error("In NeuralNetwork::read");
-  nunitsv = Global::split(line,',');
-  if (nunitsv->size() != nlayers) throw read_error("In NeuralNetwork::read");
-  // legge le unita` dello strato i-esimo (# units layer i)
-  network = new std::vector< std::vector<Unit>* >(nlayers, NULL);
-  for (uint i = 0; i < nlayers; ++i) {
-    uint nunits = Global::toUint(nunitsv->at(i));
-    network->at(i) = new std::vector<Unit>(nunits);
-    // legge l'unita` j-esima (unit(i,j))
-    for (uint j = 0; j < nunits; ++j) {
-      if (!readNextGoodLine(is, line))
-        throw read_error("In NeuralNetwork::read");
-      std::istringstream unitiss(line);
-      unitiss >>network->at(i)->at(j);
-    } // end for j
-  } // end for i
-  delete nunitsv;
-  // aggiorna la rete con i parametri letti
-  this->ninputs = ninputs;
-  this->nlayers = nlayers;
-  this->inputs.clear();
-  this->inputs.resize(ninputs, 0.0);
-  this->network = network;
-  this->lastOutput.clear();
-  this->lastOutput.resize(this->network->back()->size() , 0.0);
+  parseText([&is, &line](const char*& first, const char*& last) {
+    if (!std::getline(is, line)) return false;
+    first = line.data();
+    last = first + line.size();
+    return true;
+  });
   return *this;
 } // End method read
 
@@ -463,30 +659,296 @@ void NeuralNetwork::saveOnFile(const std::string& filename) const {
   return;
 } // End method saveOnFile
 
+/**
+ * Method saveBinary
+ *
+ * Salva la rete neurale sul file passato nel formato binario descritto nella
+ * documentazione della classe, con i pesi memorizzati con la precisione
+ * indicata (64 bits, pesi identici a quelli della rete, oppure 32 bits). I
+ * pesi vengono scritti unita` per unita`, senza copie della rete in memoria,
+ * e la scrittura e` atomica (vedere la classe AtomicFile).
+ */
+void NeuralNetwork::saveBinary(const std::string& filename,
+    uint precision) const {
+  if (precision != 64 && precision != 32)
+    throw std::invalid_argument("In NeuralNetwork::saveBinary");
+  BinaryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.precision = precision;
+  header.activation = 0;
+  header.ninputs = ninputs;
+  header.nlayers = nlayers;
+  header.nweights = getNumberOfWeights();
+  std::vector<uint> nunits(nlayers);
+  for (uint i = 0; i < nlayers; ++i) nunits[i] = network->at(i)->size();
+  std::vector<std::size_t> offsets;
+  getBinaryLayout(header, nunits.data(), offsets);
+  // scrive il file (l'header, con il checksum, viene riscritto alla fine)
+  AtomicFile file(filename);
+  file.write(&header, sizeof(header));
+  std::size_t pos = sizeof(header);
+  unsigned long long sum = checksum(NULL, 0);
+  std::string buffer(reinterpret_cast<const char*>(nunits.data()),
+      nlayers * sizeof(uint));
+  const std::size_t bytes = precision / 8;
+  for (uint i = 0; i < nlayers; ++i) {
+    buffer.resize(offsets[i] - pos, '\0');
+    for (uint j = 0; j < network->at(i)->size(); ++j) {
+      const Unit& unit = network->at(i)->at(j);
+      const std::size_t first = buffer.size();
+      buffer.resize(first + unit.getNumberOfWeights() * bytes);
+      for (uint w = 0; w < unit.getNumberOfWeights(); ++w) {
+        if (precision == 64) {
+          real value = unit.getWeight(w);
+          std::memcpy(&buffer[first + w * 8], &value, 8);
+        }
+        else {
+          float value = unit.getWeight(w);
+          std::memcpy(&buffer[first + w * 4], &value, 4);
+        }
+      }
+      file.write(buffer.data(), buffer.size());
+      sum = checksum(buffer.data(), buffer.size(), sum);
+      pos += buffer.size();
+      buffer.clear();
+    }
+  }
+  header.checksum = sum;
+  file.writeAt(0, &header, sizeof(header));
+  file.commit();
+  return;
+} // End method saveBinary
+
+/**
+ * Method loadFromFile
+ *
+ * Legge la rete neurale dal file passato, in formato testuale (vedere il
+ * metodo read) oppure binario (vedere il metodo saveBinary), riconosciuto
+ * automaticamente. Il file viene mappato in memoria: i pesi del file binario
+ * vengono copiati direttamente nelle unita`, senza analisi del testo ne'
+ * buffer intermedi (a parte la conversione dei pesi a 32 bits), mentre il
+ * file testuale viene analizzato riga per riga direttamente dalla memoria
+ * mappata (vedere il metodo parseText).
+ */
+void NeuralNetwork::loadFromFile(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) throw file_error("In NeuralNetwork::loadFromFile");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw file_error("In NeuralNetwork::loadFromFile");
+  }
+  const std::size_t size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    throw read_error("In NeuralNetwork::loadFromFile");
+  }
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) throw file_error("In NeuralNetwork::loadFromFile");
+  madvise(data, size, MADV_SEQUENTIAL);
+  try {
+    const char* pos = static_cast<const char*>(data);
+    const char* end = pos + size;
+    if (size >= sizeof(MAGIC) && std::memcmp(pos, MAGIC, sizeof(MAGIC)) == 0)
+      readBinary(pos, size);
+    else parseText([&pos, end](const char*& first, const char*& last) {
+      if (pos >= end) return false;
+      first = pos;
+      last = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+      if (last == NULL) last = end;
+      pos = last + 1;
+      return true;
+    });
+  }
+  catch (...) {
+    munmap(data, size);
+    throw;
+  }
+  munmap(data, size);
+  return;
+} // End method loadFromFile
+
 // ===============
 // PRIVATE METHODS
 // ===============
 
 /**
- * Method readNextGoodLine
+ * Method parseText
  *
- * Legge dallo stream is una riga, controlla che non ci siano errori, non sia
- * vuota o un commento (inizia con #) e la mette in line.
- * Se trova una riga "buona" restituisce true, altrimenti restituisce false.
+ * Legge la rete neurale nel formato testuale (vedere il metodo read) dalle
+ * righe [first,last) restituite una alla volta da nextLine (che restituisce
+ * false alla fine del file), ignorando le righe vuote e quelle che iniziano
+ * con #. I campi vengono convertiti con std::from_chars direttamente dai
+ * caratteri della riga (vedere le funzioni parseUint e parseReal), senza
+ * stringhe intermedie, e i pesi di ogni unita` in un buffer allocato una sola
+ * volta per strato. Le unita` vengono costruite prima di leggerne i pesi,
+ * come nelle versioni precedenti, quindi la sequenza dei numeri casuali
+ * generati non cambia.
  */
-bool NeuralNetwork::readNextGoodLine(std::istream& is, std::string& line) {
-  std::string tmpline;
-  std::getline(is, tmpline);
-  while (is.good()) {
-    Global::trim(line," \t");
-    if (!tmpline.empty() && tmpline[0] != '#') {
-      line = tmpline;
-      return true;
+void NeuralNetwork::parseText(const std::function<bool(const char*&,
+    const char*&)>& nextLine) {
+  const char* first = NULL;
+  const char* last = NULL;
+  // legge in [first,last) la prossima riga "buona", senza spazi ai lati
+  auto nextGoodLine = [&]() {
+    while (nextLine(first, last)) {
+      while (first < last && std::isspace((unsigned char) *first)) ++first;
+      while (last > first && std::isspace((unsigned char) last[-1])) --last;
+      if (first < last && *first != '#') return;
     }
-    std::getline(is, tmpline);
-  } // end while (is.good())
-  return false;
-} // End method readNextGoodLine
+    throw read_error("In NeuralNetwork::read");
+  };
+  // legge il numero di input (# number of inputs)
+  nextGoodLine();
+  const uint ninputs = parseUint(first, last);
+  // legge il numero di strati (# number of layers)
+  nextGoodLine();
+  const uint nlayers = parseUint(first, last);
+  // legge il numero di unita` per ogni strato (# units for any layer)
+  nextGoodLine();
+  std::vector<uint> nunits;
+  for (const char* field = first; ; ) {
+    const char* comma = findComma(field, last);
+    nunits.push_back(parseUint(field, comma));
+    if (comma == last) break;
+    field = comma + 1;
+  }
+  if (nlayers == 0 || nunits.size() != nlayers)
+    throw read_error("In NeuralNetwork::read");
+  // legge le unita` dello strato i-esimo (# units layer i)
+  std::vector< std::vector<Unit>* >* network =
+      new std::vector< std::vector<Unit>* >(nlayers, NULL);
+  try {
+    std::vector<real> weights;
+    uint prev = ninputs;
+    for (uint i = 0; i < nlayers; ++i) {
+      network->at(i) = new std::vector<Unit>(nunits[i]);
+      weights.resize(prev + 1);
+      // legge l'unita` j-esima (unit(i,j)): n,weight(1),...,weight(n)
+      for (uint j = 0; j < nunits[i]; ++j) {
+        nextGoodLine();
+        const char* comma = findComma(first, last);
+        if (parseUint(first, comma) != prev + 1)
+          throw read_error("In NeuralNetwork::read");
+        for (uint w = 0; w <= prev; ++w) {
+          if (comma == last) throw read_error("In NeuralNetwork::read");
+          const char* field = comma + 1;
+          comma = findComma(field, last);
+          weights[w] = parseReal(field, comma);
+        }
+        if (comma != last) throw read_error("In NeuralNetwork::read");
+        network->at(i)->at(j).assign(weights.data(), prev + 1);
+      } // end for j
+      prev = nunits[i];
+    } // end for i
+  }
+  catch (...) {
+    for (uint i = 0; i < nlayers; ++i) delete network->at(i);
+    delete network;
+    throw;
+  }
+  setNetwork(ninputs, network);
+  return;
+} // End method parseText
+
+/**
+ * Method setNetwork
+ *
+ * Sostituisce le unita` della rete con quelle passate (lette da file), con
+ * ninputs inputs, liberando quelle precedenti.
+ */
+void NeuralNetwork::setNetwork(uint ninputs,
+    std::vector< std::vector<Unit>* >* network) {
+  for (uint i = 0; i < nlayers; ++i)
+    delete this->network->at(i);
+  delete this->network;
+  this->ninputs = ninputs;
+  this->nlayers = network->size();
+  this->inputs.assign(ninputs, 0.0);
+  this->network = network;
+  this->lastOutput.assign(this->network->back()->size(), 0.0);
+  return;
+} // End method setNetwork
+
+/**
+ * Method readBinary
+ *
+ * Legge la rete neurale dal file in formato binario [data,data+size) mappato
+ * in memoria (vedere il metodo loadFromFile). Le unita` vengono costruite come
+ * nel metodo read, quindi la sequenza dei numeri casuali generati e` la stessa
+ * della lettura del file testuale.
+ */
+void NeuralNetwork::readBinary(const char* data, std::size_t size) {
+  // controlla l'header e la topologia
+  BinaryHeader header;
+  if (size < sizeof(header)) throw read_error("In NeuralNetwork::readBinary");
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.activation != 0 ||
+      (header.precision != 64 && header.precision != 32) ||
+      header.nlayers == 0 ||
+      size < sizeof(header) + header.nlayers * sizeof(uint))
+    throw read_error("In NeuralNetwork::readBinary");
+  const uint* nunits = reinterpret_cast<const uint*>(data + sizeof(header));
+  unsigned long long nweights = 0;
+  uint prev = header.ninputs;
+  for (uint i = 0; i < header.nlayers; ++i) {
+    if (nunits[i] == 0) throw read_error("In NeuralNetwork::readBinary");
+    nweights += (unsigned long long) nunits[i] * (prev + 1);
+    prev = nunits[i];
+  }
+  std::vector<std::size_t> offsets;
+  if (nweights != header.nweights ||
+      getBinaryLayout(header, nunits, offsets) > size)
+    throw read_error("In NeuralNetwork::readBinary");
+  // costruisce le unita` con i pesi dei blocchi
+  std::vector< std::vector<Unit>* >* network =
+      new std::vector< std::vector<Unit>* >(header.nlayers, NULL);
+  std::vector<real> buffer;
+  prev = header.ninputs;
+  for (uint i = 0; i < header.nlayers; ++i) {
+    network->at(i) = new std::vector<Unit>(nunits[i]);
+    const char* block = data + offsets[i];
+    for (uint j = 0; j < nunits[i]; ++j) {
+      if (header.precision == 64) {
+        network->at(i)->at(j).assign(reinterpret_cast<const real*>(block) +
+            std::size_t(j) * (prev + 1), prev + 1);
+        continue;
+      }
+      const float* weights = reinterpret_cast<const float*>(block) +
+          std::size_t(j) * (prev + 1);
+      buffer.assign(weights, weights + prev + 1);
+      network->at(i)->at(j).assign(buffer.data(), prev + 1);
+    }
+    prev = nunits[i];
+  }
+  setNetwork(header.ninputs, network);
+  return;
+} // End method readBinary
+
+/**
+ * Method getBinaryLayout
+ *
+ * Calcola la posizione nel file (dall'inizio) dei blocchi dei pesi di ogni
+ * strato del formato binario, con l'header e il numero di unita` per strato
+ * passati, e restituisce la dimensione del file.
+ */
+std::size_t NeuralNetwork::getBinaryLayout(const BinaryHeader& header,
+    const uint* nunits, std::vector<std::size_t>& offsets) {
+  const std::size_t bytes = header.precision / 8;
+  offsets.resize(header.nlayers);
+  std::size_t end = sizeof(header) + header.nlayers * sizeof(uint);
+  uint prev = header.ninputs;
+  for (uint i = 0; i < header.nlayers; ++i) {
+    offsets[i] = align(end);
+    end = offsets[i] + std::size_t(nunits[i]) * (prev + 1) * bytes;
+    prev = nunits[i];
+  }
+  return end;
+} // End method getBinaryLayout
 
 // =================
 // RELATED FUNCTIONS
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <ostream>
+#include <functional>
 #include "global.h"
 #include "unit.h"
 
@@ -43,6 +44,19 @@ typedef Global::real real;
  *   unit(n,2)
  *   ...
  * I pesi delle unita` vengono scritti (e letti) con una precisione di 10e-21.
+ * Con il metodo saveBinary la rete viene salvata in un formato binario, che
+ * il metodo loadFromFile riconosce e carica senza analisi del testo:
+ *   header (64 bytes): magic, versione, precisione (bits per peso), funzione
+ *     di attivazione (0 = sigmoide), numero di inputs, di strati e di pesi,
+ *     checksum
+ *   numero di unita` di ogni strato
+ *   pesi dello strato 1 (unita` per unita`, nello stesso ordine del formato
+ *     testuale: bias e poi un peso per ogni input)
+ *   ...
+ *   pesi dello strato n
+ * I blocchi dei pesi iniziano a indirizzi allineati a 64 bytes, quindi il file
+ * mappato in memoria e` letto direttamente come matrici di reali. Il checksum
+ * (dei bytes dopo l'header) viene controllato solo dal metodo checkBinary.
  */
 class NeuralNetwork
 {
@@ -55,6 +69,7 @@ class NeuralNetwork
 
     void setInput ( uint i, real input );
     void setInputs ( const std::vector<real>& inputs );
+    void setInputs ( const real* inputs );
     void setWeight ( uint layer, uint unit, uint index, real weight );
     real getInput ( uint i ) const;
     const std::vector<real>& getInputs ( ) const;
@@ -72,20 +87,44 @@ class NeuralNetwork
     uint getNumberOfLayers ( ) const;
     uint getNumberOfHiddenLayers ( ) const;
     uint getLayerDimension ( uint i ) const;
+    uint getNumberOfWeights ( ) const;
+    void getWeights ( std::vector<real>& weights ) const;
+    void setWeights ( const std::vector<real>& weights );
+    void copyWeights ( const NeuralNetwork& neuralnetwork );
     void sumToWeight ( uint layer, uint unit, uint index, real value );
     void compute ( );
     const NeuralNetwork& write ( std::ostream& os ) const;
     NeuralNetwork& read ( std::istream& is );
     void saveOnFile ( const std::string& filename ) const;
+    void saveBinary ( const std::string& filename, uint precision = 64 ) const;
+    void loadFromFile ( const std::string& filename );
+    static bool isBinary ( const std::string& filename );
+    static bool checkBinary ( const std::string& filename );
 
   private:
+    static const char MAGIC[8];
+    static const uint VERSION;
+
+    struct BinaryHeader {
+      char magic[8];
+      uint version, precision, activation;
+      uint ninputs, nlayers, reserved0;
+      unsigned long long nweights, checksum;
+      char reserved[16];
+    };
     uint ninputs;
     uint nlayers;
     std::vector<real> inputs;
     std::vector< std::vector<Unit>* >* network;
     std::vector<real> lastOutput;
 
-    bool readNextGoodLine( std::istream& is, std::string& line );
+    void parseText ( const std::function<bool(const char*&, const char*&)>&
+        nextLine );
+    void setNetwork ( uint ninputs,
+        std::vector< std::vector<Unit>* >* network );
+    void readBinary ( const char* data, std::size_t size );
+    static std::size_t getBinaryLayout ( const BinaryHeader& header,
+        const uint* nunits, std::vector<std::size_t>& offsets );
 
 }; // End class NeuralNetwork
 
@@ -1,15 +1,19 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include "global.h"
 #include "nntraining.h"
 #include "nntest.h"
+#include "nnsearch.h"
+#include "nnconvert.h"
+#include "dataset.h"
 
 // Dichiarazione di funzioni
 bool checkParameters();
 void printHelp();
 
 // Variabili globali
-enum Mode { training, test } mode;
+enum Mode { training, test, search, convert } mode;
 uint rseed;
 
 /**
@@ -18,7 +22,8 @@ uint rseed;
  * Funzione iniziale dell'applicazione. Legge i parametri passati al programma
  * inserendoli nella classe Global, inizializza il generatore di numeri casuali
  * con il seme passato come parametro e infine avvia l'esecuzione della
- * modalita` richiesta. Le modalita` possono essere "training" oppure "test".
+ * modalita` richiesta. Le modalita` possono essere "training", "test" oppure
+ * "search" o "convert".
  * Per le informazioni sul programma, i parametri e le modalita` di esecuzione
  * si puo` avviare l'applicazione con il parametro --help.
  */
@@ -39,6 +44,10 @@ int main(int argc, char **argv) {
     return NNTraining::exec();
   case test :
     return NNTest::exec();
+  case search :
+    return NNSearch::exec();
+  case convert :
+    return NNConvert::exec();
   } // end switch
 
   return 0;
@@ -51,6 +60,10 @@ int main(int argc, char **argv) {
  *   --help  : visualizza l'help del programma ed esce
  *   --mode  : controlla che la modalita` scelta sia valida
  *   --rseed : imposta il seme per il generatore di numeri casuali
+ *   --loadthreads : imposta il numero di threads per caricare i dataset
+ *   --columns : imposta le colonne dei dataset csv da caricare
+ *   --storage : imposta la precisione degli inputs dei dataset in memoria
+ *   --dscache : imposta la directory della cache dei dataset csv
  * Se i parametri sono validi (e non e` stato richiesto l'help) la funzione
  * restituisce true e le variabili globali contengono i valori impostati,
  * altrimenti restituisce false.
@@ -71,6 +84,10 @@ bool checkParameters() {
     mode = training;
   } else if (strmode == "test") {
     mode = test;
+  } else if (strmode == "search") {
+    mode = search;
+  } else if (strmode == "convert") {
+    mode = convert;
   } else if (strmode == "mode") {
     std::cout <<"Option --mode requires an argument (try with --help)";
     std::cout <<std::endl;
@@ -89,6 +106,45 @@ bool checkParameters() {
   } else {
     rseed = Global::toUint(Global::getParam("rseed"));
   }
+  // parametro --loadthreads
+  if (Global::getParam("loadthreads") == "loadthreads") {
+    std::cout <<"Option --loadthreads requires an argument" <<std::endl;
+    return false;
+  } else if (!Global::getParam("loadthreads").empty()) {
+    Dataset::setLoadThreads(Global::toUint(Global::getParam("loadthreads")));
+  }
+  // parametro --columns
+  if (Global::getParam("columns") == "columns") {
+    std::cout <<"Option --columns requires an argument" <<std::endl;
+    return false;
+  } else if (!Global::getParam("columns").empty()) {
+    try {
+      Dataset::setColumns(Global::getParam("columns"));
+    } catch (std::invalid_argument& e) {
+      std::cout <<"Option --columns: " <<e.what() <<std::endl;
+      return false;
+    }
+  }
+  // parametro --storage
+  if (Global::getParam("storage") == "storage") {
+    std::cout <<"Option --storage requires an argument" <<std::endl;
+    return false;
+  } else if (!Global::getParam("storage").empty()) {
+    try {
+      Dataset::setStoragePrecision(Global::toUint(Global::getParam("storage")));
+    } catch (std::invalid_argument& e) {
+      std::cout <<"Option --storage: the value must be 64, 32, 16 or 8";
+      std::cout <<std::endl;
+      return false;
+    }
+  }
+  // parametro --dscache
+  if (Global::getParam("dscache") == "dscache") {
+    std::cout <<"Option --dscache requires an argument" <<std::endl;
+    return false;
+  } else if (!Global::getParam("dscache").empty()) {
+    Dataset::setCacheDirectory(Global::getParam("dscache"));
+  }
   return true;
 } // End function checkParameters
 
@@ -0,0 +1,301 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <cstdio>
+#include <sys/time.h>
+#include "global.h"
+#include "random.h"
+#include "dataset.h"
+#include "neuralnetwork.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+// Dichiarazione di funzioni
+int benchCsv();
+int benchShuffle();
+int benchModel();
+double getTime();
+
+/**
+ * Function main
+ *
+ * Programma di benchmark per le parti della libreria critiche per le
+ * prestazioni. Il benchmark da eseguire viene scelto con il parametro --bench;
+ * i benchmark disponibili sono:
+ *   csv   caricamento di un dataset csv (Dataset::load) con un numero diverso
+ *         di threads (vedere Dataset::setLoadThreads), con i parametri:
+ *           --file     file csv da caricare.
+ *           --inputs   numero di inputs del dataset.
+ *           --outputs  numero di outputs del dataset.
+ *           --threads  numeri di threads da provare, separati da virgola
+ *                      (default 1,2,4,... fino al numero di processori).
+ *           --repeat   numero di caricamenti per ogni numero di threads, di
+ *                      cui viene considerato il piu` veloce (default 3).
+ *           --columns  colonne da caricare (vedere Dataset::setColumns).
+ * Per ogni configurazione vengono stampate le istanze e i megabytes al
+ * secondo e lo speedup rispetto alla prima configurazione.
+ *   shuffle  epoche di lettura del training set di un dataset (diviso in
+ *         folds come per il training) con i diversi riordinamenti: index
+ *         (permutazione del vettore di accesso), block (permutazione a
+ *         blocchi, vedere Dataset::randomShuffleTrainingSet), copy e
+ *         block+copy (training set copiato nell'ordine dell'epoca, vedere
+ *         Dataset::gatherTrainingSet). Per ogni istanza vengono calcolati
+ *         units prodotti scalari con gli inputs (come il primo strato di una
+ *         rete). Parametri:
+ *           --file     file del dataset (csv o binario).
+ *           --inputs   numero di inputs del dataset.
+ *           --outputs  numero di outputs del dataset.
+ *           --folds    numero di folds (default 10).
+ *           --units    numero di prodotti scalari per istanza (default 16).
+ *           --block    istanze per blocco per block (default 1024).
+ *           --epochs   numero di epoche per ogni riordinamento (default 3).
+ *           --threads  threads per la copia (default il numero di processori).
+ *           --storage  bits per input in memoria (default 64, vedere
+ *                      Dataset::setStoragePrecision).
+ * Per ogni riordinamento vengono stampati i tempi medi per epoca di
+ * riordinamento, copia, lettura e totale, e lo speedup rispetto a index.
+ *   model  caricamento di reti neurali di diverse dimensioni: text (formato
+ *         testuale letto da uno stream, metodo NeuralNetwork::read), mmap
+ *         (formato testuale mappato in memoria) e binary (formato binario,
+ *         vedere NeuralNetwork::saveBinary). Le reti vengono create con pesi
+ *         casuali e salvate in file temporanei. Parametri:
+ *           --models   topologie delle reti, separate da virgola, ognuna
+ *                      nella forma inputs-units(1)-...-units(n) (default
+ *                      100-50-1,1000-500-10,2000-2000-500-10).
+ *           --file     prefisso dei file temporanei (default nnbench-model).
+ *           --repeat   numero di caricamenti per ogni formato, di cui viene
+ *                      considerato il piu` veloce (default 3).
+ * Per ogni rete vengono stampati il numero di pesi, la dimensione del file
+ * testuale, i tempi di caricamento di ogni formato e lo speedup di mmap e
+ * binary rispetto a text.
+ */
+int main(int argc, char **argv) {
+  Global::readParameters(argc, argv);
+  const std::string& bench = Global::getParam("bench");
+  if (bench == "csv") return benchCsv();
+  if (bench == "shuffle") return benchShuffle();
+  if (bench == "model") return benchModel();
+  std::cout <<"Usage: nnbench --bench <name> [parameters]" <<std::endl;
+  std::cout <<"Benchmarks: csv, shuffle, model (see nnbench.cpp)" <<std::endl;
+  return -1;
+} // End function main
+
+/**
+ * Function benchCsv
+ *
+ * Esegue il benchmark "csv" (vedere la funzione main).
+ */
+int benchCsv() {
+  const std::string& file = Global::getParam("file");
+  if (file.empty() || Global::getParam("inputs").empty() ||
+      Global::getParam("outputs").empty()) {
+    std::cout <<"Benchmark csv requires --file, --inputs and --outputs";
+    std::cout <<std::endl;
+    return -1;
+  }
+  uint ninputs = Global::toUint(Global::getParam("inputs"));
+  uint noutputs = Global::toUint(Global::getParam("outputs"));
+  uint repeat = 3;
+  if (!Global::getParam("repeat").empty())
+    repeat = std::max(1u, Global::toUint(Global::getParam("repeat")));
+  std::vector<uint> threads;
+  if (Global::getParam("threads").empty()) {
+    uint maxthreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint n = 1; n < maxthreads; n *= 2) threads.push_back(n);
+    threads.push_back(maxthreads);
+  }
+  else {
+    std::vector<std::string>* values =
+        Global::split(Global::getParam("threads"), ',');
+    for (std::size_t i = 0; i < values->size(); ++i)
+      threads.push_back(Global::toUint(values->at(i)));
+    delete values;
+  }
+  if (!Global::getParam("columns").empty())
+    Dataset::setColumns(Global::getParam("columns"));
+  std::cout <<"# csv load: " <<file <<std::endl;
+  std::cout <<"threads,rows,seconds,rows/s,MB/s,speedup" <<std::endl;
+  double base = 0.0;
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    Dataset::setLoadThreads(threads[i]);
+    double best = 0.0;
+    Dataset dataset;
+    for (uint r = 0; r < repeat; ++r) {
+      double start = getTime();
+      dataset.load(file, ninputs, noutputs);
+      double t = getTime() - start;
+      if (r == 0 || t < best) best = t;
+    }
+    if (i == 0) base = best;
+    std::cout <<threads[i] <<"," <<dataset.getSize() <<"," <<best <<",";
+    std::cout <<dataset.getSize() / best <<",";
+    std::cout <<dataset.getLoadBytes() / 1e6 / best <<",";
+    std::cout <<base / best <<std::endl;
+  }
+  return 0;
+} // End function benchCsv
+
+/**
+ * Function getUintParam
+ *
+ * Restituisce il valore del parametro name, o value se non e` impostato.
+ */
+static uint getUintParam(const std::string& name, uint value) {
+  if (Global::getParam(name).empty()) return value;
+  return Global::toUint(Global::getParam(name));
+} // End function getUintParam
+
+/**
+ * Function benchShuffle
+ *
+ * Esegue il benchmark "shuffle" (vedere la funzione main).
+ */
+int benchShuffle() {
+  const std::string& file = Global::getParam("file");
+  if (file.empty() || Global::getParam("inputs").empty() ||
+      Global::getParam("outputs").empty()) {
+    std::cout <<"Benchmark shuffle requires --file, --inputs and --outputs";
+    std::cout <<std::endl;
+    return -1;
+  }
+  const uint ninputs = Global::toUint(Global::getParam("inputs"));
+  const uint noutputs = Global::toUint(Global::getParam("outputs"));
+  const uint folds = std::max(1u, getUintParam("folds", 10));
+  const uint units = getUintParam("units", 16);
+  const uint block = getUintParam("block", 1024);
+  const uint epochs = std::max(1u, getUintParam("epochs", 3));
+  const uint threads = getUintParam("threads",
+      std::max(1u, std::thread::hardware_concurrency()));
+  Dataset::setStoragePrecision(getUintParam("storage", 64));
+  Dataset dataset;
+  dataset.load(file, ninputs, noutputs);
+  Global::setRandSeed(1);
+  dataset.randomShuffle();
+  dataset.setFolds(folds);
+  dataset.setValidationFold(0);
+  std::vector<real> weights(std::size_t(units) * ninputs);
+  for (std::size_t i = 0; i < weights.size(); ++i)
+    weights[i] = Global::getRand(0, 1400) / 1000.0 - 0.7;
+  std::cout <<"# shuffle: " <<file <<", " <<dataset.getTrSetSize();
+  std::cout <<" training instances, " <<threads <<" threads, ";
+  std::cout <<dataset.getInputsBytes() / 1e6 <<" MB of inputs" <<std::endl;
+  std::cout <<"mode,shuffle,gather,read,epoch,speedup" <<std::endl;
+  const char* modes[] = { "index", "block", "copy", "block+copy" };
+  double base = 0.0;
+  real checksum = 0.0;
+  for (uint m = 0; m < 4; ++m) {
+    const bool blocks = (m == 1 || m == 3);
+    const bool copy = (m >= 2);
+    Random random(1);
+    std::vector<real> inputs, outputs, row;
+    double tshuffle = 0.0, tgather = 0.0, tread = 0.0;
+    for (uint e = 0; e < epochs; ++e) {
+      double start = getTime();
+      dataset.randomShuffleTrainingSet(random, blocks ? block : 0);
+      double t = getTime();
+      tshuffle += t - start;
+      if (copy) dataset.gatherTrainingSet(inputs, outputs, threads);
+      start = getTime();
+      tgather += start - t;
+      // legge le istanze (units prodotti scalari con gli inputs)
+      const uint size = dataset.getTrSetSize();
+      for (uint i = 0; i < size; ++i) {
+        const real* in = copy ? &inputs[std::size_t(i) * ninputs] :
+            dataset.trAt(i).input.data(row);
+        for (uint u = 0; u < units; ++u) {
+          const real* w = &weights[std::size_t(u) * ninputs];
+          real sum = 0.0;
+          for (uint j = 0; j < ninputs; ++j) sum += w[j] * in[j];
+          checksum += sum;
+        }
+      }
+      tread += getTime() - start;
+    }
+    const double epoch = (tshuffle + tgather + tread) / epochs;
+    if (m == 0) base = epoch;
+    std::cout <<modes[m] <<"," <<tshuffle / epochs <<"," <<tgather / epochs;
+    std::cout <<"," <<tread / epochs <<"," <<epoch <<"," <<base / epoch;
+    std::cout <<std::endl;
+  }
+  std::cout <<"# checksum: " <<checksum <<std::endl;
+  return 0;
+} // End function benchShuffle
+
+/**
+ * Function benchModel
+ *
+ * Esegue il benchmark "model" (vedere la funzione main).
+ */
+int benchModel() {
+  std::string models = Global::getParam("models");
+  if (models.empty() || models == "models")
+    models = "100-50-1,1000-500-10,2000-2000-500-10";
+  std::string prefix = Global::getParam("file");
+  if (prefix.empty() || prefix == "file") prefix = "nnbench-model";
+  const uint repeat = std::max(1u, getUintParam("repeat", 3));
+  const std::string txtfile = prefix + ".txt", binfile = prefix + ".bin";
+  Global::setRandSeed(1);
+  std::cout <<"# model load" <<std::endl;
+  std::cout <<"model,weights,MB,text,mmap,binary,speedup mmap,speedup binary";
+  std::cout <<std::endl;
+  std::vector<std::string>* topologies = Global::split(models, ',');
+  for (std::size_t m = 0; m < topologies->size(); ++m) {
+    std::vector<std::string>* sizes = Global::split(topologies->at(m), '-');
+    if (sizes->size() < 2) {
+      std::cout <<"Invalid model " <<topologies->at(m) <<std::endl;
+      delete sizes;
+      delete topologies;
+      return -1;
+    }
+    std::vector<uint> nunits;
+    for (std::size_t i = 1; i < sizes->size(); ++i)
+      nunits.push_back(Global::toUint(sizes->at(i)));
+    NeuralNetwork nn(Global::toUint(sizes->at(0)), nunits.size(), nunits);
+    delete sizes;
+    nn.saveOnFile(txtfile);
+    nn.saveBinary(binfile);
+    std::ifstream ifs(txtfile.c_str(), std::ios::in | std::ios::binary);
+    ifs.seekg(0, std::ios::end);
+    const double mbytes = ifs.tellg() / 1e6;
+    ifs.close();
+    // tempi di caricamento (il migliore su repeat) di ogni formato
+    double best[3] = { 0.0, 0.0, 0.0 };
+    for (uint f = 0; f < 3; ++f)
+      for (uint r = 0; r < repeat; ++r) {
+        NeuralNetwork loaded;
+        const double start = getTime();
+        if (f == 0) {
+          std::ifstream is(txtfile.c_str());
+          loaded.read(is);
+        }
+        else loaded.loadFromFile(f == 1 ? txtfile : binfile);
+        const double t = getTime() - start;
+        if (r == 0 || t < best[f]) best[f] = t;
+        if (loaded.getNumberOfWeights() != nn.getNumberOfWeights())
+          std::cout <<"# error: weights differ" <<std::endl;
+      }
+    std::cout <<topologies->at(m) <<"," <<nn.getNumberOfWeights() <<",";
+    std::cout <<mbytes <<"," <<best[0] <<"," <<best[1] <<"," <<best[2];
+    std::cout <<"," <<best[0] / best[1] <<"," <<best[0] / best[2];
+    std::cout <<std::endl;
+  }
+  delete topologies;
+  std::remove(txtfile.c_str());
+  std::remove(binfile.c_str());
+  return 0;
+} // End function benchModel
+
+/**
+ * Function getTime
+ *
+ * Restituisce il tempo corrente in secondi.
+ */
+double getTime() {
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+} // End function getTime
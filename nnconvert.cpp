@@ -0,0 +1,228 @@
+#include "nnconvert.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include "global.h"
+#include "exception.h"
+#include "dataset.h"
+#include "nntest.h"
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+uint NNConvert::inputs, NNConvert::outputs, NNConvert::precision;
+std::string NNConvert::dsfile, NNConvert::binfile;
+std::string NNConvert::nnfile, NNConvert::nnout;
+
+// =================
+// RELATED FUNCTIONS
+// =================
+
+/**
+ * Function elapsed
+ *
+ * Restituisce i secondi trascorsi tra gli istanti start e end.
+ */
+static double elapsed(const timeval& start, const timeval& end) {
+  return (end.tv_sec - start.tv_sec) +
+      (end.tv_usec - start.tv_usec) / 1000000.0;
+} // End function elapsed
+
+// =====================
+// PUBLIC STATIC METHODS
+// =====================
+
+/**
+ * Method exec
+ *
+ * Esegue i seguenti passi:
+ *   - Controlla i parametri globali necessari
+ *   - Con il parametro --nnfile converte la rete neurale (vedere il metodo
+ *     convertModel), altrimenti:
+ *   - Carica il dataset e ne stampa le caratteristiche
+ *   - Salva il dataset in formato binario e controlla il file prodotto
+ *   - Stampa le caratteristiche del file prodotto
+ * Restituisce 0 se l'esecuzione e` avvenuta correttamente, un numero diverso
+ * da 0 se ci sono stati errori (per esempio mancano dei parametri).
+ */
+int NNConvert::exec() {
+  // Legge e controlla i parametri
+  if (!checkParameters()) return -1;
+  if (!nnfile.empty()) return convertModel();
+
+  // Carica il dataset
+  Dataset dataset;
+  dataset.load(dsfile, inputs, outputs);
+  NNTest::printDatasetInfo(dsfile, dataset);
+
+  // Salva il dataset in formato binario
+  timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+  dataset.saveBinary(binfile, precision);
+  gettimeofday(&tend, NULL);
+  bool valid = Dataset::checkBinary(binfile);
+
+  // Rilegge il file prodotto (per misurarne il tempo di caricamento)
+  Dataset binary;
+  binary.load(binfile, inputs, outputs);
+
+  // Stampa le caratteristiche del file prodotto
+  std::cout <<"# binary dataset" <<std::endl;
+  std::cout <<"file: " <<binfile <<"\n";
+  std::cout <<"precision: " <<precision <<" bits\n";
+  std::cout <<"size: " <<binary.getLoadBytes() / 1e6 <<" MB (from ";
+  std::cout <<dataset.getLoadBytes() / 1e6 <<" MB)\n";
+  std::cout <<"write time: " <<elapsed(tstart, tend) <<" seconds\n";
+  std::cout <<"load time: " <<binary.getLoadTime() <<" seconds\n";
+  std::cout <<"checksum: " <<(valid ? "ok" : "error") <<std::endl;
+  return valid ? 0 : 1;
+} // End method exec
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Method checkParameters
+ *
+ * Controlla i parametri, verificando che esistano quelli obbligatori, che i
+ * valori abbiano senso, ed assegnando un valore ad ogni variabile che
+ * corrisponde ad un parametro. In caso di errore sui parametri restituisce
+ * false.
+ */
+bool NNConvert::checkParameters ( ) {
+  std::vector<std::string> required;
+  std::vector<std::string> missingarg;
+  // --nnfile (conversione di una rete neurale)
+  if (Global::getParam("nnfile") == "nnfile")
+    missingarg.push_back("--nnfile");
+  else nnfile = Global::getParam("nnfile");
+  if (!Global::getParam("nnfile").empty()) {
+    // --nnout
+    if (Global::getParam("nnout").empty())
+      required.push_back("--nnout");
+    else if (Global::getParam("nnout") == "nnout")
+      missingarg.push_back("--nnout");
+    else nnout = Global::getParam("nnout");
+  }
+  else {
+    // --inputs
+    if (Global::getParam("inputs").empty())
+      required.push_back("--inputs");
+    else if (Global::getParam("inputs") == "inputs")
+      missingarg.push_back("--inputs");
+    else inputs = Global::toUint(Global::getParam("inputs"));
+    // --outputs
+    if (Global::getParam("outputs").empty())
+      required.push_back("--outputs");
+    else if (Global::getParam("outputs") == "outputs")
+      missingarg.push_back("--outputs");
+    else outputs = Global::toUint(Global::getParam("outputs"));
+    // --dsfile
+    if (Global::getParam("dsfile").empty())
+      required.push_back("--dsfile");
+    else if (Global::getParam("dsfile") == "dsfile")
+      missingarg.push_back("--dsfile");
+    else dsfile = Global::getParam("dsfile");
+    // --binfile
+    if (Global::getParam("binfile").empty())
+      required.push_back("--binfile");
+    else if (Global::getParam("binfile") == "binfile")
+      missingarg.push_back("--binfile");
+    else binfile = Global::getParam("binfile");
+  }
+  // --precision
+  if (Global::getParam("precision").empty())
+    precision = 64; // valore di default
+  else if (Global::getParam("precision") == "precision")
+    missingarg.push_back("--precision");
+  else precision = Global::toUint(Global::getParam("precision"));
+  // controlla se ci sono errori
+  if (!required.empty()) {
+    std::cout <<"The follow parameters are required (in convert mode)";
+    std::cout <<std::endl;
+    for (std::size_t i = 0; i < required.size(); ++i)
+      std::cout <<"  " <<required[i] <<std::endl;
+    return false;
+  }
+  if (!missingarg.empty()) {
+    std::cout <<"The follow parameters requires an argument (in convert mode)";
+    std::cout <<std::endl;
+    for (std::size_t i = 0; i < missingarg.size(); ++i)
+      std::cout <<"  " <<missingarg[i] <<std::endl;
+    return false;
+  }
+  // verifica i valori dei parametri
+  if (precision != 64 && precision != 32) {
+    std::cout <<"Parameter --precision must be 64 or 32" <<std::endl;
+    return false;
+  }
+  return true;
+} // End method checkParameters
+
+/**
+ * Method convertModel
+ *
+ * Converte la rete neurale nel file nnfile nell'altro formato: da testuale a
+ * binario (con la precisione indicata, controllando il file prodotto) o da
+ * binario a testuale, salvandola nel file nnout. Stampa le caratteristiche
+ * della rete e i tempi di lettura e scrittura dei due file. Restituisce 0 se
+ * la conversione e` avvenuta correttamente.
+ */
+int NNConvert::convertModel() {
+  // Carica la rete neurale
+  const bool binary = NeuralNetwork::isBinary(nnfile);
+  timeval tstart, tend;
+  NeuralNetwork nn;
+  gettimeofday(&tstart, NULL);
+  nn.loadFromFile(nnfile);
+  gettimeofday(&tend, NULL);
+  printModelInfo(nn);
+  std::cout <<"format: " <<(binary ? "binary" : "text") <<"\n";
+  std::cout <<"load time: " <<elapsed(tstart, tend) <<" seconds\n";
+
+  // Salva la rete nell'altro formato
+  gettimeofday(&tstart, NULL);
+  if (binary) nn.saveOnFile(nnout);
+  else nn.saveBinary(nnout, precision);
+  gettimeofday(&tend, NULL);
+  const bool valid = binary || NeuralNetwork::checkBinary(nnout);
+
+  // Rilegge il file prodotto (per misurarne il tempo di caricamento)
+  timeval lstart, lend;
+  NeuralNetwork converted;
+  gettimeofday(&lstart, NULL);
+  converted.loadFromFile(nnout);
+  gettimeofday(&lend, NULL);
+
+  // Stampa le caratteristiche del file prodotto
+  std::cout <<"# " <<(binary ? "text" : "binary") <<" model" <<std::endl;
+  std::cout <<"file: " <<nnout <<"\n";
+  if (!binary) std::cout <<"precision: " <<precision <<" bits\n";
+  std::cout <<"write time: " <<elapsed(tstart, tend) <<" seconds\n";
+  std::cout <<"load time: " <<elapsed(lstart, lend) <<" seconds" <<std::endl;
+  if (!binary)
+    std::cout <<"checksum: " <<(valid ? "ok" : "error") <<std::endl;
+  return valid ? 0 : 1;
+} // End method convertModel
+
+/**
+ * Method printModelInfo
+ *
+ * Stampa su standard output le informazioni relative alla rete neurale
+ * caricata (topologia e numero di pesi).
+ */
+void NNConvert::printModelInfo(const NeuralNetwork& nn) {
+  std::cout <<"# neural network" <<std::endl;
+  std::cout <<"file: " <<nnfile <<"\n";
+  std::cout <<"inputs: " <<nn.getNumberOfInputs() <<"\n";
+  std::cout <<"units: " <<nn.getNumberOfUnits(0);
+  for (uint i = 1; i < nn.getNumberOfLayers(); ++i)
+    std::cout <<"," <<nn.getNumberOfUnits(i);
+  std::cout <<"\n";
+  std::cout <<"weights: " <<nn.getNumberOfWeights() <<"\n";
+  return;
+} // End method printModelInfo
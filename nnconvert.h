@@ -0,0 +1,52 @@
+#ifndef NNCONVERT_H_
+#define NNCONVERT_H_
+
+#include <string>
+#include "global.h"
+#include "dataset.h"
+#include "neuralnetwork.h"
+
+typedef Global::uint uint;
+
+/**
+ * Converte un dataset in formato csv nel formato binario della classe Dataset
+ * (vedere Dataset::saveBinary), che puo` poi essere utilizzato al posto del
+ * file csv in tutte le modalita` (--trfile, --dsfile) senza dover analizzare
+ * il testo ad ogni esecuzione.
+ * Si aspetta i seguenti parametri globali obbligatori:
+ *   --inputs     numero di inputs del dataset.
+ *   --outputs    numero di outputs del dataset.
+ *   --dsfile     nome del file con il dataset da convertire.
+ *   --binfile    nome del file in cui salvare il dataset in formato binario.
+ * Ed i seguenti parametri opzionali:
+ *   --precision  bits per ogni valore nel file binario: 64 (default, valori
+ *                identici a quelli letti dal csv) oppure 32.
+ * Dopo la conversione il file prodotto viene controllato (vedere
+ * Dataset::checkBinary).
+ * Con il parametro --nnfile viene invece convertita una rete neurale, nei due
+ * sensi tra il formato testuale e quello binario della classe NeuralNetwork
+ * (vedere NeuralNetwork::saveBinary), con i seguenti parametri obbligatori:
+ *   --nnfile     nome del file con la rete neurale da convertire: se e` in
+ *                formato testuale viene salvata in formato binario, se e` in
+ *                formato binario viene salvata in formato testuale.
+ *   --nnout      nome del file in cui salvare la rete convertita.
+ * Ed il parametro opzionale --precision (bits per ogni peso nel file binario).
+ */
+class NNConvert
+{
+  public:
+    static int exec ( );
+
+  private:
+    // parametri
+    static uint inputs, outputs, precision;
+    static std::string dsfile, binfile;
+    static std::string nnfile, nnout;
+
+    static bool checkParameters ( );
+    static int convertModel ( );
+    static void printModelInfo ( const NeuralNetwork& nn );
+
+}; // End Class NNConvert
+
+#endif /* NNCONVERT_H_ */
@@ -1,15 +1,73 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <algorithm>
-#include <vector>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <cmath>
 #include "global.h"
+#include "random.h"
 #include "exception.h"
 
 typedef Global::uint uint;
 
+// Dimensione dei blocchi letti dal file di input
+static const std::size_t READ_BYTES = 1 << 20;
+// Memoria complessiva per i buffer dei file di output
+static const std::size_t WRITE_BYTES = 64 << 20;
+// Dimensione minima del buffer di ogni file di output
+static const std::size_t MIN_WRITE_BYTES = 64 << 10;
+
+/**
+ * Class Output
+ *
+ * File di output con un buffer proprio, di dimensione fissata alla creazione,
+ * scaricato su disco solo quando e` pieno (e alla chiusura del file).
+ */
+class Output
+{
+  public:
+    Output ( const std::string& filename, std::size_t bufsize ) :
+        filename(filename), buffer(bufsize), used(0) {
+      file = std::fopen(filename.c_str(), "wb");
+      if (file == NULL) throw file_error("Cannot create " + filename);
+    }
+    ~Output ( ) { if (file != NULL) std::fclose(file); }
+
+    void write ( const char* row, std::size_t length ) {
+      if (used + length + 1 > buffer.size()) flush();
+      if (length + 1 > buffer.size()) {
+        put(row, length);
+        put("\n", 1);
+        return;
+      }
+      std::memcpy(&buffer[used], row, length);
+      used += length;
+      buffer[used++] = '\n';
+    }
+    void close ( ) {
+      flush();
+      const int result = std::fclose(file);
+      file = NULL;
+      if (result != 0) throw file_error("Cannot write " + filename);
+    }
+
+  private:
+    std::string filename;
+    std::FILE* file;
+    std::vector<char> buffer;
+    std::size_t used;
+
+    void flush ( ) {
+      put(buffer.data(), used);
+      used = 0;
+    }
+    void put ( const char* data, std::size_t length ) {
+      if (std::fwrite(data, 1, length, file) != length)
+        throw file_error("Cannot write " + filename);
+    }
+}; // End class Output
+
 /**
  * Function printHelp
  *
@@ -18,8 +76,11 @@ typedef Global::uint uint;
 void printHelp() {
   std::cout <<"argv[1] : nome del file" <<std::endl;
   std::cout <<"argv[2] : numero totale di partizioni" <<std::endl;
-  std::cout <<"argv[3] : partizione di test in [0,n-1]" <<std::endl;
+  std::cout <<"argv[3] : partizione di test in [0,n-1], oppure all per"
+            <<" scrivere tutte le partizioni" <<std::endl;
   std::cout <<"argv[4] : seme per numeri casuali" <<std::endl;
+  std::cout <<"argv[5] : (opzionale) hash per assegnare le righe alle"
+            <<" partizioni in una sola lettura" <<std::endl;
   return;
 } // End function printHelp
 
@@ -50,16 +111,76 @@ uint end(uint tot, uint n, uint k) {
   return begin(tot,n,k+1);
 } // End function end
 
+/**
+ * Function readRows
+ *
+ * Legge il file filename a blocchi di READ_BYTES bytes e invoca row(p, l) per
+ * ogni riga non vuota (p punta al primo carattere e l e` la lunghezza, senza
+ * il carattere di fine riga). In memoria resta un solo blocco alla volta (piu`
+ * l'eventuale riga incompleta alla fine del blocco).
+ */
+template <class F>
+void readRows(const std::string& filename, F row) {
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (file == NULL) throw file_error("Cannot open " + filename);
+  std::vector<char> buffer(READ_BYTES);
+  std::size_t used = 0;
+  bool eof = false;
+  while (!eof) {
+    if (used == buffer.size()) buffer.resize(2 * buffer.size());
+    const std::size_t n = std::fread(&buffer[used], 1,
+        buffer.size() - used, file);
+    if (n == 0) {
+      if (std::ferror(file)) {
+        std::fclose(file);
+        throw file_error("Cannot read " + filename);
+      }
+      // l'ultima riga puo` non terminare con il carattere di fine riga
+      if (used == 0) break;
+      buffer[used++] = '\n';
+      eof = true;
+    }
+    else used += n;
+    const char* first = buffer.data();
+    const char* last = buffer.data() + used;
+    const char* next;
+    while ((next = static_cast<const char*>(
+        std::memchr(first, '\n', last - first))) != NULL) {
+      std::size_t length = next - first;
+      if (length > 0 && first[length-1] == '\r') --length;
+      if (length > 0) row(first, length);
+      first = next + 1;
+    }
+    used = last - first;
+    std::memmove(buffer.data(), first, used);
+  }
+  std::fclose(file);
+  return;
+} // End function readRows
+
 /**
  * Function main
  *
- * Divide il file passato in due file .ts e .tr, il primo che rappresenta la
- * partizione richieste, il secondo l'unione delle altre partizioni.
+ * Divide il file passato in partizioni: per la partizione k scrive i file .ts,
+ * con le righe della partizione, e .tr, con l'unione delle altre partizioni;
+ * passando all al posto di k scrive in una sola lettura del file le coppie di
+ * file .<k>.ts e .<k>.tr di tutte le partizioni (per la k-fold cross
+ * validation). Le righe mantengono l'ordine del file di input.
+ * Le righe vengono assegnate alle partizioni durante la lettura, senza
+ * caricare il file in memoria: il file viene letto una prima volta per
+ * contare le righe, poi ogni riga viene assegnata a una partizione estraendo
+ * a caso uno dei posti rimasti liberi (campionamento sequenziale), per cui
+ * le partizioni hanno dimensioni uguali (a meno di una riga) come con una
+ * permutazione casuale. Con il parametro hash il file viene letto una sola
+ * volta e la riga i viene assegnata alla partizione data dalla sottosequenza
+ * i del seme (vedere la classe Random): le dimensioni delle partizioni sono
+ * solo approssimativamente uguali, ma la partizione di ogni riga non dipende
+ * dal numero di righe del file.
  * Mantenendo lo stesso seme casuale si ottengono sempre le stesse partizioni
  * (percui si puo` ruotare il .ts).
  */
 int main(int argc, char **argv) {
-  if (argc == 1) {
+  if (argc < 5) {
     printHelp();
     return 0;
   }
@@ -67,61 +188,62 @@ int main(int argc, char **argv) {
   // Legge i parametri
   std::string filename(argv[1]);
   uint n = Global::toUint(std::string(argv[2]));
-  uint k = Global::toUint(std::string(argv[3]));
+  const bool all = (std::string(argv[3]) == "all");
+  uint k = all ? 0 : Global::toUint(std::string(argv[3]));
   uint rseed = Global::toUint(std::string(argv[4]));
+  const bool hash = (argc > 5 && std::string(argv[5]) == "hash");
+  if (n == 0 || (!all && k >= n))
+    throw std::invalid_argument("In function main");
+
+  // Conta le righe e calcola le dimensioni delle partizioni
+  std::vector<unsigned long long> slots(n, 0);
+  unsigned long long remaining = 0;
+  if (!hash) {
+    uint tot = 0;
+    readRows(filename, [&tot](const char*, std::size_t) { ++tot; });
+    for (uint f = 0; f < n; ++f) slots[f] = end(tot,n,f) - begin(tot,n,f);
+    remaining = tot;
+  }
 
-  // Inizializza il generatore di numeri casuali
-  Global::setRandSeed(rseed);
-
-  // Carica il file in memoria (riga per riga)
-  std::vector<std::string*> filebuffer;
-  std::string* line;
-  std::ifstream infile(filename.c_str());
-  if (!infile.is_open())
-    throw file_error("In function main");
-  while (infile.good()) {
-    line = new std::string();
-    std::getline(infile, *line);
-    filebuffer.push_back(line);
-  } // end while (file.good())
-  infile.close();
-
-  // Crea un vettore di permutazione casuale
-  std::vector<uint> p(filebuffer.size());
-  for (uint i = 0; i < p.size(); ++i) p[i] = i;
-  for (uint i = p.size(); i != 0; --i)
-    std::swap( p[i-1], p[Global::getRand(0,i-1)] );
-
-  // Crea gli indici per i due file
-  std::vector<uint> trindex, tsindex;
-  for (uint i = 0; i < p.size(); ++i) {
-    if (i < begin(filebuffer.size(),n,k) || i >= end(filebuffer.size(),n,k))
-      trindex.push_back(p[i]);
-    else
-      tsindex.push_back(p[i]);
+  // Crea i file di output
+  std::vector<Output*> tsfiles, trfiles;
+  const uint nfiles = all ? n : 1;
+  const std::size_t bufsize = std::max(MIN_WRITE_BYTES,
+      WRITE_BYTES / (2 * nfiles));
+  for (uint f = 0; f < nfiles; ++f) {
+    std::string name = all ? filename + "." + Global::toString(f) : filename;
+    tsfiles.push_back(new Output(name + ".ts", bufsize));
+    trfiles.push_back(new Output(name + ".tr", bufsize));
   }
 
-  // Ordina gli indici delle partizioni
-  std::sort(trindex.begin(), trindex.end());
-  std::sort(tsindex.begin(), tsindex.end());
-
-  // Scrive la partizione tr su file
-  std::string trname = filename + ".tr";
-  std::ofstream trfile(trname.c_str());
-  if (!trfile.is_open())
-    throw file_error("In function main");
-  for (uint i = 0; i < trindex.size(); ++i)
-    trfile <<*(filebuffer[trindex[i]]) <<std::endl;
-  trfile.close();
-
-  // Scrive le partizione ts su file
-  std::string tsname = filename + ".ts";
-  std::ofstream tsfile(tsname.c_str());
-  if (!tsfile.is_open())
-    throw file_error("In function main");
-  for (uint i = 0; i < tsindex.size(); ++i)
-    tsfile <<*(filebuffer[tsindex[i]]) <<std::endl;
-  tsfile.close();
+  // Assegna ogni riga a una partizione e la scrive nei file
+  Random random(rseed);
+  unsigned long long i = 0;
+  readRows(filename, [&](const char* row, std::size_t length) {
+    uint fold = 0;
+    if (hash) fold = Random(rseed, ++i).uniform(n);
+    else {
+      if (remaining == 0) throw read_error("File changed: " + filename);
+      unsigned long long u = random.uniform(remaining--);
+      while (u >= slots[fold]) u -= slots[fold++];
+      --slots[fold];
+    }
+    if (!all) {
+      if (fold == k) tsfiles[0]->write(row, length);
+      else trfiles[0]->write(row, length);
+      return;
+    }
+    tsfiles[fold]->write(row, length);
+    for (uint f = 0; f < n; ++f)
+      if (f != fold) trfiles[f]->write(row, length);
+  });
+
+  for (uint f = 0; f < nfiles; ++f) {
+    tsfiles[f]->close();
+    trfiles[f]->close();
+    delete tsfiles[f];
+    delete trfiles[f];
+  }
 
   return 0;
 } // End function main
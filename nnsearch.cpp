@@ -0,0 +1,308 @@
+#include "nnsearch.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include "global.h"
+#include "exception.h"
+#include "neuralnetwork.h"
+#include "backpropagation.h"
+#include "scheduler.h"
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+Scheduler* NNSearch::sc;
+uint NNSearch::inputs, NNSearch::outputs, NNSearch::hlayers;
+std::vector<uint> NNSearch::units;
+std::vector<real> NNSearch::etas, NNSearch::alphas, NNSearch::lambdas;
+std::string NNSearch::trfile, NNSearch::nnsave;
+uint NNSearch::folds, NNSearch::minepochs, NNSearch::maxepochs;
+uint NNSearch::reduction, NNSearch::shuffle;
+real NNSearch::threshold;
+
+// =====================
+// PUBLIC STATIC METHODS
+// =====================
+
+/**
+ * Method exec
+ *
+ * Esegue i seguenti passi:
+ *   - Controlla i parametri globali necessari.
+ *   - Carica il dataset e lo divide in partizioni.
+ *   - Costruisce una configurazione per ogni combinazione di eta, alpha e
+ *     lambda.
+ *   - Avvia la ricerca successive halving.
+ *   - Stampa i risultati di ogni configurazione e salva (se richiesto) la rete
+ *     neurale migliore.
+ * Restituisce 0 se l'esecuzione e` avvenuta correttamente, un numero diverso
+ * da 0 se ci sono stati errori (per esempio mancano dei parametri).
+ */
+int NNSearch::exec() {
+  // Legge e controlla i parametri
+  if (!checkParameters()) return -1;
+
+  // Stampa il seme casuale impostato
+  std::cout <<"random seed used: " <<Global::getRandSeed() <<std::endl;
+
+  // Carica e partiziona il dataset, condiviso da tutte le configurazioni
+  sc = new Scheduler();
+  sc->setDataSet(trfile, inputs, outputs);
+  sc->setFolds(folds);
+  sc->setMinEpochs(minepochs);
+  sc->setMaxEpochs(maxepochs);
+  sc->setReduction(reduction);
+  sc->setShuffleEpochs(shuffle);
+  sc->setThreshold(threshold);
+
+  // Costruisce una configurazione per ogni combinazione dei parametri
+  units.push_back(outputs);
+  for (uint i = 0; i < etas.size(); ++i)
+    for (uint j = 0; j < alphas.size(); ++j)
+      for (uint k = 0; k < lambdas.size(); ++k) {
+        NeuralNetwork* nn = new NeuralNetwork(inputs, hlayers+1, units);
+        BackPropagation* bp = new BackPropagation();
+        bp->setLearningRate(etas[i]);
+        bp->setMomentumRate(alphas[j]);
+        bp->setRegularizationRate(lambdas[k]);
+        sc->addConfiguration(nn, bp);
+      }
+
+  // Avvia la ricerca
+  std::cout <<std::endl;
+  std::cout <<"# successive halving search" <<std::endl;
+  std::cout <<"configurations: " <<sc->getNumberOfConfigurations() <<"\n";
+  std::cout <<"epochs: " <<minepochs <<" to " <<maxepochs;
+  std::cout <<" (reduction " <<reduction <<")" <<std::endl;
+  std::cout <<std::endl;
+  sc->start();
+
+  // Stampa i risultati e salva la rete migliore
+  printSearchResults();
+  if (!nnsave.empty())
+    sc->getTrainer(sc->getBest()).getBestModel().saveOnFile(nnsave);
+
+  // Elimina le strutture create e termina
+  delete sc;
+  return 0;
+} // End method exec
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Method checkParameters
+ *
+ * Controlla i parametri, verificando che esistano quelli obbligatori, che i
+ * valori abbiano senso, ed assegnando un valore ad ogni variabile che
+ * corrisponde ad un parametro. In caso di errore sui parametri restituisce
+ * false.
+ */
+bool NNSearch::checkParameters ( ) {
+  std::vector<std::string> required;
+  std::vector<std::string> missingarg;
+  std::string strunits;
+  // legge i parametri
+  // --inputs
+  if (Global::getParam("inputs").empty())
+    required.push_back("--inputs");
+  else if (Global::getParam("inputs") == "inputs")
+    missingarg.push_back("--inputs");
+  else inputs = Global::toUint(Global::getParam("inputs"));
+  // --outputs
+  if (Global::getParam("outputs").empty())
+    required.push_back("--outputs");
+  else if (Global::getParam("outputs") == "outputs")
+    missingarg.push_back("--outputs");
+  else outputs = Global::toUint(Global::getParam("outputs"));
+  // --hlayers
+  if (Global::getParam("hlayers").empty())
+    required.push_back("--hlayers");
+  else if (Global::getParam("hlayers") == "hlayers")
+    missingarg.push_back("--hlayers");
+  else hlayers = Global::toUint(Global::getParam("hlayers"));
+  // --units
+  if (Global::getParam("units").empty())
+    required.push_back("--units");
+  else if (Global::getParam("units") == "units")
+    missingarg.push_back("--units");
+  else strunits = Global::getParam("units");
+  // --eta
+  if (Global::getParam("eta").empty())
+    required.push_back("--eta");
+  else if (Global::getParam("eta") == "eta")
+    missingarg.push_back("--eta");
+  else readList("eta", etas);
+  // --trfile
+  if (Global::getParam("trfile").empty())
+    required.push_back("--trfile");
+  else if (Global::getParam("trfile") == "trfile")
+    missingarg.push_back("--trfile");
+  else trfile = Global::getParam("trfile");
+  // --alpha
+  if (Global::getParam("alpha").empty())
+    alphas.push_back(0.0); // valore di default
+  else if (Global::getParam("alpha") == "alpha")
+    missingarg.push_back("--alpha");
+  else readList("alpha", alphas);
+  // --lambda
+  if (Global::getParam("lambda").empty())
+    lambdas.push_back(0.0); // valore di default
+  else if (Global::getParam("lambda") == "lambda")
+    missingarg.push_back("--lambda");
+  else readList("lambda", lambdas);
+  // --folds
+  if (Global::getParam("folds").empty())
+    folds = 10; // valore di default
+  else if (Global::getParam("folds") == "folds")
+    missingarg.push_back("--folds");
+  else folds = Global::toUint(Global::getParam("folds"));
+  // --minepochs
+  if (Global::getParam("minepochs").empty())
+    minepochs = 1; // valore di default
+  else if (Global::getParam("minepochs") == "minepochs")
+    missingarg.push_back("--minepochs");
+  else minepochs = Global::toUint(Global::getParam("minepochs"));
+  // --maxepochs
+  if (Global::getParam("maxepochs").empty())
+    maxepochs = 81; // valore di default
+  else if (Global::getParam("maxepochs") == "maxepochs")
+    missingarg.push_back("--maxepochs");
+  else maxepochs = Global::toUint(Global::getParam("maxepochs"));
+  // --reduction
+  if (Global::getParam("reduction").empty())
+    reduction = 3; // valore di default
+  else if (Global::getParam("reduction") == "reduction")
+    missingarg.push_back("--reduction");
+  else reduction = Global::toUint(Global::getParam("reduction"));
+  // --shuffle
+  if (Global::getParam("shuffle").empty())
+    shuffle = 0; // valore di default
+  else if (Global::getParam("shuffle") == "shuffle")
+    missingarg.push_back("--shuffle");
+  else shuffle = Global::toUint(Global::getParam("shuffle"));
+  // --threshold
+  if (Global::getParam("threshold").empty())
+    threshold = 0.5; // valore di default
+  else if (Global::getParam("threshold") == "threshold")
+    missingarg.push_back("--threshold");
+  else threshold = Global::toReal(Global::getParam("threshold"));
+  // --nnsave
+  if (Global::getParam("nnsave").empty())
+    nnsave = ""; // valore di default
+  else if (Global::getParam("nnsave") == "nnsave")
+    missingarg.push_back("--nnsave");
+  else nnsave = Global::getParam("nnsave");
+  // controlla se ci sono errori
+  if (!required.empty()) {
+    std::cout <<"The follow parameters are required (in search mode)";
+    std::cout <<std::endl;
+    for (std::size_t i = 0; i < required.size(); ++i)
+      std::cout <<"  " <<required[i] <<std::endl;
+    return false;
+  }
+  if (!missingarg.empty()) {
+    std::cout <<"The follow parameters requires an argument (in search mode)";
+    std::cout <<std::endl;
+    for (std::size_t i = 0; i < missingarg.size(); ++i)
+      std::cout <<"  " <<missingarg[i] <<std::endl;
+    return false;
+  }
+  // controlla i valori dei parametri
+  // --units
+  std::vector<std::string>* strunitsplit = Global::split(strunits,',');
+  if (strunitsplit->size() != hlayers) {
+    std::cout <<"Parameter --units has invalid number of values" <<std::endl;
+    delete strunitsplit;
+    return false;
+  }
+  for (std::size_t i = 0; i < hlayers; ++i)
+    units.push_back( Global::toUint(strunitsplit->at(i)) );
+  delete strunitsplit;
+  // --folds
+  if (folds < 2) {
+    std::cout <<"Parameter --folds must be at least 2" <<std::endl;
+    return false;
+  }
+  // --maxepochs
+  if (maxepochs == 0 || minepochs > maxepochs) {
+    std::cout <<"Parameter --maxepochs must be at least --minepochs";
+    std::cout <<std::endl;
+    return false;
+  }
+  // --reduction
+  if (reduction < 2) {
+    std::cout <<"Parameter --reduction must be at least 2" <<std::endl;
+    return false;
+  }
+  // --threshold
+  if (threshold < 0 || threshold  > 1) {
+    std::cout <<"Parameter --threshold must a number in [0,1]" <<std::endl;
+    return false;
+  }
+  return true;
+} // End method checkParameters
+
+/**
+ * Method readList
+ *
+ * Legge nel vettore list i valori (separati da virgola) del parametro globale
+ * con nome name.
+ */
+bool NNSearch::readList(const std::string& name, std::vector<real>& list) {
+  std::vector<std::string>* values = Global::split(Global::getParam(name), ',');
+  for (std::size_t i = 0; i < values->size(); ++i)
+    list.push_back(Global::toReal(values->at(i)));
+  delete values;
+  return !list.empty();
+} // End method readList
+
+/**
+ * Method printConfiguration
+ *
+ * Stampa su standard output i parametri e i risultati dell'i-esima
+ * configurazione.
+ */
+void NNSearch::printConfiguration(uint i) {
+  // le configurazioni sono create nell'ordine eta, alpha, lambda
+  uint k = i % lambdas.size();
+  uint j = (i / lambdas.size()) % alphas.size();
+  uint e = i / (lambdas.size() * alphas.size());
+  const Trainer& tr = sc->getTrainer(i);
+  std::cout <<"eta " <<etas[e] <<", alpha " <<alphas[j];
+  std::cout <<", lambda " <<lambdas[k] <<": ";
+  std::cout <<"round " <<sc->getRoundReached(i);
+  std::cout <<", epochs " <<tr.getEpochs();
+  std::cout <<", va. error min. " <<tr.getMinValidationError().first;
+  std::cout <<" (" <<tr.getMinValidationError().second <<")";
+  std::cout <<", va. accuracy max. " <<tr.getMaxValidationAccuracy().first;
+  std::cout <<std::endl;
+  return;
+} // End method printConfiguration
+
+/**
+ * Method printSearchResults
+ *
+ * Stampa su standard output i risultati della ricerca: i risultati di ogni
+ * configurazione, la configurazione migliore e il numero di epoche eseguite
+ * rispetto a quelle necessarie per addestrare tutte le configurazioni fino al
+ * numero massimo di epoche.
+ */
+void NNSearch::printSearchResults() {
+  std::cout <<"# configurations results" <<std::endl;
+  for (uint i = 0; i < sc->getNumberOfConfigurations(); ++i)
+    printConfiguration(i);
+  std::cout <<std::endl;
+  std::cout <<"# best configuration" <<std::endl;
+  printConfiguration(sc->getBest());
+  std::cout <<std::endl;
+  std::cout <<"# search results" <<std::endl;
+  std::cout <<"rounds: " <<sc->getRounds() <<"\n";
+  std::cout <<"total epochs: " <<sc->getTotalEpochs();
+  std::cout <<" (full grid " <<sc->getNumberOfConfigurations()*maxepochs;
+  std::cout <<")" <<std::endl;
+  return;
+} // End method printSearchResults
@@ -0,0 +1,70 @@
+#ifndef NNSEARCH_H_
+#define NNSEARCH_H_
+
+#include <vector>
+#include <string>
+#include "global.h"
+#include "scheduler.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Costruisce una configurazione (rete neurale e algoritmo di back-propagation)
+ * per ogni combinazione dei valori di eta, alpha e lambda passati e, tramite la
+ * classe Scheduler, cerca la configurazione migliore con la strategia
+ * successive halving: le configurazioni peggiori (per errore di validation)
+ * vengono abbandonate dopo poche epoche e solo le migliori proseguono il
+ * training fino al numero massimo di epoche.
+ * I parametri sono parametri globali:
+ *   --inputs     numero di inputs della rete neurale.
+ *   --outputs    numero di outputs della rete neurale.
+ *   --hlayers    numero di strati nascosti.
+ *   --units      numero di unita` per ogni strato nascosto, in una unica
+ *                stringa con valori separati da virgola.
+ *   --eta        valori del learning rate da provare, separati da virgola.
+ *   --trfile     file contenente le istanze per il training
+ * Ed i seguenti parametri opzionali:
+ *   --alpha      valori del momentum rate da provare, separati da virgola
+ *                (default 0).
+ *   --lambda     valori del regularization rate da provare, separati da
+ *                virgola (default 0).
+ *   --folds      numero di partizioni in cui viene diviso il dataset; la prima
+ *                viene usata come validation set (default 10, almeno 2).
+ *   --minepochs  numero di epoche del primo turno (default 1).
+ *   --maxepochs  numero massimo di epoche per configurazione (default 81).
+ *   --reduction  fattore di riduzione: ad ogni turno viene promosso 1/r delle
+ *                configurazioni e le epoche vengono moltiplicate per r
+ *                (default 3).
+ *   --shuffle    numero di epoche ogni cui riordinare il training set
+ *                (default 0).
+ *   --threshold  soglia per la classificazione (default 0.5).
+ *   --nnsave     salva nel file specificato la rete neurale della
+ *                configurazione migliore (con i pesi dell'epoca con il minimo
+ *                errore di validation).
+ */
+class NNSearch
+{
+  public:
+    static int exec ( );
+
+  private:
+    static Scheduler* sc;
+    // parametri della rete neurale
+    static uint inputs, outputs, hlayers;
+    static std::vector<uint> units;
+    // valori da provare per l'algoritmo di back-propagation
+    static std::vector<real> etas, alphas, lambdas;
+    // parametri per la ricerca
+    static std::string trfile, nnsave;
+    static uint folds, minepochs, maxepochs, reduction, shuffle;
+    static real threshold;
+
+    static bool checkParameters ( );
+    static bool readList ( const std::string& name, std::vector<real>& list );
+    static void printConfiguration ( uint i );
+    static void printSearchResults ( );
+
+}; // End class NNSearch
+
+#endif /* NNSEARCH_H_ */
@@ -1,12 +1,12 @@
 #include "nntest.h"
 
 #include <iostream>
-#include <fstream>
 #include <string>
 #include "global.h"
 #include "exception.h"
 #include "tester.h"
 #include "neuralnetwork.h"
+#include "ensemble.h"
 
 // ======================
 // PRIVATE STATIC MEMBERS
@@ -14,7 +14,9 @@
 
 Tester* NNTest::ts;
 NeuralNetwork* NNTest::nn;
-bool NNTest::output;
+Ensemble* NNTest::en;
+bool NNTest::output, NNTest::tsthread;
+uint NNTest::ensemble, NNTest::testthreads;
 std::string NNTest::nnfile, NNTest::dsfile, NNTest::tssave;
 real NNTest::threshold;
 
@@ -27,8 +29,9 @@ real NNTest::threshold;
  *
  * Esegue i seguenti passi:
  *   - Controlla i parametri globali necessari
- *   - Carica la rete neurale da file
+ *   - Carica la rete neurale (o le reti dell'ensemble) da file
  *   - Stampa le caratteristiche della rete neurale
+ *   - Carica il dataset e ne stampa le caratteristiche
  *   - Costruisce e avvia il test (salvando le risposte se richiesto)
  *   - Stampa i risultati del test
  * Restituisce 0 se l'esecuzione e` avvenuta correttamente, un numero diverso
@@ -39,19 +42,31 @@ int NNTest::exec() {
   if (!checkParameters()) return -1;
 
   // Carica la rete neurale dal file
-  nn = new NeuralNetwork();
-  std::ifstream ifs(nnfile.c_str());
-  if (!ifs.is_open()) throw file_error("In NNTest::exec");
-  ifs >>(*nn);
+  nn = NULL;
+  en = NULL;
+  if (ensemble == 0) {
+    nn = new NeuralNetwork();
+    nn->loadFromFile(nnfile);
+  }
+  // o le reti dell'ensemble dai files nnfile-1, ..., nnfile-k
+  else {
+    en = new Ensemble();
+    en->load(nnfile, ensemble);
+  }
 
   // Stampa le caratteristiche della rete neurale caricata
   printNeuralNetworkInfo();
 
   // Costruisce il test passandogli i parametri
-  ts = new Tester(nn, output);
+  if (en != NULL) ts = new Tester(en, output);
+  else ts = new Tester(nn, output);
   ts->setDataSet(dsfile);
-  if (!tssave.empty()) ts->setSaveModelResponses(tssave);
+  if (!tssave.empty()) ts->setSaveModelResponses(tssave, tsthread);
   ts->setThreshold(threshold);
+  ts->setThreads(testthreads);
+
+  // Stampa le caratteristiche del dataset caricato
+  printDatasetInfo(dsfile, ts->getDataSet());
 
   // Avvia il test
   ts->start();
@@ -61,10 +76,33 @@ int NNTest::exec() {
 
   // Elimina le strutture utilizzate e termina
   delete nn;
+  delete en;
   delete ts;
   return 0;
 } // End method exec
 
+/**
+ * Method printDatasetInfo
+ *
+ * Stampa su standard output le informazioni relative al dataset passato,
+ * caricato dal file file, tra cui la velocita` di caricamento (istanze e
+ * megabytes al secondo). Utilizzato anche dalle modalita` training e convert.
+ */
+void NNTest::printDatasetInfo(const std::string& file,
+    const Dataset& dataset) {
+  const double t = dataset.getLoadTime();
+  std::cout <<"# dataset" <<std::endl;
+  std::cout <<"file: " <<file <<"\n";
+  std::cout <<"instances: " <<dataset.getSize() <<"\n";
+  std::cout <<"load time: " <<t <<" seconds";
+  if (t > 0) {
+    std::cout <<" (" <<dataset.getSize() / t <<" rows/s, ";
+    std::cout <<dataset.getLoadBytes() / 1e6 / t <<" MB/s)";
+  }
+  std::cout <<"\n";
+  return;
+} // End of method printDatasetInfo
+
 // ======================
 // PRIVATE STATIC METHODS
 // ======================
@@ -103,12 +141,28 @@ bool NNTest::checkParameters ( ) {
   else if (Global::getParam("tssave") == "tssave")
     missingarg.push_back("--tssave");
   else tssave = Global::getParam("tssave");
+  // --tsthread
+  if (Global::getParam("tsthread").empty())
+    tsthread = false; // valore di default
+  else tsthread = true;
   // --threshold
   if (Global::getParam("threshold").empty())
     threshold = 0.5; // valore di default
   else if (Global::getParam("threshold") == "threshold")
     missingarg.push_back("--threshold");
   else threshold = Global::toReal(Global::getParam("threshold"));
+  // --ensemble
+  if (Global::getParam("ensemble").empty())
+    ensemble = 0; // valore di default
+  else if (Global::getParam("ensemble") == "ensemble")
+    missingarg.push_back("--ensemble");
+  else ensemble = Global::toUint(Global::getParam("ensemble"));
+  // --testthreads
+  if (Global::getParam("testthreads").empty())
+    testthreads = 0; // valore di default
+  else if (Global::getParam("testthreads") == "testthreads")
+    missingarg.push_back("--testthreads");
+  else testthreads = Global::toUint(Global::getParam("testthreads"));
   // controlla se ci sono errori
   if (!required.empty()) {
     std::cout <<"The follow parameters are required (in test mode)";
@@ -139,6 +193,18 @@ bool NNTest::checkParameters ( ) {
  * Stampa su standard output tutte le informazioni relative alla rete neurale.
  */
 void NNTest::printNeuralNetworkInfo() {
+  if (en != NULL) {
+    std::cout <<"# ensemble" <<std::endl;
+    std::cout <<"models: " <<en->getNumberOfModels() <<"\n";
+    std::cout <<"inputs: " <<en->getNumberOfInputs() <<"\n";
+    std::cout <<"outputs: " <<en->getNumberOfOutputs() <<"\n";
+    std::cout <<"hidden layers: " <<en->getNumberOfLayers() - 1 <<"\n";
+    std::cout <<"units in any layer:";
+    for (uint i = 0; i < en->getNumberOfLayers(); ++i)
+      std::cout <<" " <<en->getNumberOfUnits(i);
+    std::cout <<"\n";
+    return;
+  }
   std::cout <<"# neural network" <<std::endl;
   std::cout <<"inputs: " <<nn->getNumberOfInputs() <<"\n";
   std::cout <<"outputs: " <<nn->getNumberOfOutputs() <<"\n";
@@ -5,7 +5,10 @@
 #include "global.h"
 #include "neuralnetwork.h"
 #include "tester.h"
+#include "dataset.h"
+#include "ensemble.h"
 
+typedef Global::uint uint;
 typedef Global::real real;
 
 /**
@@ -21,7 +24,8 @@ typedef Global::real real;
  * modello rispetto al dataset.
  * Si aspetta i seguenti parametri globali obbligatori:
  *   --nnfile     nome del file contenente la rete neurale (prodotta nella
- *                modalita` training).
+ *                modalita` training, in formato testuale o binario, vedere
+ *                NeuralNetwork::loadFromFile).
  *   --dsfile     nome del file con il dataset di test.
  * Ed i seguenti parametri opzionali:
  *   --output     flag per indicare se nel dataset e` presente l'output; se
@@ -34,6 +38,17 @@ typedef Global::real real;
  *   --tssave     salva i risultati del test (le risposte della rete neurale)
  *                nel file specificato, nella forma (csv):
  *                  id, output(1), ..., output(n)
+ *   --tsthread   flag per scrivere il file di --tssave da un thread separato,
+ *                in parallelo al test (vedere la classe ResultWriter).
+ *   --ensemble   numero k di reti da utilizzare insieme (default 0, una sola
+ *                rete): vengono caricate le reti nei files nnfile-1, ...,
+ *                nnfile-k (salvate da --nnsave per ogni fold) e la risposta e`
+ *                la media delle risposte delle reti (vedere la classe
+ *                Ensemble).
+ *   --testthreads numero di threads con cui eseguire il test (default 0, un
+ *                thread per core), ognuno su una partizione del dataset;
+ *                i risultati non dipendono dal numero di threads (vedere
+ *                Tester::setThreads).
  * Il numero di input e di output nel dataset devono essere uguali al numero di
  * input e output della rete neurale.
  */
@@ -41,12 +56,16 @@ class NNTest
 {
   public:
     static int exec ( );
+    static void printDatasetInfo ( const std::string& file,
+        const Dataset& dataset );
 
   private:
     static Tester* ts;
     static NeuralNetwork* nn;
+    static Ensemble* en;
     // parametri
-    static bool output;
+    static bool output, tsthread;
+    static uint ensemble, testthreads;
     static std::string nnfile, dsfile, tssave;
     static real threshold;
 
@@ -1,13 +1,19 @@
 #include "nntraining.h"
 
 #include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <stdexcept>
 #include <sys/time.h>
 #include "global.h"
 #include "exception.h"
 #include "neuralnetwork.h"
 #include "backpropagation.h"
 #include "trainer.h"
+#include "checkpoint.h"
+#include "frozenlayers.h"
+#include "dataset.h"
+#include "datasetstream.h"
+#include "nntest.h"
 
 // ======================
 // PRIVATE STATIC MEMBERS
@@ -15,24 +21,41 @@
 
 Trainer* NNTraining::tr;
 NeuralNetwork* NNTraining::nn;
+NeuralNetwork* NNTraining::model;
+FrozenLayers* NNTraining::fl;
 BackPropagation* NNTraining::bp;
+DatasetStream* NNTraining::ds;
 uint NNTraining::inputs, NNTraining::outputs, NNTraining::hlayers;
 std::vector<uint> NNTraining::units;
 real NNTraining::eta, NNTraining::alpha, NNTraining::lambda;
 std::string NNTraining::trfile, NNTraining::trsave, NNTraining::nnsave;
+std::string NNTraining::chkfile, NNTraining::resume;
+std::string NNTraining::init, NNTraining::initstate, NNTraining::freezecache;
+std::vector<real> NNTraining::initmomentum;
+uint NNTraining::freeze;
+uint NNTraining::stream, NNTraining::prefetch;
+bool NNTraining::epochbuffer;
+uint NNTraining::blockshuffle;
+uint NNTraining::chkepochs;
 uint NNTraining::folds, NNTraining::maxfolds;
 uint NNTraining::maxepochs, NNTraining::shuffle;
 real NNTraining::stoperr, NNTraining::stopacc, NNTraining::threshold;
 float NNTraining::stoperrch;
-uint NNTraining::stoperrchep;
+uint NNTraining::stoperrchep, NNTraining::patience;
+uint NNTraining::vaepochs, NNTraining::vasample;
+double NNTraining::maxtime;
+unsigned long long NNTraining::maxsamples;
+bool NNTraining::pipeline;
 timeval NNTraining::time_start, NNTraining::time_end;
 clock_t NNTraining::tcpu_start, NNTraining::tcpu_end;
+double NNTraining::time_before = 0.0, NNTraining::tcpu_before = 0.0;
 uint NNTraining::mepochs = 0;
 real NNTraining::mtrerr = 0.0, NNTraining::mvaerr = 0.0;
 real NNTraining::mtracc = 0.0, NNTraining::mvaacc = 0.0;
 real NNTraining::mtrerrmin = 0.0, NNTraining::mvaerrmin = 0.0;
 real NNTraining::mtraccmax = 0.0, NNTraining::mvaaccmax = 0.0;
 double NNTraining::mtime = 0.0, NNTraining::mtcpu = 0.0;
+unsigned long long NNTraining::msamples = 0;
 
 // =====================
 // PUBLIC STATIC METHODS
@@ -43,10 +66,16 @@ double NNTraining::mtime = 0.0, NNTraining::mtcpu = 0.0;
  *
  * Esegue i seguenti passi:
  *   - Controlla i parametri globali necessari.
- *   - Costruisce la rete neurale secondo i parametri impostati.
+ *   - Costruisce la rete neurale secondo i parametri impostati (con i pesi
+ *     iniziali letti da file se richiesto); se alcuni strati sono congelati
+ *     il training viene fatto solo sugli strati superiori, sulle attivazioni
+ *     degli strati congelati (vedere la classe FrozenLayers).
  *   - Costruisce l'algoritmo di back-propagation con i parametri impostati.
  *   - Stampa in output tutte le caratteristiche della rete neurale e dell'
  *     algoritmo.
+ *   - Carica il dataset e ne stampa le caratteristiche (compresa la velocita`
+ *     di caricamento); se richiesto il dataset viene invece letto a blocchi
+ *     durante il training (vedere la classe DatasetStream).
  *   - Attraverso la classe Trainer avvia il training sulla rete neurale con
  *     l'algoritmo di back-propagation.
  *   - Per ogni folds impostato stampa in output i risultati ottenuti e, se
@@ -54,6 +83,9 @@ double NNTraining::mtime = 0.0, NNTraining::mtcpu = 0.0;
  *     ottenuti dopo il training per ogni folds.
  *   - Al termine del training stampa la media dei risultati nei folds su
  *     cui si e` fatto training.
+ * Se richiesto il training riprende dallo stato salvato in un checkpoint, e lo
+ * stato viene salvato periodicamente; alla ricezione di un segnale di
+ * terminazione il training viene interrotto dopo aver salvato lo stato.
  * Restituisce 0 se l'esecuzione e` avvenuta correttamente, un numero diverso
  * da 0 se ci sono stati errori (per esempio mancano dei parametri).
  */
@@ -61,6 +93,17 @@ int NNTraining::exec() {
   // Legge e controlla i parametri
   if (!checkParameters()) return -1;
 
+  // Legge lo stato da cui riprendere il training, ripristinando il seme
+  // casuale utilizzato (la rete e le partizioni vengono ricostruite uguali)
+  Checkpoint checkpoint;
+  if (!resume.empty()) {
+    checkpoint.load(resume);
+    Global::setRandSeed(checkpoint.rseed);
+    loadTrainingResults(checkpoint);
+    std::cout <<"resume from: " <<resume <<" (fold " <<checkpoint.fold+1;
+    std::cout <<", epoch " <<checkpoint.epoch <<")" <<std::endl;
+  }
+
   // Stampa il seme casuale impostato
   std::cout <<"random seed used: " <<Global::getRandSeed() <<std::endl;
 
@@ -68,6 +111,22 @@ int NNTraining::exec() {
   // numero di unita` per ogni strato)
   units.push_back(outputs);
   nn = new NeuralNetwork(inputs, hlayers+1, units);
+  model = nn;
+  fl = NULL;
+  tr = NULL;
+  bp = NULL;
+  ds = NULL;
+  if (!init.empty() && !loadInitialModel()) {
+    cleanUp();
+    return -1;
+  }
+
+  // Se richiesto congela i primi strati: il training viene fatto sulla rete
+  // con i soli strati superiori
+  if (freeze > 0) {
+    fl = new FrozenLayers(*nn, freeze);
+    model = fl->makeTopModel();
+  }
 
   // Costruisce l'algoritmo di back-propagation con i parametri passati
   bp = new BackPropagation();
@@ -85,26 +144,82 @@ int NNTraining::exec() {
   // Costruisce il trainer con i parametri passati, impostandogli la rete
   // neurale come model e l'algoritmo di back-propagation come algoritmo di
   // training
-  tr = new Trainer(nn, bp);
-  tr->setDataSet(trfile);
+  tr = new Trainer(model, bp);
+  if (!init.empty()) {
+    if (!initstate.empty() && !loadInitialState()) {
+      cleanUp();
+      return -1;
+    }
+    tr->setInitialModel(*model);
+    tr->setInitialMomentum(initmomentum);
+  }
+  bool cached = false;
+  if (stream > 0) {
+    ds = new DatasetStream(trfile, inputs, outputs, stream * 1000000ULL);
+    tr->setDataStream(ds);
+  }
+  else if (fl == NULL) tr->setDataSet(trfile);
+  else {
+    // sostituisce gli inputs con le attivazioni degli strati congelati
+    Dataset dataset;
+    dataset.load(trfile, inputs, outputs);
+    cached = fl->computeActivations(dataset, freezecache);
+    tr->setDataSet(dataset);
+  }
+
+  // Stampa le caratteristiche del dataset caricato
+  printDatasetInfo();
+  if (fl != NULL) {
+    std::cout <<"frozen activations: ";
+    if (cached) std::cout <<"loaded from " <<freezecache;
+    else std::cout <<"computed on " <<tr->getDatasetDimension() <<" instances";
+    std::cout <<"\n";
+  }
+  std::cout <<std::endl;
   tr->setFolds(folds);
   tr->setMaxEpochs(maxepochs);
   tr->setShuffleEpochs(shuffle);
   tr->setStopError(stoperr);
   tr->setStopErrorChange(stoperrch, stoperrchep);
   tr->setStopAccuracy(stopacc);
+  tr->setStopValidation(patience);
   tr->setThreshold(threshold);
+  tr->setPipelinedValidation(pipeline);
+  tr->setPrefetch(prefetch);
+  tr->setEpochBuffer(epochbuffer);
+  tr->setBlockShuffle(blockshuffle);
+  tr->setValidationEpochs(vaepochs);
+  tr->setValidationSample(vasample);
+  if (!chkfile.empty()) {
+    tr->setCheckpoint(&checkpoint, chkfile, chkepochs);
+    Global::catchTermination();
+  }
 
   // Per il numero di partizioni (folds) impostate (attributo maxfolds) esegue
   // il training e (se richiesto) salva i risultati su file.
-  for (uint k = 0; k < maxfolds; ++k) {
+  for (uint k = checkpoint.fold; k < maxfolds; ++k) {
+    bool resumed = !resume.empty() && k == checkpoint.fold;
     tr->resetModel();
     tr->setValidationOn(k);
-    if (!trsave.empty()) tr->setSaveResults(trsave+"-"+Global::toString(k+1));
-    // avvia il training
-    startTimer();
+    tr->setRandStream(k);
+    if (resumed) tr->loadState(checkpoint);
+    checkpoint.fold = k;
+    saveTrainingResults(checkpoint);
+    if (!trsave.empty())
+      tr->setSaveResults(trsave+"-"+Global::toString(k+1), resumed);
+    setFoldBudget(k);
+    // avvia il training (contando il tempo speso prima del checkpoint)
+    if (resumed) startTimer(tr->getSessionTime(), tr->getSessionCpuTime());
+    else startTimer();
     tr->start();
     stopTimer();
+    // termina se e` stata richiesta la terminazione (lo stato e` salvato)
+    if (tr->isInterrupted()) {
+      std::cout <<"training interrupted, state saved on: " <<chkfile;
+      std::cout <<std::endl;
+      cleanUp();
+      return 1;
+    }
     // aggiorna i risultati
     updateTrainingResults();
     // stampa i risultati ottenuti
@@ -118,16 +233,19 @@ int NNTraining::exec() {
     printTrainingInfo();
     std::cout <<std::endl;
     // salva su file i risultati
-    if (!nnsave.empty()) nn->saveOnFile(nnsave+"-"+Global::toString(k+1));
+    if (!nnsave.empty() && fl != NULL) {
+      fl->setTopModel(tr->getBestModel(), *nn);
+      nn->saveOnFile(nnsave+"-"+Global::toString(k+1));
+    }
+    else if (!nnsave.empty())
+      tr->getBestModel().saveOnFile(nnsave+"-"+Global::toString(k+1));
   } // end for k
 
   // Stampa i risultati medi finali (se e` stato fatto training su piu` folds)
   if (maxfolds > 1) printFinalResults();
 
   // Elimina le strutture create e termina
-  delete nn;
-  delete bp;
-  delete tr;
+  cleanUp();
   return 0;
 } // End method exec
 
@@ -250,6 +368,40 @@ bool NNTraining::checkParameters ( ) {
   else if (Global::getParam("stoperrchep") == "stoperrchep")
     missingarg.push_back("--stoperrchep");
   else stoperrchep = Global::toUint(Global::getParam("stoperrchep"));
+  // --patience
+  if (Global::getParam("patience").empty())
+    patience = 0; // valore di default
+  else if (Global::getParam("patience") == "patience")
+    missingarg.push_back("--patience");
+  else patience = Global::toUint(Global::getParam("patience"));
+  // --maxtime
+  if (Global::getParam("maxtime").empty())
+    maxtime = 0.0; // valore di default
+  else if (Global::getParam("maxtime") == "maxtime")
+    missingarg.push_back("--maxtime");
+  else maxtime = Global::toReal(Global::getParam("maxtime"));
+  // --maxsamples
+  if (Global::getParam("maxsamples").empty())
+    maxsamples = 0; // valore di default
+  else if (Global::getParam("maxsamples") == "maxsamples")
+    missingarg.push_back("--maxsamples");
+  else maxsamples = Global::toReal(Global::getParam("maxsamples"));
+  // --vaepochs
+  if (Global::getParam("vaepochs").empty())
+    vaepochs = 1; // valore di default
+  else if (Global::getParam("vaepochs") == "vaepochs")
+    missingarg.push_back("--vaepochs");
+  else vaepochs = Global::toUint(Global::getParam("vaepochs"));
+  // --vasample
+  if (Global::getParam("vasample").empty())
+    vasample = 0; // valore di default
+  else if (Global::getParam("vasample") == "vasample")
+    missingarg.push_back("--vasample");
+  else vasample = Global::toUint(Global::getParam("vasample"));
+  // --pipeline
+  if (Global::getParam("pipeline").empty())
+    pipeline = false; // valore di default
+  else pipeline = true;
   // --threshold
   if (Global::getParam("threshold").empty())
     threshold = 0.5; // valore di default
@@ -262,6 +414,70 @@ bool NNTraining::checkParameters ( ) {
   else if (Global::getParam("nnsave") == "nnsave")
     missingarg.push_back("--nnsave");
   else nnsave = Global::getParam("nnsave");
+  // --resume
+  if (Global::getParam("resume").empty())
+    resume = ""; // valore di default
+  else if (Global::getParam("resume") == "resume")
+    missingarg.push_back("--resume");
+  else resume = Global::getParam("resume");
+  // --init
+  if (Global::getParam("init").empty())
+    init = ""; // valore di default
+  else if (Global::getParam("init") == "init")
+    missingarg.push_back("--init");
+  else init = Global::getParam("init");
+  // --initstate
+  if (Global::getParam("initstate").empty())
+    initstate = ""; // valore di default
+  else if (Global::getParam("initstate") == "initstate")
+    missingarg.push_back("--initstate");
+  else initstate = Global::getParam("initstate");
+  // --freeze
+  if (Global::getParam("freeze").empty())
+    freeze = 0; // valore di default
+  else if (Global::getParam("freeze") == "freeze")
+    missingarg.push_back("--freeze");
+  else freeze = Global::toUint(Global::getParam("freeze"));
+  // --freezecache
+  if (Global::getParam("freezecache").empty())
+    freezecache = ""; // valore di default
+  else if (Global::getParam("freezecache") == "freezecache")
+    missingarg.push_back("--freezecache");
+  else freezecache = Global::getParam("freezecache");
+  // --stream
+  if (Global::getParam("stream").empty())
+    stream = 0; // valore di default
+  else if (Global::getParam("stream") == "stream")
+    missingarg.push_back("--stream");
+  else stream = Global::toUint(Global::getParam("stream"));
+  // --prefetch
+  if (Global::getParam("prefetch").empty())
+    prefetch = 0; // valore di default
+  else if (Global::getParam("prefetch") == "prefetch")
+    missingarg.push_back("--prefetch");
+  else prefetch = Global::toUint(Global::getParam("prefetch"));
+  // --epochbuffer
+  if (Global::getParam("epochbuffer").empty())
+    epochbuffer = false; // valore di default
+  else epochbuffer = true;
+  // --blockshuffle
+  if (Global::getParam("blockshuffle").empty())
+    blockshuffle = 0; // valore di default
+  else if (Global::getParam("blockshuffle") == "blockshuffle")
+    missingarg.push_back("--blockshuffle");
+  else blockshuffle = Global::toUint(Global::getParam("blockshuffle"));
+  // --checkpoint
+  if (Global::getParam("checkpoint").empty())
+    chkfile = resume; // valore di default
+  else if (Global::getParam("checkpoint") == "checkpoint")
+    missingarg.push_back("--checkpoint");
+  else chkfile = Global::getParam("checkpoint");
+  // --chkepochs
+  if (Global::getParam("chkepochs").empty())
+    chkepochs = 10; // valore di default
+  else if (Global::getParam("chkepochs") == "chkepochs")
+    missingarg.push_back("--chkepochs");
+  else chkepochs = Global::toUint(Global::getParam("chkepochs"));
   // controlla se ci sono errori
   if (!required.empty()) {
     std::cout <<"The follow parameters are required (in training mode)";
@@ -318,9 +534,120 @@ bool NNTraining::checkParameters ( ) {
     std::cout <<"Parameter --threshold must a number in [0,1]" <<std::endl;
     return false;
   }
+  // --initstate
+  if (!initstate.empty() && init.empty()) {
+    std::cout <<"Parameter --initstate requires --init" <<std::endl;
+    return false;
+  }
+  // --resume e --initstate devono indicare un checkpoint
+  if (!resume.empty() && !Checkpoint::isCheckpoint(resume)) {
+    std::cout <<"Parameter --resume: " <<resume <<" is not a checkpoint";
+    std::cout <<std::endl;
+    return false;
+  }
+  if (!initstate.empty() && !Checkpoint::isCheckpoint(initstate)) {
+    std::cout <<"Parameter --initstate: " <<initstate <<" is not a checkpoint";
+    std::cout <<std::endl;
+    return false;
+  }
+  // --freeze
+  if (freeze > 0 && freeze >= hlayers) {
+    std::cout <<"Parameter --freeze must be less than the number of hidden ";
+    std::cout <<"layers" <<std::endl;
+    return false;
+  }
+  // --stream
+  if (stream > 0 && (freeze > 0 || vasample > 0 || pipeline ||
+      !chkfile.empty())) {
+    std::cout <<"Parameter --stream can not be used with --freeze, ";
+    std::cout <<"--vasample, --pipeline, --checkpoint and --resume";
+    std::cout <<std::endl;
+    return false;
+  }
+  // --epochbuffer e --blockshuffle
+  if (stream > 0 && (epochbuffer || blockshuffle > 0)) {
+    std::cout <<"Parameters --epochbuffer and --blockshuffle can not be used ";
+    std::cout <<"with --stream" <<std::endl;
+    return false;
+  }
+  // --epochbuffer e --prefetch
+  if (epochbuffer && prefetch > 0) {
+    std::cout <<"Parameter --epochbuffer can not be used with --prefetch";
+    std::cout <<std::endl;
+    return false;
+  }
   return true;
 } // End method checkParameters
 
+/**
+ * Method loadInitialModel
+ *
+ * Legge la rete neurale dal file indicato con --init e, se ha la stessa
+ * topologia della rete costruita (inputs, strati e unita` per strato), ne
+ * copia i pesi nella rete costruita. Restituisce false (stampando il motivo)
+ * se la rete non e` compatibile.
+ */
+bool NNTraining::loadInitialModel() {
+  NeuralNetwork initnn;
+  initnn.loadFromFile(init);
+  // controlla la topologia
+  bool same = initnn.getNumberOfInputs() == nn->getNumberOfInputs() &&
+      initnn.getNumberOfLayers() == nn->getNumberOfLayers();
+  for (uint i = 0; same && i < nn->getNumberOfLayers(); ++i)
+    same = initnn.getNumberOfUnits(i) == nn->getNumberOfUnits(i);
+  if (!same) {
+    std::cout <<"The neural network in " <<init <<" has not the topology ";
+    std::cout <<"set with --inputs, --outputs, --hlayers and --units";
+    std::cout <<std::endl;
+    return false;
+  }
+  nn->copyWeights(initnn);
+  return true;
+} // End method loadInitialModel
+
+/**
+ * Method loadInitialState
+ *
+ * Legge dal checkpoint indicato con --initstate il momentum iniziale dell'
+ * algoritmo, controllando che sia compatibile con la rete da addestrare. Se
+ * alcuni strati sono congelati e il checkpoint e` stato salvato addestrando
+ * l'intera rete, viene mantenuto solamente il momentum degli strati superiori.
+ * Restituisce false (stampando il motivo) se il checkpoint non e` compatibile.
+ */
+bool NNTraining::loadInitialState() {
+  Checkpoint state;
+  state.load(initstate);
+  initmomentum = state.momentum;
+  if (model != nn && initmomentum.size() == nn->getNumberOfUnits())
+    initmomentum.erase(initmomentum.begin(), initmomentum.begin() +
+        (nn->getNumberOfUnits() - model->getNumberOfUnits()));
+  try {
+    bp->setModel(model);
+    bp->setMomentum(initmomentum);
+  }
+  catch (std::out_of_range&) {
+    std::cout <<"The state in " <<initstate <<" is not compatible with the ";
+    std::cout <<"neural network" <<std::endl;
+    return false;
+  }
+  return true;
+} // End method loadInitialState
+
+/**
+ * Method cleanUp
+ *
+ * Elimina le strutture create dal metodo exec.
+ */
+void NNTraining::cleanUp() {
+  if (model != nn) delete model;
+  delete fl;
+  delete nn;
+  delete bp;
+  delete tr;
+  delete ds;
+  return;
+} // End method cleanUp
+
 /**
  * Method printNeuralNetworkInfo
  *
@@ -335,6 +662,8 @@ void NNTraining::printNeuralNetworkInfo() {
   for (uint i = 0; i < nn->getNumberOfLayers(); ++i)
     std::cout <<" " <<nn->getNumberOfUnits(i);
   std::cout <<" (total " <<nn->getNumberOfUnits()  <<")\n";
+  if (!init.empty()) std::cout <<"initial weights: " <<init <<"\n";
+  if (freeze > 0) std::cout <<"frozen layers: " <<freeze <<"\n";
   return;
 } // End of method printNeuralNetworkInfo
 
@@ -349,9 +678,29 @@ void NNTraining::printBackPropagationInfo() {
   std::cout <<"learning rate: " <<bp->getLearningRate() <<"\n";
   std::cout <<"momentum rate: " <<bp->getMomentumRate() <<"\n";
   std::cout <<"regularization rate: " <<bp->getRegularizationRate() <<"\n";
+  if (!initstate.empty()) std::cout <<"initial momentum: " <<initstate <<"\n";
   return;
 } // End of method printBackPropagationInfo
 
+/**
+ * Method printDatasetInfo
+ *
+ * Stampa su standard output le informazioni relative al dataset caricato, tra
+ * cui la velocita` di caricamento (vedere NNTest::printDatasetInfo). Se il
+ * dataset viene letto a blocchi stampa il numero e la dimensione dei blocchi.
+ */
+void NNTraining::printDatasetInfo() {
+  if (ds != NULL) {
+    std::cout <<"# dataset" <<std::endl;
+    std::cout <<"file: " <<trfile <<"\n";
+    std::cout <<"streaming: " <<ds->getNumberOfBlocks() <<" blocks of ";
+    std::cout <<ds->getBlockBytes() / 1e6 <<" MB\n";
+    return;
+  }
+  NNTest::printDatasetInfo(trfile, tr->getDataSet());
+  return;
+} // End of method printDatasetInfo
+
 /**
  * Method updateTrainingResults
  *
@@ -360,6 +709,7 @@ void NNTraining::printBackPropagationInfo() {
 void NNTraining::updateTrainingResults() {
   mtime += getElapsedTime();
   mtcpu += getCpuUsage();
+  msamples += tr->getSamples();
   mepochs += tr->getEpochs();
   mtrerr += tr->getTrainingError();
   mvaerr += tr->getValidationError();
@@ -372,6 +722,55 @@ void NNTraining::updateTrainingResults() {
   return;
 } // End of method updateTrainingResults
 
+/**
+ * Method saveTrainingResults
+ *
+ * Scrive nel checkpoint passato i risultati accumulati sui folds completati.
+ */
+void NNTraining::saveTrainingResults(Checkpoint& checkpoint) {
+  const real totals[] = { real(mepochs), mtrerr, mvaerr, mtracc, mvaacc,
+      mtrerrmin, mvaerrmin, mtraccmax, mvaaccmax, mtime, mtcpu,
+      real(msamples) };
+  checkpoint.totals.assign(totals, totals + sizeof(totals)/sizeof(totals[0]));
+  return;
+} // End of method saveTrainingResults
+
+/**
+ * Method loadTrainingResults
+ *
+ * Ripristina i risultati accumulati sui folds completati dal checkpoint
+ * passato (vedere saveTrainingResults).
+ */
+void NNTraining::loadTrainingResults(const Checkpoint& checkpoint) {
+  const std::vector<real>& t = checkpoint.totals;
+  if (t.size() != 12) throw read_error("In NNTraining::loadTrainingResults");
+  mepochs = uint(t[0]);
+  mtrerr = t[1]; mvaerr = t[2]; mtracc = t[3]; mvaacc = t[4];
+  mtrerrmin = t[5]; mvaerrmin = t[6]; mtraccmax = t[7]; mvaaccmax = t[8];
+  mtime = t[9]; mtcpu = t[10];
+  msamples = (unsigned long long) t[11];
+  return;
+} // End of method loadTrainingResults
+
+/**
+ * Method setFoldBudget
+ *
+ * Imposta nel trainer il budget di tempo e di istanze per il fold k: il budget
+ * non ancora utilizzato dai folds completati viene diviso in parti uguali tra
+ * i folds rimanenti (compreso k). Se il budget e` gia` esaurito viene comunque
+ * assegnato un budget minimo, percui ogni fold esegue almeno una istanza e il
+ * suo modello viene salvato.
+ */
+void NNTraining::setFoldBudget(uint k) {
+  if (maxtime > 0)
+    tr->setMaxTime( std::max(maxtime - mtime, 1e-6) / (maxfolds - k) );
+  if (maxsamples != 0) {
+    unsigned long long left = (msamples < maxsamples) ? maxsamples-msamples : 0;
+    tr->setMaxSamples( std::max(left / (maxfolds - k), 1ULL) );
+  }
+  return;
+} // End of method setFoldBudget
+
 /**
  * Method printTrainingInfo
  *
@@ -382,6 +781,11 @@ void NNTraining::printTrainingInfo() {
   std::cout <<"elapsed time: " <<getElapsedTime() <<" seconds \n";
   std::cout <<"cpu usage: " <<getCpuUsage() <<" seconds \n";
   std::cout <<"epochs: " <<tr->getEpochs() <<"\n";
+  if (maxtime > 0 || maxsamples != 0) {
+    std::cout <<"samples: " <<tr->getSamples();
+    if (tr->isExhausted()) std::cout <<" (budget exhausted)";
+    std::cout <<"\n";
+  }
   std::cout <<"training error: " <<tr->getTrainingError() <<"\n";
   std::cout <<"validation error: " <<tr->getValidationError() <<"\n";
   std::cout <<"training accuracy: " <<tr->getTrainingAccuracy() <<"\n";
@@ -425,11 +829,15 @@ void NNTraining::printFinalResults() {
  * clock della cpu al momento dell'invocazione del metodo.
  * Attraverso i metodi getElapsedTime e getCpuUsage si ottengono rispettivamente
  * il tempo (in secondi) e il tempo di utilizzo della cpu (in secondi) trascorsi
- * dall'invocazione di questo metodo all'invocazione del metodo stopTimer.
+ * dall'invocazione di questo metodo all'invocazione del metodo stopTimer, piu`
+ * il tempo e il tempo di cpu passati (ad esempio quelli spesi sul fold prima
+ * di un checkpoint da cui il training riprende).
  */
-void NNTraining::startTimer() {
+void NNTraining::startTimer(double time, double cpu) {
   gettimeofday(&time_start, NULL);
   tcpu_start = clock();
+  time_before = time;
+  tcpu_before = cpu;
   return;
 } // End method startTimer
 
@@ -452,20 +860,22 @@ void NNTraining::stopTimer() {
  * Method getElapsedTime
  *
  * Restituisce il numero di secondi trascorsi dall'invocazione del metodo
- * startTimer all'invocazione del metodo stopTimer.
+ * startTimer all'invocazione del metodo stopTimer (piu` il tempo passato a
+ * startTimer).
  */
 double NNTraining::getElapsedTime() {
   double s1 = time_start.tv_sec+(time_start.tv_usec/1000000.0);
   double s2 = time_end.tv_sec+(time_end.tv_usec/1000000.0);
-  return s2-s1;
+  return time_before + s2-s1;
 } // End method getElapsedTime
 
 /**
  * Method getCpuUsage
  *
  * Restituisce i secondi di utilizzo della cpu dall'invocazione del metodo
- * startTimer all'invocazione del metodo stopTimer.
+ * startTimer all'invocazione del metodo stopTimer (piu` il tempo di cpu
+ * passato a startTimer).
  */
 double NNTraining::getCpuUsage ( ) {
-  return (tcpu_end-tcpu_start) / double(CLOCKS_PER_SEC);
+  return tcpu_before + (tcpu_end-tcpu_start) / double(CLOCKS_PER_SEC);
 } // End method getCpuUsage
@@ -8,6 +8,9 @@
 #include "neuralnetwork.h"
 #include "backpropagation.h"
 #include "trainer.h"
+#include "checkpoint.h"
+#include "frozenlayers.h"
+#include "datasetstream.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
@@ -66,9 +69,85 @@ typedef Global::real real;
  *                --stoperrch non e` impostato questo parametro viene ignorato.
  *   --threshold  soglia per la classificazione; dev'essere un valore nell'
  *                intervallo [0,1] (default 0.5).
+ *   --patience   ferma il processo di training se l'errore di validation non
+ *                migliora per il numero di epoche consecutive indicato
+ *                (default 0, nessuno stop).
+ *   --maxtime    tempo massimo (in secondi) per il training su tutti i folds;
+ *                il tempo non utilizzato viene diviso in parti uguali tra i
+ *                folds rimanenti e controllato anche durante le epoche; quando
+ *                e` esaurito il training del fold si ferma, salvando il
+ *                modello migliore (default 0, nessun limite).
+ *   --maxsamples numero massimo di istanze (sommate su tutte le epoche e tutti
+ *                i folds) su cui applicare l'algoritmo di training, diviso tra
+ *                i folds come --maxtime (default 0, nessun limite).
+ *   --vaepochs   numero di epoche ogni cui eseguire la validation (default 1);
+ *                la validation viene comunque eseguita nell'ultima epoca e in
+ *                quella in cui si ferma il training.
+ *   --vasample   esegue la validation su un sottoinsieme casuale (stratificato
+ *                per classe) del validation set di circa il numero di istanze
+ *                indicato, salvando nel file dei risultati gli intervalli di
+ *                confidenza (default 0, l'intero validation set); nell'ultima
+ *                epoca, in quella di stop e quando la stima migliora i valori
+ *                migliori si usa l'intero validation set (da cui vengono
+ *                presi i valori e il modello migliori).
+ *   --pipeline   esegue la validation di ogni epoca in un thread separato, in
+ *                parallelo al training dell'epoca successiva; i criteri di
+ *                stop vengono controllati con un'epoca di ritardo.
+ *   --init       file con una rete neurale (salvata con --nnsave, anche
+ *                convertita in formato binario) da cui partire con il
+ *                training (di ogni fold) invece che da pesi casuali; la rete
+ *                deve avere la topologia indicata da --inputs, --outputs,
+ *                --hlayers e --units.
+ *   --initstate  file di checkpoint (vedere --checkpoint) da cui leggere lo
+ *                stato iniziale dell'algoritmo di back-propagation (momentum)
+ *                per proseguire il training della rete indicata con --init.
+ *   --freeze     numero di strati (a partire dal primo strato nascosto) i cui
+ *                pesi restano fissi durante il training (default 0), ad
+ *                esempio per addestrare solo gli strati superiori della rete
+ *                indicata con --init (deve restare almeno uno strato nascosto
+ *                non congelato); le attivazioni degli strati congelati
+ *                vengono calcolate una sola volta per l'intero dataset
+ *                (vedere la classe FrozenLayers).
+ *   --freezecache  file in cui salvare le attivazioni degli strati congelati;
+ *                se contiene gia` le attivazioni per gli stessi pesi e lo
+ *                stesso dataset vengono lette dal file senza ricalcolarle.
+ *   --stream     legge il dataset a blocchi della dimensione indicata (in
+ *                megabytes) invece di caricarlo interamente in memoria, per
+ *                dataset piu` grandi della memoria disponibile (vedere la
+ *                classe DatasetStream); i folds sono determinati dagli ids
+ *                delle istanze. Non puo` essere utilizzato con --freeze,
+ *                --vasample, --pipeline, --checkpoint e --resume.
+ *   --prefetch   prepara le istanze del training set in un thread separato, a
+ *                batch del numero di istanze indicato (anche con --stream,
+ *                dividendo ogni blocco) copiati in un buffer contiguo durante
+ *                il training del batch precedente (vedere la classe
+ *                Prefetcher); i
+ *                risultati non cambiano (default 0, nessun prefetch).
+ *   --epochbuffer  copia il training set, nell'ordine di ogni epoca, in
+ *                matrici contigue lette in sequenza (la copia e` fatta in
+ *                parallelo e ripetuta solo quando l'ordine cambia); i
+ *                risultati non cambiano. Non puo` essere utilizzato con
+ *                --prefetch.
+ *   --blockshuffle riordina il training set (vedere --shuffle) a blocchi del
+ *                numero di istanze indicato, consecutive in memoria, in ordine
+ *                casuale e riordinate all'interno di ogni blocco, invece che
+ *                con una permutazione completa (default 0, permutazione
+ *                completa). --epochbuffer e --blockshuffle non possono essere
+ *                utilizzati con --stream.
  *   --nnsave     salva la rete neurale, dopo il training, nel file specificato;
  *                viene salvata una rete neurale per ogni processo di training
- *                eseguito (vedere --folds e --maxfolds).
+ *                eseguito (vedere --folds e --maxfolds), con i pesi dell'epoca
+ *                con il minimo errore di validation (se c'e` validazione).
+ *   --checkpoint salva periodicamente lo stato del training (vedere la classe
+ *                Checkpoint) nel file specificato; lo stato viene salvato
+ *                anche alla ricezione di un segnale SIGTERM (o SIGINT), dopo
+ *                il quale il training si interrompe.
+ *   --chkepochs  numero di epoche ogni cui salvare lo stato (default 10; se 0
+ *                lo stato viene salvato solo alla terminazione).
+ *   --resume     riprende il training dallo stato salvato nel file indicato
+ *                (con --checkpoint); gli altri parametri devono essere uguali
+ *                a quelli del training interrotto. Se --checkpoint non e`
+ *                impostato lo stato viene salvato nello stesso file.
  * Dati una serie di parametri globali, con il metodo exec e` possibile avviare
  * il processo di training.
  */
@@ -80,7 +159,10 @@ class NNTraining
   private:
     static Trainer* tr;
     static NeuralNetwork* nn;
+    static NeuralNetwork* model;
+    static FrozenLayers* fl;
     static BackPropagation* bp;
+    static DatasetStream* ds;
     // parametri della rete neurale
     static uint inputs, outputs, hlayers;
     static std::vector<uint> units;
@@ -88,27 +170,48 @@ class NNTraining
     static real eta, alpha, lambda;
     // parametri per il training
     static std::string trfile, trsave, nnsave;
+    static std::string chkfile, resume;
+    static std::string init, initstate, freezecache;
+    static std::vector<real> initmomentum;
+    static uint freeze;
+    static uint stream, prefetch;
+    static bool epochbuffer;
+    static uint blockshuffle;
+    static uint chkepochs;
     static uint folds, maxfolds;
     static uint maxepochs, shuffle;
     static real stoperr, stopacc, threshold;
     static float stoperrch;
-    static uint stoperrchep;
+    static uint stoperrchep, patience;
+    static uint vaepochs, vasample;
+    static double maxtime;
+    static unsigned long long maxsamples;
+    static bool pipeline;
     // tempi di calcolo
     static timeval time_start, time_end;
     static clock_t tcpu_start, tcpu_end;
+    static double time_before, tcpu_before; // prima del checkpoint
     // risultati medi finali
     static uint mepochs;
     static real mtrerr, mvaerr, mtracc, mvaacc;
     static real mtrerrmin, mvaerrmin, mtraccmax, mvaaccmax;
     static double mtime, mtcpu;
+    static unsigned long long msamples;
 
     static bool checkParameters ( );
+    static bool loadInitialModel ( );
+    static bool loadInitialState ( );
+    static void cleanUp ( );
     static void printNeuralNetworkInfo ( );
     static void printBackPropagationInfo ( );
+    static void printDatasetInfo ( );
     static void updateTrainingResults ( );
+    static void setFoldBudget ( uint k );
+    static void saveTrainingResults ( Checkpoint& checkpoint );
+    static void loadTrainingResults ( const Checkpoint& checkpoint );
     static void printTrainingInfo ( );
     static void printFinalResults ( );
-    static void startTimer ( );
+    static void startTimer ( double time = 0.0, double cpu = 0.0 );
     static void stopTimer ( );
     static double getElapsedTime ( );
     static double getCpuUsage ( );
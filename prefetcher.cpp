@@ -0,0 +1,263 @@
+#include "prefetcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "global.h"
+#include "dataset.h"
+#include "datasetstream.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Constructor Prefetcher
+ *
+ * Costruisce un oggetto Prefetcher che legge il dataset in memoria a batch di
+ * batchsize istanze (maggiore di 0).
+ */
+Prefetcher::Prefetcher(uint batchsize) :
+    batchsize(batchsize),
+    consumer(0),
+    consuming(false), done(true), cancelled(false)
+{
+  if (batchsize == 0)
+    throw std::invalid_argument("In Prefetcher::Prefetcher");
+  for (uint b = 0; b < 2; ++b) {
+    buffers[b].inputs = NULL;
+    buffers[b].outputs = NULL;
+    buffers[b].incapacity = buffers[b].outcapacity = 0;
+    buffers[b].size = buffers[b].ninputs = buffers[b].noutputs = 0;
+    buffers[b].full = false;
+  }
+} // End constructor
+
+/**
+ * Destructor ~Prefetcher
+ */
+Prefetcher::~Prefetcher() {
+  stop();
+  for (uint b = 0; b < 2; ++b) {
+    std::free(buffers[b].inputs);
+    std::free(buffers[b].outputs);
+  }
+}
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method start
+ *
+ * Avvia (interrompendo la lettura precedente) la lettura del training set del
+ * dataset passato, nell'ordine corrente, a batch della dimensione impostata.
+ * Il dataset non deve essere modificato fino al termine della lettura (l'
+ * ultimo batch letto con next o l'invocazione di stop).
+ */
+void Prefetcher::start(Dataset& dataset) {
+  launch(&dataset, NULL);
+  return;
+} // End method start
+
+/**
+ * Method start
+ *
+ * Avvia (interrompendo la lettura precedente) la lettura del training set dall'
+ * oggetto DatasetStream passato, dalla sua posizione corrente (vedere il
+ * metodo DatasetStream::rewind), dividendo ogni blocco in batch della
+ * dimensione impostata.
+ */
+void Prefetcher::start(DatasetStream& stream) {
+  launch(NULL, &stream);
+  return;
+} // End method start
+
+/**
+ * Method next
+ *
+ * Restituisce in batch il batch successivo, aspettando che il thread di
+ * prefetch lo abbia preparato, e libera il buffer del batch precedente.
+ * Restituisce false al termine della lettura.
+ */
+bool Prefetcher::next(Batch& batch) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (consuming) {
+    buffers[consumer].full = false;
+    consumer ^= 1;
+    consuming = false;
+    cond.notify_all();
+  }
+  cond.wait(lock, [this] { return buffers[consumer].full || done; });
+  if (!buffers[consumer].full) {
+    if (error) {
+      std::exception_ptr e = error;
+      error = NULL;
+      std::rethrow_exception(e);
+    }
+    return false;
+  }
+  const Buffer& buffer = buffers[consumer];
+  batch.size = buffer.size;
+  batch.ninputs = buffer.ninputs;
+  batch.noutputs = buffer.noutputs;
+  batch.inputs = buffer.inputs;
+  batch.outputs = buffer.outputs;
+  consuming = true;
+  return true;
+} // End method next
+
+/**
+ * Method stop
+ *
+ * Interrompe la lettura corrente, aspettando la terminazione del thread di
+ * prefetch (che termina la copia del batch o la lettura del blocco in corso).
+ */
+void Prefetcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+  }
+  cond.notify_all();
+  if (thread.joinable()) thread.join();
+  return;
+} // End method stop
+
+/**
+ * Method getBatchSize
+ *
+ * Restituisce il numero (massimo) di istanze per batch.
+ */
+uint Prefetcher::getBatchSize() const {
+  return batchsize;
+} // End method getBatchSize
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method launch
+ *
+ * Interrompe la lettura corrente, svuota i buffer e avvia il thread di
+ * prefetch sul dataset o sull'oggetto DatasetStream passato (uno dei due).
+ */
+void Prefetcher::launch(Dataset* dataset, DatasetStream* stream) {
+  stop();
+  buffers[0].full = buffers[1].full = false;
+  consumer = 0;
+  consuming = false;
+  done = false;
+  cancelled = false;
+  error = NULL;
+  thread = std::thread(&Prefetcher::produce, this, dataset, stream);
+  return;
+} // End method launch
+
+/**
+ * Method produce
+ *
+ * Corpo del thread di prefetch: copia i batch del dataset (o dei blocchi dello
+ * stream) alternativamente nei due buffer, fino al termine della lettura o
+ * all'interruzione. Un'eccezione viene conservata per il metodo next.
+ */
+void Prefetcher::produce(Dataset* dataset, DatasetStream* stream) {
+  try {
+    uint b = 0;
+    if (stream != NULL) {
+      Dataset block;
+      bool filled = true;
+      while (filled && stream->next(block, false)) {
+        // divide il blocco in batch, come il dataset in memoria
+        const uint size = block.getSize();
+        for (uint first = 0; filled && first < size; first += batchsize) {
+          uint last = first + std::min(batchsize, size - first);
+          filled = fill(b, block, false, first, last);
+          b ^= 1;
+        }
+      }
+    }
+    else {
+      const uint size = dataset->getTrSetSize();
+      for (uint first = 0; first < size; first += batchsize) {
+        uint last = first + std::min(batchsize, size - first);
+        if (!fill(b, *dataset, true, first, last)) break;
+        b ^= 1;
+      }
+    }
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = std::current_exception();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cond.notify_all();
+  return;
+} // End method produce
+
+/**
+ * Method fill
+ *
+ * Aspetta che il buffer b sia libero e vi copia le istanze da first a last
+ * (esclusa) del training set del dataset source (se training e` true) o del
+ * dataset source. Restituisce false se la lettura e` stata interrotta.
+ */
+bool Prefetcher::fill(uint b, Dataset& source, bool training, uint first,
+    uint last) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this, b] { return !buffers[b].full || cancelled; });
+    if (cancelled) return false;
+  }
+  Buffer& buffer = buffers[b];
+  buffer.size = last - first;
+  buffer.ninputs = source.getNumberOfInputs();
+  buffer.noutputs = source.getNumberOfOutputs();
+  reserve(buffer.inputs, buffer.incapacity,
+      std::size_t(buffer.size) * buffer.ninputs);
+  reserve(buffer.outputs, buffer.outcapacity,
+      std::size_t(buffer.size) * buffer.noutputs);
+  real* in = buffer.inputs;
+  real* out = buffer.outputs;
+  for (uint i = first; i < last; ++i) {
+    const Dataset::Instance instance = training ? source.trAt(i) : source[i];
+    in = instance.input.copy(in);
+    out = std::copy(instance.output.begin(), instance.output.end(), out);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.full = true;
+  }
+  cond.notify_all();
+  return true;
+} // End method fill
+
+// ======================
+// PRIVATE STATIC METHODS
+// ======================
+
+/**
+ * Method reserve
+ *
+ * Rialloca (allineato a 64 bytes) il vettore values, di capacity valori, se
+ * ha meno di n valori.
+ */
+void Prefetcher::reserve(real*& values, std::size_t& capacity,
+    std::size_t n) {
+  if (n <= capacity) return;
+  std::size_t bytes = (n * sizeof(real) + 63) / 64 * 64;
+  real* data = static_cast<real*>(std::aligned_alloc(64, bytes));
+  if (data == NULL) throw std::bad_alloc();
+  std::free(values);
+  values = data;
+  capacity = n;
+  return;
+} // End method reserve
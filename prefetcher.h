@@ -0,0 +1,93 @@
+#ifndef PREFETCHER_H_
+#define PREFETCHER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "global.h"
+#include "dataset.h"
+#include "datasetstream.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class Prefetcher
+ *
+ * Prepara in un thread separato i batch di istanze del training set, mentre il
+ * thread che esegue il training utilizza il batch precedente (vedere il metodo
+ * Trainer::setPrefetch). Ogni batch viene copiato, nell'ordine corrente del
+ * training set, in un buffer contiguo (allineato a 64 bytes) con gli inputs e
+ * gli outputs delle istanze, istanza per istanza: l'accesso alle istanze
+ * mescolate (sparse in memoria) viene cosi` tolto dal ciclo di training.
+ * I buffer sono due (double buffering): il thread di prefetch riempie un
+ * buffer mentre l'altro viene utilizzato, e si ferma se entrambi sono pieni.
+ * Con il metodo start si avvia la lettura di un'epoca dal dataset in memoria
+ * o da un oggetto DatasetStream, sempre a batch della dimensione impostata:
+ * ogni blocco letto dallo stream viene diviso in batch, percui in memoria ci
+ * sono solo il blocco corrente e i due batch (e la lettura del blocco
+ * successivo avviene durante il training degli ultimi batch del blocco
+ * corrente); con il metodo next si ottiene il
+ * batch successivo (aspettando che sia pronto) e con il metodo stop si
+ * interrompe la lettura. Gli errori del thread di prefetch vengono rilanciati
+ * dal metodo next.
+ */
+class Prefetcher
+{
+  public:
+    Prefetcher ( uint batchsize );
+    virtual ~Prefetcher ( );
+
+    /**
+     * Vista su un batch di istanze, valida fino alla successiva invocazione
+     * del metodo next (o stop).
+     */
+    struct Batch {
+      uint size, ninputs, noutputs;
+      const real* inputs; // matrice size x ninputs
+      const real* outputs; // matrice size x noutputs
+      Dataset::Values input ( uint i ) const {
+        return Dataset::Values(inputs + std::size_t(i) * ninputs, ninputs);
+      }
+      Dataset::Values output ( uint i ) const {
+        return Dataset::Values(outputs + std::size_t(i) * noutputs, noutputs);
+      }
+    };
+
+    void start ( Dataset& dataset );
+    void start ( DatasetStream& stream );
+    bool next ( Batch& batch );
+    void stop ( );
+    uint getBatchSize ( ) const;
+
+  private:
+    /**
+     * Buffer (allineato) per un batch di istanze.
+     */
+    struct Buffer {
+      real* inputs;
+      real* outputs;
+      std::size_t incapacity, outcapacity; // numero di valori allocati
+      uint size, ninputs, noutputs;
+      bool full;
+    };
+    uint batchsize;
+    Buffer buffers[2];
+    uint consumer; // buffer restituito dall'ultima invocazione di next
+    bool consuming, done, cancelled;
+    std::exception_ptr error;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    void produce ( Dataset* dataset, DatasetStream* stream );
+    bool fill ( uint b, Dataset& source, bool training, uint first,
+        uint last );
+    void launch ( Dataset* dataset, DatasetStream* stream );
+    static void reserve ( real*& values, std::size_t& capacity,
+        std::size_t n );
+
+}; // End class Prefetcher
+
+#endif /* PREFETCHER_H_ */
@@ -0,0 +1,122 @@
+#include "random.h"
+
+/**
+ * Function rotl
+ *
+ * Ruota a sinistra di k bits il valore x.
+ */
+static inline unsigned long long rotl(unsigned long long x, int k) {
+  return (x << k) | (x >> (64 - k));
+} // End function rotl
+
+/**
+ * Function splitmix
+ *
+ * Avanza il generatore splitmix64 di stato x e restituisce il numero
+ * generato (utilizzato per inizializzare lo stato di xoshiro256**).
+ */
+static inline unsigned long long splitmix(unsigned long long& x) {
+  unsigned long long z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+} // End function splitmix
+
+/**
+ * Constructor Random
+ *
+ * Costruisce un generatore per la sottosequenza stream del seme seed.
+ */
+Random::Random(unsigned long long seed, unsigned long long stream) {
+  this->seed(seed, stream);
+} // End constructor
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method seed
+ *
+ * Reinizializza il generatore con il seme seed e la sottosequenza stream: lo
+ * stato e` generato con splitmix64 a partire dal seme, mescolato con l'indice
+ * della sottosequenza. Il conteggio dei numeri generati viene azzerato.
+ */
+void Random::seed(unsigned long long seed, unsigned long long stream) {
+  unsigned long long key = stream;
+  unsigned long long x = seed ^ splitmix(key);
+  for (int i = 0; i < 4; ++i) state[i] = splitmix(x);
+  count = 0;
+  return;
+} // End method seed
+
+/**
+ * Method next
+ *
+ * Restituisce il prossimo numero casuale a 64 bits.
+ */
+unsigned long long Random::next() {
+  const unsigned long long result = rotl(state[1] * 5, 7) * 9;
+  const unsigned long long t = state[1] << 17;
+  state[2] ^= state[0];
+  state[3] ^= state[1];
+  state[1] ^= state[2];
+  state[0] ^= state[3];
+  state[2] ^= t;
+  state[3] = rotl(state[3], 45);
+  ++count;
+  return result;
+} // End method next
+
+/**
+ * Method uniform
+ *
+ * Restituisce un numero casuale intero uniforme (senza distorsione) nell'
+ * intervallo [0, n), con n maggiore di 0, con il metodo di Lemire: la parte
+ * alta del prodotto a 128 bits tra un numero casuale e n, scartando i numeri
+ * che introdurrebbero una distorsione (raramente, per n piccolo).
+ */
+unsigned long long Random::uniform(unsigned long long n) {
+  unsigned __int128 m = (unsigned __int128) next() * n;
+  unsigned long long low = (unsigned long long) m;
+  if (low < n) {
+    const unsigned long long threshold = (0 - n) % n;
+    while (low < threshold) {
+      m = (unsigned __int128) next() * n;
+      low = (unsigned long long) m;
+    }
+  }
+  return (unsigned long long) (m >> 64);
+} // End method uniform
+
+/**
+ * Method getCount
+ *
+ * Restituisce il numero di numeri generati (con next) dall'inizializzazione.
+ */
+unsigned long long Random::getCount() const {
+  return count;
+} // End method getCount
+
+/**
+ * Method getState
+ *
+ * Copia le 4 parole dello stato del generatore nell'array words.
+ */
+void Random::getState(unsigned long long* words) const {
+  for (int i = 0; i < 4; ++i) words[i] = state[i];
+  return;
+} // End method getState
+
+/**
+ * Method setState
+ *
+ * Ripristina lo stato del generatore dalle 4 parole in words (lette con
+ * getState) e il conteggio dei numeri generati.
+ */
+void Random::setState(const unsigned long long* words,
+    unsigned long long count) {
+  for (int i = 0; i < 4; ++i) state[i] = words[i];
+  this->count = count;
+  return;
+} // End method setState
@@ -0,0 +1,39 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+/**
+ * Class Random
+ *
+ * Generatore di numeri casuali xoshiro256** (periodo 2^256 - 1), veloce e con
+ * la stessa sequenza su ogni piattaforma (a differenza di rand). Lo stato
+ * iniziale e` determinato da un seme e dall'indice di una sottosequenza
+ * (stream): generatori con lo stesso seme e stream diversi producono sequenze
+ * indipendenti, per cui ogni thread, fold o modello puo` avere il proprio
+ * generatore senza che i risultati dipendano dall'ordine (o dal numero di
+ * threads) con cui vengono utilizzati.
+ * Il generatore conta i numeri generati (vedere getCount). Lo stato (4 parole
+ * a 64 bits) puo` essere letto e ripristinato con i metodi getState e
+ * setState, ad esempio per salvarlo in un checkpoint, senza rigenerare i
+ * numeri gia` estratti.
+ * Un oggetto Random non e` thread-safe: ogni thread deve usare il proprio.
+ */
+class Random
+{
+  public:
+    Random ( unsigned long long seed = 0, unsigned long long stream = 0 );
+
+    void seed ( unsigned long long seed, unsigned long long stream = 0 );
+    unsigned long long next ( );
+    unsigned long long uniform ( unsigned long long n );
+    unsigned long long getCount ( ) const;
+    void getState ( unsigned long long* words ) const;
+    void setState ( const unsigned long long* words,
+        unsigned long long count );
+
+  private:
+    unsigned long long state[4];
+    unsigned long long count;
+
+}; // End class Random
+
+#endif /* RANDOM_H_ */
@@ -0,0 +1,287 @@
+#include "resultwriter.h"
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "global.h"
+#include "exception.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+const std::size_t ResultWriter::BUFFER_BYTES = 1 << 20;
+
+/**
+ * Constructor ResultWriter
+ *
+ * Costruisce un oggetto ResultWriter senza file aperto (vedere il metodo open)
+ * che scrive su disco dal thread che lo utilizza.
+ */
+ResultWriter::ResultWriter() :
+    file(NULL),
+    background(false), busy(false), stopping(false)
+{ } // End constructor
+
+/**
+ * Destructor ~ResultWriter
+ *
+ * Chiude il file (vedere il metodo close), ignorando eventuali errori.
+ */
+ResultWriter::~ResultWriter() {
+  try {
+    close();
+  }
+  catch (...) { }
+}
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method open
+ *
+ * Chiude il file corrente e apre il file passato, svuotandolo, oppure, se
+ * append e` true, aggiungendo le righe alla fine del file esistente.
+ */
+void ResultWriter::open(const std::string& filename, bool append) {
+  close();
+  file = std::fopen(filename.c_str(), append ? "ab" : "wb");
+  if (file == NULL) throw file_error("In ResultWriter::open");
+  this->filename = filename;
+  return;
+} // End method open
+
+/**
+ * Method setBackground
+ *
+ * Se enable e` true il buffer viene scritto su disco da un thread separato
+ * (avviato alla prima scrittura), altrimenti direttamente dal thread che
+ * termina la riga. Il thread corrente viene fermato alla chiusura del file.
+ */
+void ResultWriter::setBackground(bool enable) {
+  background = enable;
+  return;
+} // End method setBackground
+
+/**
+ * Method isOpen
+ *
+ * Restituisce true se c'e` un file aperto.
+ */
+bool ResultWriter::isOpen() const {
+  return file != NULL;
+} // End method isOpen
+
+/**
+ * Operator <<
+ *
+ * Aggiunge alla riga corrente il testo passato.
+ */
+ResultWriter& ResultWriter::operator<<(std::string_view text) {
+  buffer.append(text.data(), text.size());
+  return *this;
+} // End operator << (string)
+
+/**
+ * Operator <<
+ *
+ * Aggiunge alla riga corrente il testo (terminato da 0) passato.
+ */
+ResultWriter& ResultWriter::operator<<(const char* text) {
+  buffer.append(text, std::strlen(text));
+  return *this;
+} // End operator << (const char*)
+
+/**
+ * Operator <<
+ *
+ * Aggiunge alla riga corrente il carattere passato.
+ */
+ResultWriter& ResultWriter::operator<<(char c) {
+  buffer.push_back(c);
+  return *this;
+} // End operator << (char)
+
+/**
+ * Operator <<
+ *
+ * Aggiunge alla riga corrente l'intero passato (in base 10).
+ */
+ResultWriter& ResultWriter::operator<<(uint value) {
+  char text[16];
+  std::to_chars_result r = std::to_chars(text, text + sizeof(text), value);
+  buffer.append(text, r.ptr);
+  return *this;
+} // End operator << (uint)
+
+/**
+ * Operator <<
+ *
+ * Aggiunge alla riga corrente il numero reale passato, in formato scientifico
+ * con 5 decimali (come printf con %.5e).
+ */
+ResultWriter& ResultWriter::operator<<(real value) {
+  char text[32];
+  std::to_chars_result r = std::to_chars(text, text + sizeof(text), value,
+      std::chars_format::scientific, 5);
+  buffer.append(text, r.ptr);
+  return *this;
+} // End operator << (real)
+
+/**
+ * Method endLine
+ *
+ * Termina la riga corrente e, se il buffer ha superato BUFFER_BYTES bytes, lo
+ * scrive su disco (o lo passa al thread di scrittura).
+ */
+void ResultWriter::endLine() {
+  buffer.push_back('\n');
+  if (buffer.size() >= BUFFER_BYTES) handOver();
+  return;
+} // End method endLine
+
+/**
+ * Method flush
+ *
+ * Scrive su disco tutte le righe terminate, aspettando il thread di scrittura.
+ */
+void ResultWriter::flush() {
+  handOver();
+  wait();
+  if (file != NULL && std::fflush(file) != 0)
+    throw file_error("In ResultWriter::flush");
+  return;
+} // End method flush
+
+/**
+ * Method close
+ *
+ * Scrive su disco le righe rimaste, ferma il thread di scrittura e chiude il
+ * file. Se non c'e` un file aperto non fa nulla.
+ */
+void ResultWriter::close() {
+  if (file == NULL) return;
+  std::exception_ptr e;
+  try {
+    flush();
+  }
+  catch (...) {
+    e = std::current_exception();
+  }
+  if (thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cond.notify_all();
+    thread.join();
+  }
+  if (std::fclose(file) != 0 && !e)
+    e = std::make_exception_ptr(file_error("In ResultWriter::close"));
+  file = NULL;
+  buffer.clear();
+  pending.clear();
+  error = NULL;
+  if (e) std::rethrow_exception(e);
+  return;
+} // End method close
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method handOver
+ *
+ * Scrive su disco il buffer oppure, con il thread di scrittura, lo scambia con
+ * il buffer del thread (aspettando che abbia scritto il precedente).
+ */
+void ResultWriter::handOver() {
+  if (buffer.empty()) return;
+  if (!background) {
+    put(buffer);
+    buffer.clear();
+    return;
+  }
+  if (!thread.joinable()) {
+    stopping = false;
+    thread = std::thread(&ResultWriter::consume, this);
+  }
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.swap(pending);
+    busy = true;
+  }
+  cond.notify_all();
+  return;
+} // End method handOver
+
+/**
+ * Method wait
+ *
+ * Aspetta che il thread di scrittura abbia scritto il suo buffer e rilancia
+ * l'eventuale errore di scrittura.
+ */
+void ResultWriter::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [this] { return !busy; });
+  if (error) {
+    std::exception_ptr e = error;
+    error = NULL;
+    std::rethrow_exception(e);
+  }
+  return;
+} // End method wait
+
+/**
+ * Method consume
+ *
+ * Corpo del thread di scrittura: scrive su disco i buffer ricevuti (vedere il
+ * metodo handOver) fino alla chiusura del file. Un'eccezione viene conservata
+ * per il metodo wait.
+ */
+void ResultWriter::consume() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cond.wait(lock, [this] { return busy || stopping; });
+    if (!busy) break;
+    lock.unlock();
+    std::exception_ptr e;
+    try {
+      put(pending);
+    }
+    catch (...) {
+      e = std::current_exception();
+    }
+    pending.clear();
+    lock.lock();
+    if (e) error = e;
+    busy = false;
+    cond.notify_all();
+  }
+  return;
+} // End method consume
+
+/**
+ * Method put
+ *
+ * Scrive i dati passati nel file.
+ */
+void ResultWriter::put(const std::string& data) {
+  if (file == NULL) throw file_error("In ResultWriter::put");
+  if (std::fwrite(data.data(), 1, data.size(), file) != data.size())
+    throw file_error("In ResultWriter::put");
+  return;
+} // End method put
@@ -0,0 +1,70 @@
+#ifndef RESULTWRITER_H_
+#define RESULTWRITER_H_
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "global.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class ResultWriter
+ *
+ * File di testo (csv) con i risultati del training o del test (vedere i metodi
+ * Trainer::setSaveResults e Tester::setSaveModelResponses), aperto una sola
+ * volta e scritto attraverso un buffer proprio: le righe vengono composte con
+ * l'operatore << e terminate con il metodo endLine, e il buffer viene scritto
+ * su disco quando supera BUFFER_BYTES bytes, con il metodo flush e alla
+ * chiusura del file.
+ * I numeri reali vengono scritti con std::to_chars in formato scientifico con
+ * 5 decimali, con lo stesso risultato di uno stream con precision(5) e
+ * std::ios::scientific.
+ * Con il metodo setBackground la scrittura su disco viene eseguita da un
+ * thread separato, mentre il thread che produce i risultati riempie un secondo
+ * buffer (double buffering). Gli errori di scrittura (anche del thread) vengono
+ * rilanciati dai metodi endLine, flush e close.
+ */
+class ResultWriter
+{
+  public:
+    ResultWriter ( );
+    virtual ~ResultWriter ( );
+
+    void open ( const std::string& filename, bool append = false );
+    void setBackground ( bool enable );
+    bool isOpen ( ) const;
+    ResultWriter& operator<< ( std::string_view text );
+    ResultWriter& operator<< ( const char* text );
+    ResultWriter& operator<< ( char c );
+    ResultWriter& operator<< ( uint value );
+    ResultWriter& operator<< ( real value );
+    void endLine ( );
+    void flush ( );
+    void close ( );
+
+  private:
+    static const std::size_t BUFFER_BYTES;
+    std::string filename;
+    std::FILE* file;
+    std::string buffer; // righe non ancora scritte
+    std::string pending; // righe in scrittura dal thread
+    bool background, busy, stopping;
+    std::exception_ptr error;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    void handOver ( );
+    void wait ( );
+    void consume ( );
+    void put ( const std::string& data );
+
+}; // End class ResultWriter
+
+#endif /* RESULTWRITER_H_ */
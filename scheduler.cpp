@@ -0,0 +1,309 @@
+#include "scheduler.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <stdexcept>
+#include "global.h"
+#include "neuralnetwork.h"
+#include "backpropagation.h"
+#include "trainer.h"
+#include "dataset.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class ScoreLess
+ *
+ * Confronta due configurazioni in base al loro punteggio (vedere il metodo
+ * Scheduler::score), a parita` di punteggio prevale l'indice minore.
+ */
+class ScoreLess
+{
+  public:
+    ScoreLess ( const std::vector<real>& scores ) : scores(scores) { }
+    bool operator() ( uint a, uint b ) const {
+      if (scores[a] != scores[b]) return scores[a] < scores[b];
+      return a < b;
+    }
+  private:
+    const std::vector<real>& scores;
+}; // End class ScoreLess
+
+/**
+ * Constructor Scheduler
+ *
+ * Costruisce uno scheduler senza configurazioni, con i seguenti valori di
+ * default: 1 epoca al primo turno, massimo 81 epoche, fattore di riduzione 3.
+ */
+Scheduler::Scheduler() :
+    minepochs(1), maxepochs(81), reduction(3), shfepochs(0),
+    rounds(0), totepochs(0), best(0),
+    threshold(0.5)
+{ } // End constructor
+
+/**
+ * Destructor ~Scheduler
+ *
+ * Elimina tutte le configurazioni (modelli e algoritmi) aggiunte.
+ */
+Scheduler::~Scheduler() {
+  for (uint i = 0; i < trainers.size(); ++i) {
+    delete trainers[i];
+    delete models[i];
+    delete algorithms[i];
+  }
+} // End destructor
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Method setDataSet
+ *
+ * Carica il dataset (in formato csv) dal file passato, con il numero di inputs
+ * e di outputs indicato. Il dataset viene condiviso da tutte le configurazioni.
+ */
+void Scheduler::setDataSet(const std::string& file, uint ninputs,
+    uint noutputs) {
+  dataset.load(file, ninputs, noutputs);
+  return;
+} // End method setDataSet
+
+/**
+ * Method setFolds
+ *
+ * Riordina in modo casuale il dataset e lo divide in n partizioni, utilizzando
+ * la prima come validation set. Il numero di partizioni dev'essere almeno 2.
+ */
+void Scheduler::setFolds(uint n) {
+  if (n < 2) throw std::out_of_range("In Scheduler::setFolds");
+  dataset.randomShuffle();
+  dataset.setFolds(n);
+  dataset.setValidationFold(0);
+  return;
+} // End method setFolds
+
+/**
+ * Method setMinEpochs
+ *
+ * Imposta il numero di epoche del primo turno (per ogni configurazione).
+ */
+void Scheduler::setMinEpochs(uint value) {
+  this->minepochs = value;
+} // End method setMinEpochs
+
+/**
+ * Method setMaxEpochs
+ *
+ * Imposta il numero massimo di epoche per cui viene addestrata ogni
+ * configurazione (raggiunto solo dalle configurazioni promosse all'ultimo
+ * turno).
+ */
+void Scheduler::setMaxEpochs(uint value) {
+  this->maxepochs = value;
+} // End method setMaxEpochs
+
+/**
+ * Method setReduction
+ *
+ * Imposta il fattore di riduzione r: ad ogni turno viene promossa la frazione
+ * 1/r delle configurazioni e il numero di epoche viene moltiplicato per r.
+ * Il valore dev'essere almeno 2.
+ */
+void Scheduler::setReduction(uint value) {
+  if (value < 2) throw std::out_of_range("In Scheduler::setReduction");
+  this->reduction = value;
+} // End method setReduction
+
+/**
+ * Method setShuffleEpochs
+ *
+ * Imposta ogni quante epoche riordinare il training set (vedere il metodo
+ * Trainer::setShuffleEpochs).
+ */
+void Scheduler::setShuffleEpochs(uint v) {
+  this->shfepochs = v;
+} // End method setShuffleEpochs
+
+/**
+ * Method setThreshold
+ *
+ * Imposta la soglia per la classificazione (vedere Trainer::setThreshold).
+ */
+void Scheduler::setThreshold(real threshold) {
+  assert(threshold >= 0 && threshold <= 1);
+  this->threshold = threshold;
+} // End method setThreshold
+
+/**
+ * Method addConfiguration
+ *
+ * Aggiunge una configurazione da valutare, composta da un modello e dal suo
+ * algoritmo di training. Lo scheduler diventa proprietario degli oggetti
+ * passati (li elimina alla sua distruzione). Il dataset dev'essere gia` stato
+ * caricato e partizionato, e gli altri parametri (epoche, soglia, ecc.) gia`
+ * impostati.
+ */
+void Scheduler::addConfiguration(NeuralNetwork* model,
+    BackPropagation* algorithm) {
+  assert( model != NULL && algorithm != NULL );
+  Trainer* tr = new Trainer(model, algorithm);
+  tr->setDataSet(dataset);
+  tr->setRandStream(trainers.size());
+  tr->setMaxEpochs(maxepochs);
+  tr->setShuffleEpochs(shfepochs);
+  tr->setThreshold(threshold);
+  models.push_back(model);
+  algorithms.push_back(algorithm);
+  trainers.push_back(tr);
+  reached.push_back(0);
+  return;
+} // End method addConfiguration
+
+/**
+ * Method getNumberOfConfigurations
+ *
+ * Restituisce il numero di configurazioni aggiunte.
+ */
+uint Scheduler::getNumberOfConfigurations() const {
+  return trainers.size();
+} // End method getNumberOfConfigurations
+
+/**
+ * Method getRounds
+ *
+ * Restituisce il numero di turni eseguiti nell'ultima ricerca.
+ */
+uint Scheduler::getRounds() const {
+  return rounds;
+} // End method getRounds
+
+/**
+ * Method getTotalEpochs
+ *
+ * Restituisce il numero totale di epoche eseguite (sommate su tutte le
+ * configurazioni) nell'ultima ricerca.
+ */
+uint Scheduler::getTotalEpochs() const {
+  return totepochs;
+} // End method getTotalEpochs
+
+/**
+ * Method getBest
+ *
+ * Restituisce l'indice della configurazione migliore trovata dall'ultima
+ * ricerca.
+ */
+uint Scheduler::getBest() const {
+  return best;
+} // End method getBest
+
+/**
+ * Method getRoundReached
+ *
+ * Restituisce l'ultimo turno (a partire da 1) a cui e` arrivata l'i-esima
+ * configurazione.
+ */
+uint Scheduler::getRoundReached(uint i) const {
+  if (i >= reached.size())
+    throw std::out_of_range("In Scheduler::getRoundReached");
+  return reached[i];
+} // End method getRoundReached
+
+/**
+ * Method getTrainer
+ *
+ * Restituisce il trainer dell'i-esima configurazione, da cui leggere i
+ * risultati raggiunti.
+ */
+const Trainer& Scheduler::getTrainer(uint i) const {
+  if (i >= trainers.size()) throw std::out_of_range("In Scheduler::getTrainer");
+  return *trainers[i];
+} // End method getTrainer
+
+/**
+ * Method getModel
+ *
+ * Restituisce il modello dell'i-esima configurazione.
+ */
+const NeuralNetwork& Scheduler::getModel(uint i) const {
+  if (i >= models.size()) throw std::out_of_range("In Scheduler::getModel");
+  return *models[i];
+} // End method getModel
+
+/**
+ * Method start
+ *
+ * Esegue la ricerca successive halving sulle configurazioni aggiunte. Al
+ * termine il metodo getBest restituisce l'indice della configurazione
+ * migliore.
+ */
+void Scheduler::start() {
+  assert( !trainers.empty() && dataset.getVaSetSize() > 0 );
+  // tutte le configurazioni partecipano al primo turno
+  std::vector<uint> survivors(trainers.size());
+  for (uint i = 0; i < survivors.size(); ++i) survivors[i] = i;
+  rounds = 0;
+  totepochs = 0;
+  // ad ogni turno promuove la frazione 1/reduction delle configurazioni
+  uint epochs = std::max(minepochs, uint(1));
+  while (survivors.size() > 1 && epochs < maxepochs) {
+    advance(survivors, epochs);
+    std::vector<real> scores(trainers.size());
+    for (uint i = 0; i < survivors.size(); ++i)
+      scores[survivors[i]] = score(survivors[i]);
+    std::sort(survivors.begin(), survivors.end(), ScoreLess(scores));
+    survivors.resize(std::max(uint(survivors.size()/reduction), uint(1)));
+    epochs *= reduction;
+  } // end while
+  // le configurazioni rimaste vengono addestrate fino al massimo di epoche
+  advance(survivors, maxepochs);
+  best = survivors[0];
+  for (uint i = 1; i < survivors.size(); ++i)
+    if (score(survivors[i]) < score(best)) best = survivors[i];
+  return;
+} // End method start
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method score
+ *
+ * Restituisce il punteggio dell'i-esima configurazione (piu` basso e`
+ * migliore): l'errore minimo di validation raggiunto. Le configurazioni
+ * divergenti hanno punteggio infinito.
+ */
+real Scheduler::score(uint i) const {
+  real err = trainers[i]->getMinValidationError().first;
+  if (std::isnan(err)) return std::numeric_limits<real>::infinity();
+  return err;
+} // End method score
+
+/**
+ * Method advance
+ *
+ * Esegue un turno: prosegue il training delle configurazioni in survivors
+ * fino a raggiungere (in totale) il numero di epoche passato. L'epoca in cui
+ * una configurazione si ferma (per un criterio di stop) non viene contata da
+ * Trainer::getEpochs ma e` stata eseguita, percui viene sommata al totale.
+ */
+void Scheduler::advance(const std::vector<uint>& survivors, uint epochs) {
+  ++rounds;
+  for (uint i = 0; i < survivors.size(); ++i) {
+    Trainer* tr = trainers[survivors[i]];
+    uint done = tr->getEpochs();
+    bool stopped = tr->isStopped();
+    if (epochs > done) tr->resume(epochs - done);
+    totepochs += tr->getEpochs() - done;
+    if (tr->isStopped() && !stopped) ++totepochs;
+    reached[survivors[i]] = rounds;
+  }
+  return;
+} // End method advance
@@ -0,0 +1,69 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <string>
+#include <vector>
+#include "global.h"
+#include "neuralnetwork.h"
+#include "backpropagation.h"
+#include "trainer.h"
+#include "dataset.h"
+
+typedef Global::uint uint;
+typedef Global::real real;
+
+/**
+ * Class Scheduler
+ *
+ * Esegue una ricerca tra piu` configurazioni (coppie modello e algoritmo di
+ * training, aggiunte con il metodo addConfiguration) con la strategia
+ * successive halving: tutte le configurazioni vengono addestrate per un numero
+ * ridotto di epoche (impostato con setMinEpochs), poi solo la frazione 1/r
+ * migliore (r impostato con setReduction), in base all'errore minimo di
+ * validation, viene promossa al turno successivo in cui il numero di epoche
+ * viene moltiplicato per r. Le configurazioni promosse proseguono il training
+ * dal punto in cui erano arrivate (vedere Trainer::resume), senza ripartire da
+ * zero. La ricerca termina quando resta una sola configurazione, che viene
+ * addestrata fino al numero massimo di epoche (impostato con setMaxEpochs).
+ * Il dataset viene caricato una sola volta e tutte le configurazioni usano le
+ * stesse partizioni, con il fold 0 come validation set.
+ */
+class Scheduler
+{
+  public:
+    Scheduler ( );
+    virtual ~Scheduler ( );
+
+    void setDataSet ( const std::string& file, uint ninputs, uint noutputs );
+    void setFolds ( uint n );
+    void setMinEpochs ( uint value );
+    void setMaxEpochs ( uint value );
+    void setReduction ( uint value );
+    void setShuffleEpochs ( uint v );
+    void setThreshold ( real threshold );
+    void addConfiguration ( NeuralNetwork* model, BackPropagation* algorithm );
+    uint getNumberOfConfigurations ( ) const;
+    uint getRounds ( ) const;
+    uint getTotalEpochs ( ) const;
+    uint getBest ( ) const;
+    uint getRoundReached ( uint i ) const;
+    const Trainer& getTrainer ( uint i ) const;
+    const NeuralNetwork& getModel ( uint i ) const;
+    void start ( );
+
+  private:
+    Dataset dataset;
+    std::vector<NeuralNetwork*> models;
+    std::vector<BackPropagation*> algorithms;
+    std::vector<Trainer*> trainers;
+    std::vector<uint> reached;
+    uint minepochs, maxepochs, reduction, shfepochs;
+    uint rounds, totepochs, best;
+    real threshold;
+
+    real score ( uint i ) const;
+    void advance ( const std::vector<uint>& survivors, uint epochs );
+
+}; // End class Scheduler
+
+#endif /* SCHEDULER_H_ */
@@ -18,7 +18,7 @@
 typedef Global::uint uint;
 typedef Global::real real;
 
-void print(const std::vector<real>& v) {
+void print(const Dataset::Values& v) {
   for (uint i = 0; i < v.size(); ++i)
     std::cout <<v[i] <<" ";
   return;
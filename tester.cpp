@@ -1,14 +1,22 @@
 #include "tester.h"
 
 #include <iostream>
-#include <fstream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <thread>
 #include "global.h"
 #include "exception.h"
 #include "dataset.h"
 #include "neuralnetwork.h"
+#include "ensemble.h"
+
+// ======================
+// PRIVATE STATIC MEMBERS
+// ======================
+
+const uint Tester::MIN_PARTITION = 1024;
 
 /**
  * Constructor Trainer
@@ -19,12 +27,32 @@
  */
 Tester::Tester(NeuralNetwork* model, bool withoutput) :
     model(model),
+    ensemble(NULL),
     withoutput(withoutput),
     missed(0),
     hits(0),
     threshold(0.5),
     accuracy(0.0),
-    error(0.0)
+    error(0.0),
+    threads(1)
+{ } // End constructor
+
+/**
+ * Constructor Tester
+ *
+ * Costruisce un oggetto Tester per l'ensemble di reti neurali passato (vedere
+ * la classe Ensemble), la cui risposta e` la media delle risposte delle reti.
+ */
+Tester::Tester(Ensemble* ensemble, bool withoutput) :
+    model(NULL),
+    ensemble(ensemble),
+    withoutput(withoutput),
+    missed(0),
+    hits(0),
+    threshold(0.5),
+    accuracy(0.0),
+    error(0.0),
+    threads(1)
 { } // End constructor
 
 /**
@@ -46,9 +74,9 @@ Tester::~Tester() { }
  * per n inputs ed m outputs, con un'istanza per ogni riga.
  */
 void Tester::setDataSet(const std::string& filename) {
-  assert( model != NULL );
-  uint ninputs = model->getNumberOfInputs();
-  uint noutputs = model->getNumberOfOutputs();
+  assert( model != NULL || ensemble != NULL );
+  uint ninputs = getNumberOfInputs();
+  uint noutputs = getNumberOfOutputs();
   if (withoutput)
     dataset.load(filename, ninputs, noutputs);
   else
@@ -64,19 +92,23 @@ void Tester::setDataSet(const std::string& filename) {
  *   id, output(1), ..., output(n)
  * gli output vengono salvati in formato scentifico con 5 decimali di
  * precisione. Se la stringa passata e` vuota allora le risposte non vengono
- * salvate.
+ * salvate. Il file resta aperto fino alla distruzione del tester e le righe
+ * vengono scritte a blocchi (vedere la classe ResultWriter), al termine di
+ * ogni test; con background = true la scrittura su disco viene eseguita da
+ * un thread separato, in parallelo al test.
  */
-void Tester::setSaveModelResponses(const std::string& file) {
+void Tester::setSaveModelResponses(const std::string& file, bool background) {
+  results.close();
   resfile = file;
   // scrive l'intestazione nel file da salvare
   if (!resfile.empty()) {
-    std::ofstream ofs(resfile.c_str());
-    if (!ofs.is_open()) throw file_error("In Tester::setSaveModelResponse");
-    ofs <<"\"id\"";
-    for (uint i = 0; i < model->getNumberOfOutputs(); ++i)
-      ofs <<",\"out[" <<i <<"]\"";
-    ofs <<std::endl;
-    ofs.close();
+    results.setBackground(background);
+    results.open(resfile);
+    results <<"\"id\"";
+    for (uint i = 0; i < getNumberOfOutputs(); ++i)
+      results <<",\"out[" <<i <<"]\"";
+    results.endLine();
+    results.flush();
   }
   return;
 } // End method setSaveResults
@@ -98,6 +130,19 @@ void Tester::setThreshold(real threshold) {
   this->threshold = threshold;
 } // End method setThreshold
 
+/**
+ * Method setThreads
+ *
+ * Imposta il numero di threads con cui eseguire il test (default 1); con 0
+ * viene utilizzato un thread per ogni core. Ogni thread valuta una partizione
+ * contigua di almeno MIN_PARTITION istanze del dataset, per cui con dataset
+ * piccoli vengono utilizzati meno threads.
+ */
+void Tester::setThreads(uint n) {
+  threads = n;
+  return;
+} // End method setThreads
+
 /**
  * Method getDatasetDimension
  *
@@ -107,6 +152,15 @@ uint Tester::getDatasetDimension() const {
   return dataset.getSize();
 } // End method getDatasetDimension
 
+/**
+ * Method getDataSet
+ *
+ * Restituisce il dataset caricato.
+ */
+const Dataset& Tester::getDataSet() const {
+  return dataset;
+} // End method getDataSet
+
 /**
  * Method getNumberOfMissed
  *
@@ -163,31 +217,36 @@ real Tester::getQuadraticError() const {
  * vengono salvati su file le risposte del modello per ogni istanza del dataset.
  * Al termine dell'esecuzione di questo metodo e` possibile accedere ai vari
  * risultati del test attraverso gli altri metodi (accuratezza, errore, ecc.).
+ * Con piu` threads (vedere setThreads) il test viene eseguito dal metodo
+ * startParallel, con gli stessi risultati.
  */
 void Tester::start() {
-  assert( model != NULL && !dataset.isEmpty() );
-  assert( model->getNumberOfInputs() == dataset.getInputs(0).size() );
+  assert( (model != NULL || ensemble != NULL) && !dataset.isEmpty() );
+  assert( getNumberOfInputs() == dataset.getInputs(0).size() );
   if (withoutput)
-    assert( model->getNumberOfOutputs() == dataset.getOutputs(0).size() );
+    assert( getNumberOfOutputs() == dataset.getOutputs(0).size() );
   // azzera le variabili
   hits = 0;
   missed = 0;
   accuracy = 0.0;
   error = 0.0;
+  std::vector<real> row;
+  uint nthreads = threads;
+  if (nthreads == 0)
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  nthreads = std::min(nthreads, dataset.getSize() / MIN_PARTITION);
+  if (nthreads > 1) startParallel(nthreads);
+  else if (ensemble != NULL) startEnsemble();
   // per ogni elemento del dataset
-  for (uint elem = 0; elem < dataset.getSize(); ++elem) {
+  else for (uint elem = 0; elem < dataset.getSize(); ++elem) {
     // imposta l'input nel modello
-    model->setInputs(dataset[elem].input);
+    model->setInputs(dataset[elem].input.data(row));
     // avvia il calcolo
     model->compute();
-    if (withoutput) {
-      // controlla la risposta e l'errore restituiti dal modello
-      checkModelResponse(elem) ? ++hits : ++missed;
-      error += lastModelError(elem);
-    }
-    // salva l'output del modello
-    saveLastOutputs(dataset[elem].id);
+    // controlla e salva l'output del modello
+    checkOutputs(elem, &model->getOutputs()[0]);
   } // end for elem
+  results.flush();
   if (withoutput) {
     // calcola i valori finali
     accuracy = (hits*100.0) / dataset.getSize();
@@ -200,19 +259,189 @@ void Tester::start() {
 // PRIVATE METHODS
 // ===============
 
+/**
+ * Method getNumberOfInputs
+ *
+ * Restituisce il numero di inputs del modello (o dell'ensemble) da testare.
+ */
+uint Tester::getNumberOfInputs() const {
+  if (ensemble != NULL) return ensemble->getNumberOfInputs();
+  return model->getNumberOfInputs();
+} // End method getNumberOfInputs
+
+/**
+ * Method getNumberOfOutputs
+ *
+ * Restituisce il numero di outputs del modello (o dell'ensemble) da testare.
+ */
+uint Tester::getNumberOfOutputs() const {
+  if (ensemble != NULL) return ensemble->getNumberOfOutputs();
+  return model->getNumberOfOutputs();
+} // End method getNumberOfOutputs
+
+/**
+ * Method startEnsemble
+ *
+ * Esegue il test dell'ensemble: il dataset viene diviso in blocchi di
+ * Ensemble::BLOCK istanze, i cui inputs vengono copiati in un unico vettore e
+ * valutati insieme da tutte le reti (vedere Ensemble::compute).
+ */
+void Tester::startEnsemble() {
+  const uint ninputs = getNumberOfInputs();
+  const uint noutputs = getNumberOfOutputs();
+  std::vector<real> inputs(Ensemble::BLOCK * ninputs);
+  std::vector<real> outputs;
+  for (uint first = 0; first < dataset.getSize(); first += Ensemble::BLOCK) {
+    uint size = std::min(Ensemble::BLOCK, dataset.getSize() - first);
+    // copia gli inputs del blocco
+    for (uint i = 0; i < size; ++i)
+      dataset[first+i].input.copy(&inputs[i * ninputs]);
+    ensemble->compute(inputs, size, outputs);
+    // controlla e salva gli outputs del blocco
+    for (uint i = 0; i < size; ++i)
+      checkOutputs(first+i, &outputs[i * noutputs]);
+  } // end for first
+  return;
+} // End method startEnsemble
+
+/**
+ * Method startParallel
+ *
+ * Esegue il test con nthreads threads: il dataset viene diviso in nthreads
+ * partizioni contigue, valutate in parallelo (la prima nel thread corrente)
+ * dal metodo testPartition con gli stessi pesi, quelli dell'ensemble o del
+ * modello copiati in un ensemble di una sola rete (con gli stessi outputs,
+ * vedere la classe Ensemble). Le partizioni vengono unite ai risultati
+ * (vedere mergePartition) nell'ordine del dataset, ognuna appena terminato il
+ * proprio thread, percui la scrittura degli outputs di una partizione si
+ * sovrappone alla valutazione delle successive: i risultati non dipendono dal
+ * numero di threads e sono identici a quelli dei metodi start e
+ * startEnsemble.
+ */
+void Tester::startParallel(uint nthreads) {
+  Ensemble single;
+  const Ensemble* shared = ensemble;
+  if (shared == NULL) {
+    single.add(*model);
+    shared = &single;
+  }
+  // divide il dataset in partizioni contigue
+  const uint size = dataset.getSize();
+  std::vector<Partition> parts(nthreads);
+  for (uint k = 0; k < nthreads; ++k) {
+    parts[k].first = size / nthreads * k + std::min(k, size % nthreads);
+    parts[k].size = size / nthreads + (k < size % nthreads ? 1 : 0);
+  }
+  // valuta le partizioni
+  std::vector<std::thread> workers;
+  for (uint k = 1; k < nthreads; ++k)
+    workers.push_back(std::thread(&Tester::testPartition, this, shared,
+        &parts[k]));
+  testPartition(shared, &parts[0]);
+  mergePartition(parts[0]);
+  // unisce le altre partizioni nell'ordine del dataset
+  for (uint k = 1; k < nthreads; ++k) {
+    workers[k-1].join();
+    mergePartition(parts[k]);
+  }
+  return;
+} // End method startParallel
+
+/**
+ * Method mergePartition
+ *
+ * Somma ai risultati del test gli errori e le risposte corrette della
+ * partizione passata (gia` valutata dal metodo testPartition) e ne salva gli
+ * outputs su file (se richiesto), istanza per istanza; libera poi i buffers
+ * della partizione.
+ */
+void Tester::mergePartition(Partition& part) {
+  const uint noutputs = getNumberOfOutputs();
+  for (uint i = 0; i < part.size; ++i) {
+    if (withoutput) {
+      part.hits[i] ? ++hits : ++missed;
+      error += part.errors[i];
+    }
+    if (!part.outputs.empty())
+      saveLastOutputs(dataset[part.first+i].id, &part.outputs[i * noutputs]);
+  } // end for i
+  part = Partition();
+  return;
+} // End method mergePartition
+
+/**
+ * Method testPartition
+ *
+ * Valuta con i pesi dell'ensemble shared (senza modificarlo) le istanze della
+ * partizione passata, a blocchi di Ensemble::BLOCK istanze, e ne conserva
+ * nella partizione gli outputs (solo se salvati su file, vedere
+ * setSaveModelResponses) e, se il dataset ha gli outputs, l'errore e la
+ * correttezza della risposta di ogni istanza. Utilizza solo buffers propri,
+ * per cui puo` essere eseguito in parallelo su partizioni diverse.
+ */
+void Tester::testPartition(const Ensemble* shared, Partition* part) const {
+  const uint ninputs = getNumberOfInputs();
+  const uint noutputs = getNumberOfOutputs();
+  Ensemble::Workspace workspace;
+  std::vector<real> inputs(Ensemble::BLOCK * ninputs);
+  std::vector<real> outputs;
+  const bool save = !resfile.empty();
+  if (save) part->outputs.resize(std::size_t(part->size) * noutputs);
+  if (withoutput) {
+    part->errors.resize(part->size);
+    part->hits.resize(part->size);
+  }
+  for (uint first = 0; first < part->size; first += Ensemble::BLOCK) {
+    const uint size = std::min(Ensemble::BLOCK, part->size - first);
+    // copia gli inputs del blocco
+    for (uint i = 0; i < size; ++i)
+      dataset[part->first+first+i].input.copy(&inputs[i * ninputs]);
+    shared->compute(inputs, size, outputs, workspace);
+    if (save) std::copy(outputs.begin(), outputs.end(),
+        part->outputs.begin() + std::size_t(first) * noutputs);
+    // controlla gli outputs del blocco
+    if (withoutput) for (uint i = 0; i < size; ++i) {
+      const uint elem = part->first + first + i;
+      const real* out = &outputs[i * noutputs];
+      part->hits[first+i] = checkModelResponse(elem, out);
+      part->errors[first+i] = lastModelError(elem, out);
+    } // end for i
+  } // end for first
+  return;
+} // End method testPartition
+
+/**
+ * Method checkOutputs
+ *
+ * Aggiorna i risultati del test con gli outputs del modello (o dell'ensemble)
+ * per l'i-esima istanza del dataset e li salva su file (se richiesto).
+ */
+inline
+void Tester::checkOutputs(uint i, const real* outputs) {
+  if (withoutput) {
+    // controlla la risposta e l'errore restituiti dal modello
+    checkModelResponse(i, outputs) ? ++hits : ++missed;
+    error += lastModelError(i, outputs);
+  }
+  // salva l'output del modello
+  saveLastOutputs(dataset[i].id, outputs);
+  return;
+} // End method checkOutputs
+
 /**
  * Method checkModelResponse
  *
- * Controlla l'ultimo output del modello e lo confronta con l'i-esimo output
- * del dataset. Restituisce true se la risposta del modello e` uguale a quella
+ * Controlla gli outputs del modello e li confronta con l'i-esimo output del
+ * dataset. Restituisce true se la risposta del modello e` uguale a quella
  * del dataset rispetto alla soglia impostata (entrambi maggiori o entrambi
  * minori).
  */
-bool Tester::checkModelResponse(uint i) const {
+bool Tester::checkModelResponse(uint i, const real* outputs) const {
   const real TH = threshold;
-  for (uint k = 0; k < dataset[i].output.size(); ++k) {
-    if ( ((dataset[i].output[k] > TH) && (model->getOutput(k) <= TH)) ||
-         ((dataset[i].output[k] <= TH) && (model->getOutput(k) > TH)) )
+  const Dataset::Values output = dataset[i].output;
+  for (uint k = 0; k < output.size(); ++k) {
+    if ( ((output[k] > TH) && (outputs[k] <= TH)) ||
+         ((output[k] <= TH) && (outputs[k] > TH)) )
       return false;
   } // end for k
   return true;
@@ -221,43 +450,32 @@ bool Tester::checkModelResponse(uint i) const {
 /**
  * Method lastModelError
  *
- * Restituisce l'errore quadratico dell'ultimo output del modello rispetto all'
+ * Restituisce l'errore quadratico degli outputs del modello rispetto all'
  * output dell'i-esimo elemento nel dataset.
  * Viene restituito l'errore secondo la formula:
  *   E = (1/2) * Sum( (d(j)-y(j))^2 )
  */
-real Tester::lastModelError(uint i) const {
+real Tester::lastModelError(uint i, const real* outputs) const {
   real err = 0.0;
-  for (uint k = 0; k < dataset[i].output.size(); ++k)
-    err += pow(dataset[i].output[k] - model->getOutput(k), 2);
+  const Dataset::Values output = dataset[i].output;
+  for (uint k = 0; k < output.size(); ++k)
+    err += pow(output[k] - outputs[k], 2);
   return err / 2;
 } // End method lastModelError
 
 /**
  * Method saveLastOutputs
  *
- * Appende nel file "resfile" gli ultimi output restituiti dal modello
+ * Appende nel file "resfile" gli outputs passati (restituiti dal modello)
  * preceduti dall'id (una stringa qualunque) passato come parametro:
  *   id, last_output[1], ..., last_output[n]
  * Se resfile non contiene un nome di file esce senza compiere nulla.
  */
-void Tester::saveLastOutputs(const std::string& id) const {
+void Tester::saveLastOutputs(std::string_view id, const real* outputs) {
   if (resfile.empty()) return;
-  std::ofstream ofs;
-  // modifica il formato di stampa per i numeri floating point
-  std::streamsize prprec = ofs.precision(5);
-  std::ios::fmtflags prflag =
-      ofs.setf(std::ios::scientific, std::ios::floatfield);
-  // apre il file e aggiunge una riga con i risultati
-  ofs.open(resfile.c_str(),  std::ios::out | std::ios::app);
-  if (!ofs.is_open()) throw file_error("In Trainer::saveLastOutputs");
-  ofs <<id;
-  for (uint i = 0; i < model->getNumberOfOutputs(); ++i)
-    ofs <<"," <<model->getOutput(i);
-  ofs <<std::endl;
-  ofs.close();
-  // ripristina il formato stampa
-  ofs.precision(prprec);
-  ofs.setf(prflag, std::ios::floatfield);
+  results <<id;
+  for (uint i = 0; i < getNumberOfOutputs(); ++i)
+    results <<',' <<outputs[i];
+  results.endLine();
   return;
 } // End method saveLastOutputs
@@ -2,9 +2,13 @@
 #define TESTER_H_
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include "global.h"
 #include "dataset.h"
 #include "neuralnetwork.h"
+#include "ensemble.h"
+#include "resultwriter.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
@@ -27,17 +31,29 @@ typedef Global::real real;
  * Il test puo` essere effettuato anche senza output nel dataset (impostando
  * withoutput = false nel costruttore), in questo caso l'unico scopo utile del
  * test e` salvare le risposte del modello su file.
+ * Al posto di un singolo modello si puo` testare un ensemble di reti neurali
+ * (vedere la classe Ensemble), la cui risposta e` la media delle risposte delle
+ * reti; in questo caso il dataset viene valutato a blocchi di istanze.
+ * Con il metodo setThreads il dataset viene diviso in partizioni contigue,
+ * valutate in parallelo da piu` threads con gli stessi pesi (in sola lettura)
+ * e un workspace privato per thread (vedere Ensemble::compute). I risultati
+ * di ogni istanza vengono poi sommati e salvati nell'ordine del dataset, per
+ * cui sono identici a quelli di un test con un solo thread.
  */
 class Tester
 {
   public:
     Tester ( NeuralNetwork* model, bool withoutput = true );
+    Tester ( Ensemble* ensemble, bool withoutput = true );
     virtual ~Tester ( );
 
     void setDataSet ( const std::string& file );
-    void setSaveModelResponses ( const std::string& file );
+    void setSaveModelResponses ( const std::string& file,
+        bool background = false );
     void setThreshold( real threshold );
+    void setThreads ( uint n );
     uint getDatasetDimension ( ) const;
+    const Dataset& getDataSet ( ) const;
     uint getNumberOfMissed ( ) const;
     uint getNumberOfHits ( ) const;
     real getAccuracy ( ) const;
@@ -45,16 +61,38 @@ class Tester
     void start ( );
 
   private:
+    /**
+     * Partizione del dataset valutata da un thread: le istanze first, ...,
+     * first+size-1 con i loro outputs (solo se salvati su file), errori e
+     * risposte corrette.
+     */
+    struct Partition {
+      uint first, size;
+      std::vector<real> outputs, errors;
+      std::vector<char> hits;
+    };
+
+    static const uint MIN_PARTITION;
     NeuralNetwork* model;
+    Ensemble* ensemble;
     Dataset dataset;
     bool withoutput;
     uint missed, hits;
     real threshold, accuracy, error;
+    uint threads;
     std::string resfile;
+    ResultWriter results;
 
-    bool checkModelResponse ( uint i ) const;
-    real lastModelError ( uint i ) const;
-    void saveLastOutputs ( const std::string& id ) const;
+    uint getNumberOfInputs ( ) const;
+    uint getNumberOfOutputs ( ) const;
+    void startEnsemble ( );
+    void startParallel ( uint nthreads );
+    void testPartition ( const Ensemble* shared, Partition* part ) const;
+    void mergePartition ( Partition& part );
+    void checkOutputs ( uint i, const real* outputs );
+    bool checkModelResponse ( uint i, const real* outputs ) const;
+    real lastModelError ( uint i, const real* outputs ) const;
+    void saveLastOutputs ( std::string_view id, const real* outputs );
 
 }; // End class Tester
 
@@ -6,11 +6,19 @@
 #include <cstdlib>
 #include <cassert>
 #include <cmath>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <ctime>
 #include "global.h"
 #include "exception.h"
 #include "neuralnetwork.h"
 #include "backpropagation.h"
 #include "dataset.h"
+#include "datasetstream.h"
+#include "prefetcher.h"
+#include "checkpoint.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
@@ -24,21 +32,46 @@ typedef Global::real real;
 Trainer::Trainer(NeuralNetwork* model, BackPropagation* algorithm) :
     model(model),
     initmodel(new NeuralNetwork(*model)),
+    bestmodel(new NeuralNetwork(*model)),
+    vamodel(new NeuralNetwork(*model)),
     algorithm(algorithm),
+    stream(NULL),
+    prefetcher(NULL),
+    random(Global::getRandStream(0)),
+    rstream(0),
+    epochbuffer(false), epochready(false),
+    blockrows(0),
     epochs(0), maxepochs(0), shfepochs(0),
     vaerr(0.0), trerr(0.0), stoperr(-1),
     vaacc(0.0), tracc(0.0), stopacc(1.1),
     threshold(0.5),
     prevtrerr(0.0),
     stoperrch_var(0.0),
-    stoperrch_ep(0), stoperrch_n(0)
-{ } // End constructor
+    stoperrch_ep(0), stoperrch_n(0),
+    patience(0),
+    maxtime(0.0), spent(0.0), cpuspent(0.0),
+    maxsamples(0), samples(0),
+    cstart(0),
+    exhausted(false),
+    vaepochs(1), vasize(0),
+    vaerrci(0.0), vaaccci(0.0),
+    vadone(true), vasampled(false),
+    started(false), stopped(false), restored(false), interrupted(false),
+    pipelined(false),
+    checkpoint(NULL),
+    chkepochs(0)
+{
+  timerclear(&tstart);
+} // End constructor
 
 /**
  * Destructor ~Trainer
  */
 Trainer::~Trainer() {
   delete initmodel;
+  delete bestmodel;
+  delete vamodel;
+  delete prefetcher;
 }
 
 // ==============
@@ -58,9 +91,103 @@ void Trainer::setDataSet(const std::string& filename) {
   assert( model != NULL );
   dataset.load(
       filename, model->getNumberOfInputs(), model->getNumberOfOutputs() );
+  epochready = false;
   return;
 } // End method setDataSet
 
+/**
+ * Method setDataSet
+ *
+ * Imposta come dataset una copia del dataset passato, mantenendone l'ordine
+ * delle istanze e le partizioni (folds e validation fold) gia` impostate. Il
+ * numero di inputs e di outputs del dataset deve corrispondere a quello del
+ * modello impostato.
+ */
+void Trainer::setDataSet(const Dataset& dataset) {
+  assert( model != NULL );
+  this->dataset = dataset;
+  epochready = false;
+  return;
+} // End method setDataSet (copy)
+
+/**
+ * Method setDataStream
+ *
+ * Imposta l'oggetto da cui leggere a blocchi il dataset (vedere la classe
+ * DatasetStream) al posto del dataset in memoria; l'oggetto non viene
+ * eliminato dal trainer. Il training set viene letto blocco per blocco ad ogni
+ * epoca e il validation set (i cui folds sono determinati dagli ids delle
+ * istanze) ad ogni validation. La validation in parallelo (vedere
+ * setPipelinedValidation) e su un sottoinsieme (setValidationSample) e il
+ * salvataggio dello stato non sono supportati con la lettura a blocchi.
+ */
+void Trainer::setDataStream(DatasetStream* stream) {
+  this->stream = stream;
+  return;
+} // End method setDataStream
+
+/**
+ * Method setPrefetch
+ *
+ * Se batchsize e` maggiore di 0 le istanze del training set vengono preparate
+ * da un thread separato (vedere la classe Prefetcher) in batch di batchsize
+ * istanze (anche se il dataset e` letto a blocchi), copiate in un buffer
+ * contiguo mentre il training utilizza il batch precedente. L'ordine
+ * delle istanze, e quindi il risultato del training, non cambia.
+ */
+void Trainer::setPrefetch(uint batchsize) {
+  delete prefetcher;
+  prefetcher = (batchsize > 0 ? new Prefetcher(batchsize) : NULL);
+  return;
+} // End method setPrefetch
+
+/**
+ * Method setRandStream
+ *
+ * Imposta la sottosequenza di numeri casuali (vedere Global::getRandStream)
+ * utilizzata per il training, ripartendo dal suo inizio: ad esempio il numero
+ * del fold o della configurazione, in modo che i risultati non dipendano dai
+ * training eseguiti prima (o in parallelo). Di default e` la sottosequenza 0.
+ */
+void Trainer::setRandStream(unsigned long long k) {
+  rstream = k;
+  random = Global::getRandStream(k);
+  return;
+} // End method setRandStream
+
+/**
+ * Method setEpochBuffer
+ *
+ * Se enable e` true il training set viene copiato, nell'ordine corrente, in
+ * due matrici contigue (inputs e outputs, vedere Dataset::gatherTrainingSet)
+ * lette in sequenza durante l'epoca, invece di accedere alle istanze sparse in
+ * memoria attraverso l'ordine casuale; la copia, fatta in parallelo, viene
+ * ripetuta solo quando l'ordine cambia. Il risultato del training non cambia.
+ * Non ha effetto se il dataset e` letto a blocchi (vedere setDataStream).
+ */
+void Trainer::setEpochBuffer(bool enable) {
+  epochbuffer = enable;
+  epochready = false;
+  epochinputs.clear();
+  epochoutputs.clear();
+  return;
+} // End method setEpochBuffer
+
+/**
+ * Method setBlockShuffle
+ *
+ * Se rows e` maggiore di 1 il training set viene riordinato (vedere
+ * setShuffleEpochs) a blocchi di rows istanze consecutive in memoria, in
+ * ordine casuale e riordinate all'interno di ogni blocco (vedere
+ * Dataset::randomShuffleTrainingSet), invece che con una permutazione
+ * casuale di tutte le istanze; se rows e` 0 (default) o 1 la permutazione e`
+ * completa.
+ */
+void Trainer::setBlockShuffle(uint rows) {
+  blockrows = rows;
+  return;
+} // End method setBlockShuffle
+
 /**
  * Method setFolds
  *
@@ -71,8 +198,14 @@ void Trainer::setDataSet(const std::string& filename) {
  * (permutato in modo casuale), senza validation.
  */
 void Trainer::setFolds(uint n) {
+  if (stream != NULL) {
+    stream->setFolds(n);
+    stream->shuffle();
+    return;
+  }
   dataset.randomShuffle();
   dataset.setFolds(n);
+  epochready = false;
   return;
 } // setFolds
 
@@ -84,7 +217,9 @@ void Trainer::setFolds(uint n) {
  * numero di partizioni).
  */
 void Trainer::setValidationOn(uint k) {
-  dataset.setValidationFold(k);
+  if (stream != NULL) stream->setValidationFold(k);
+  else dataset.setValidationFold(k);
+  epochready = false;
 } // setNumberOfFolds
 
 /**
@@ -153,6 +288,44 @@ void Trainer::setStopAccuracy(real accuracy) {
   this->stopacc = accuracy;
 } // End method setStopAccuracy
 
+/**
+ * Method setStopValidation
+ *
+ * Il processo di training si ferma quando l'errore sul validation set non
+ * migliora (non scende sotto il minimo raggiunto) per patience epoche
+ * consecutive. Se patience e` 0, o non c'e` validation set, il training
+ * termina solo quando si verifica un altro criterio di stop.
+ */
+void Trainer::setStopValidation(uint patience) {
+  this->patience = patience;
+} // End method setStopValidation
+
+/**
+ * Method setMaxTime
+ *
+ * Imposta il tempo massimo (in secondi) della sessione di training (avviata
+ * con start, comprese le successive invocazioni di resume). Il tempo viene
+ * controllato durante l'epoca (ogni 64 istanze): quando e` esaurito l'epoca
+ * corrente viene troncata e il training si ferma, dopo aver eseguito la
+ * validation completa dell'ultima epoca. Se impostato a 0 (default) non c'e`
+ * limite.
+ */
+void Trainer::setMaxTime(double seconds) {
+  this->maxtime = seconds;
+} // End method setMaxTime
+
+/**
+ * Method setMaxSamples
+ *
+ * Imposta il numero massimo di istanze (sommate su tutte le epoche) su cui
+ * applicare l'algoritmo di training nella sessione di training. Quando viene
+ * raggiunto l'epoca corrente viene troncata e il training si ferma (vedere
+ * setMaxTime). Se impostato a 0 (default) non c'e` limite.
+ */
+void Trainer::setMaxSamples(unsigned long long n) {
+  this->maxsamples = n;
+} // End method setMaxSamples
+
 /**
  * Method setThreshold
  *
@@ -173,6 +346,58 @@ void Trainer::setThreshold(real threshold) {
   this->threshold = threshold;
 } // End method setThreshold
 
+/**
+ * Method setPipelinedValidation
+ *
+ * Se enable e` true, al termine del training di ogni epoca i pesi del modello
+ * vengono copiati in una seconda rete su cui viene eseguita la validation in
+ * un thread separato, mentre nel thread principale prosegue il training
+ * dell'epoca successiva (vedere il metodo runPipelined). La seconda rete e`
+ * allocata alla costruzione (come quella del modello migliore), percui la
+ * sequenza di numeri casuali non dipende da questa impostazione. I risultati
+ * di ogni epoca sono gli stessi dell'esecuzione sequenziale, ma i criteri di
+ * stop vengono controllati con un'epoca di ritardo.
+ */
+void Trainer::setPipelinedValidation(bool enable) {
+  this->pipelined = enable;
+} // End method setPipelinedValidation
+
+/**
+ * Method setValidationEpochs
+ *
+ * Imposta ogni quante epoche eseguire la validation (default 1, ad ogni
+ * epoca). La validation viene comunque eseguita sull'intero validation set
+ * nell'ultima epoca e nell'epoca in cui viene raggiunto un criterio di stop.
+ * Nelle epoche senza validation i risultati di validation restano quelli
+ * dell'ultima validation eseguita (e nel file dei risultati i relativi campi
+ * restano vuoti).
+ */
+void Trainer::setValidationEpochs(uint n) {
+  this->vaepochs = (n == 0) ? 1 : n;
+} // End method setValidationEpochs
+
+/**
+ * Method setValidationSample
+ *
+ * Imposta la validation su un sottoinsieme casuale (fissato all'inizio del
+ * training) di circa size istanze del validation set, stratificato per classe:
+ * le istanze vengono raggruppate per valore degli outputs rispetto alla soglia
+ * (vedere setThreshold) e da ogni gruppo viene estratto un numero di istanze
+ * proporzionale (almeno una). Gli errori di validation sono la stima
+ * stratificata sull'intero validation set, di cui viene calcolato anche
+ * l'intervallo di confidenza al 95% (salvato nel file dei risultati). La
+ * validation viene comunque eseguita sull'intero validation set nell'ultima
+ * epoca, nell'epoca in cui viene raggiunto un criterio di stop e nelle epoche
+ * in cui la stima migliora l'errore minimo o l'accuratezza massima: i valori
+ * migliori (e il modello migliore) vengono presi solo dalla validation
+ * sull'intero validation set. Se size e` 0
+ * (default) o non e` minore del validation set si usa sempre l'intero
+ * validation set. Va impostato prima di setSaveResults.
+ */
+void Trainer::setValidationSample(uint size) {
+  this->vasize = size;
+} // End method setValidationSample
+
 /**
  * Method setSaveResults
  *
@@ -180,31 +405,123 @@ void Trainer::setThreshold(real threshold) {
  * passata e` una stringa vuota i dati non vengono salvati.
  * I dati vengono salvati nel seguente formato (csv):
  *   epoch, tr.error, va.error, tr.accuracy, va.accuracy
- * con una riga per ogni epoca del training.
+ * con una riga per ogni epoca del training. Se la validation e` fatta su un
+ * sottoinsieme (vedere setValidationSample) vengono aggiunti i campi
+ *   va.error ci, va.accuracy ci
+ * con la semiampiezza degli intervalli di confidenza (0 per le epoche con la
+ * validation completa).
+ * Se append e` true (training ripreso con loadState) il file esistente viene
+ * mantenuto, eliminando le righe successive all'epoca ripristinata.
  */
-void Trainer::setSaveResults(const std::string& file) {
+void Trainer::setSaveResults(const std::string& file, bool append) {
+  results.close();
   resfile = file;
-  if (!resfile.empty()) {
-    std::ofstream ofs(resfile.c_str());
-    if (!ofs.is_open()) throw file_error("In Trainer::setSaveResults");
-    ofs <<"\"epoch\",\"tr_error\",\"va_error\",\"tr_accuracy\",\"va_accuracy\"";
-    ofs <<std::endl;
-    ofs.close();
+  if (resfile.empty()) return;
+  // legge le righe da mantenere (intestazione esclusa)
+  std::vector<std::string> rows;
+  if (append) {
+    std::string line;
+    std::ifstream ifs(resfile.c_str());
+    std::getline(ifs, line);
+    while (rows.size() < epochs && std::getline(ifs, line))
+      rows.push_back(line);
+  }
+  // riscrive il file, che resta aperto per le righe delle epoche successive
+  results.open(resfile);
+  results <<"\"epoch\",\"tr_error\",\"va_error\",\"tr_accuracy\",";
+  results <<"\"va_accuracy\"";
+  if (vasize != 0) results <<",\"va_error_ci\",\"va_accuracy_ci\"";
+  results.endLine();
+  for (uint i = 0; i < rows.size(); ++i) {
+    results <<rows[i];
+    results.endLine();
   }
+  results.flush();
   return;
 } // End method setSaveResults
 
+/**
+ * Method setCheckpoint
+ *
+ * Imposta il salvataggio dello stato del training (vedere saveState) nel file
+ * passato, ogni epochs epoche (se epochs e` 0 solo alla richiesta di
+ * terminazione, vedere Global::catchTermination). Lo stato viene scritto nel
+ * checkpoint passato, che puo` contenere anche informazioni aggiuntive
+ * (impostate dal chiamante) salvate insieme allo stato del trainer.
+ * Se viene ricevuta una richiesta di terminazione, il training si interrompe
+ * al termine dell'epoca corrente dopo aver salvato lo stato.
+ */
+void Trainer::setCheckpoint(Checkpoint* checkpoint, const std::string& file,
+    uint epochs) {
+  this->checkpoint = checkpoint;
+  this->chkfile = file;
+  this->chkepochs = epochs;
+  return;
+} // End method setCheckpoint
+
+/**
+ * Method setInitialModel
+ *
+ * Imposta i pesi da cui parte il training (anche dopo resetModel) copiandoli
+ * dalla rete passata, che deve avere la stessa topologia del modello (stesso
+ * numero di inputs, strati e unita` per strato). Anche il modello corrente
+ * viene impostato con tali pesi.
+ */
+void Trainer::setInitialModel(const NeuralNetwork& init) {
+  initmodel->copyWeights(init);
+  model->copyWeights(init);
+  return;
+} // End method setInitialModel
+
+/**
+ * Method setInitialMomentum
+ *
+ * Imposta lo stato dell'algoritmo di training (la tabella del momentum, vedere
+ * BackPropagation::getMomentum) all'inizio di ogni sessione di training, ad
+ * esempio per proseguire il training di una rete (vedere setInitialModel) con
+ * il momentum salvato in un checkpoint. Con un vettore vuoto il momentum parte
+ * da zero (default).
+ */
+void Trainer::setInitialMomentum(const std::vector<real>& momentum) {
+  initmomentum = momentum;
+  return;
+} // End method setInitialMomentum
+
 /**
  * Method resetModel
  *
  * Ripristina il modello a quello di partenza, come se il training non fosse
- * avvenuto.
+ * avvenuto. Vengono ripristinati i pesi del modello passato al costruttore
+ * (l'oggetto rimane lo stesso).
  */
 void Trainer::resetModel ( ) {
-  delete model;
-  model = new NeuralNetwork(*initmodel);
+  model->copyWeights(*initmodel);
+  started = false;
+  stopped = false;
 } // End method resetModel
 
+/**
+ * Method getModel
+ *
+ * Restituisce il modello corrente (con i pesi dell'ultima epoca eseguita).
+ */
+const NeuralNetwork& Trainer::getModel ( ) const {
+  return *model;
+} // End method getModel
+
+/**
+ * Method getBestModel
+ *
+ * Restituisce il modello con i pesi dell'epoca in cui e` stato raggiunto il
+ * minimo errore di validation (vedere getMinValidationError) nell'ultimo
+ * processo di training. Se non c'e` validation set restituisce il modello
+ * corrente.
+ */
+const NeuralNetwork& Trainer::getBestModel ( ) const {
+  if (!hasValidationSet()) return *model;
+  return *bestmodel;
+} // End method getBestModel
+
 /**
  * Method getEpochs
  *
@@ -215,6 +532,16 @@ uint Trainer::getEpochs() const {
   return epochs;
 } // End method getEpochs
 
+/**
+ * Method getSamples
+ *
+ * Restituisce il numero di istanze su cui e` stato applicato l'algoritmo di
+ * training nell'ultima sessione di training.
+ */
+unsigned long long Trainer::getSamples() const {
+  return samples;
+} // End method getSamples
+
 /**
  * Method getTrainingError
  *
@@ -325,6 +652,7 @@ const std::pair<real, uint>& Trainer::getMaxValidationAccuracy() const {
  * Restituisce il numero di folds impostati.
  */
 uint Trainer::getFolds() const {
+  if (stream != NULL) return stream->getFolds();
   return dataset.getFolds();
 } // End method getValidationAccuracy
 
@@ -334,6 +662,7 @@ uint Trainer::getFolds() const {
  * Restituisce il numero di istanze dell'i-esimo fold.
  */
 uint Trainer::getFoldDimension(uint i) const {
+  if (stream != NULL) return stream->getFoldSize(i);
   return dataset.getFoldSize(i);
 } // End method getFoldDimension
 
@@ -343,45 +672,349 @@ uint Trainer::getFoldDimension(uint i) const {
  * Restituisce il numero di istanze presenti nel dataset caricato.
  */
 uint Trainer::getDatasetDimension ( ) const {
+  if (stream != NULL) return stream->getSize();
   return dataset.getSize();
 } // End method getDatasetDimension
 
+/**
+ * Method getDataSet
+ *
+ * Restituisce il dataset caricato.
+ */
+const Dataset& Trainer::getDataSet() const {
+  return dataset;
+} // End method getDataSet
+
+/**
+ * Method isStopped
+ *
+ * Restituisce true se nell'ultima sessione di training e` stato raggiunto un
+ * criterio di stop (in tal caso il metodo resume non esegue altre epoche).
+ */
+bool Trainer::isStopped ( ) const {
+  return stopped;
+} // End method isStopped
+
+/**
+ * Method isInterrupted
+ *
+ * Restituisce true se l'ultima sessione di training e` stata interrotta da una
+ * richiesta di terminazione (vedere setCheckpoint).
+ */
+bool Trainer::isInterrupted ( ) const {
+  return interrupted;
+} // End method isInterrupted
+
+/**
+ * Method isExhausted
+ *
+ * Restituisce true se l'ultima sessione di training si e` fermata per aver
+ * esaurito il budget di tempo o di istanze (vedere setMaxTime e
+ * setMaxSamples).
+ */
+bool Trainer::isExhausted ( ) const {
+  return exhausted;
+} // End method isExhausted
+
+/**
+ * Method getSessionTime
+ *
+ * Restituisce il tempo (in secondi) trascorso nella sessione di training: il
+ * tempo delle precedenti invocazioni di run (spent, compreso quello salvato
+ * in un checkpoint ripristinato con loadState) piu` quello trascorso
+ * dall'inizio dell'invocazione corrente (tstart, azzerato fuori da run).
+ */
+double Trainer::getSessionTime() const {
+  if (!timerisset(&tstart)) return spent;
+  timeval now;
+  gettimeofday(&now, NULL);
+  return spent + (now.tv_sec - tstart.tv_sec) +
+      (now.tv_usec - tstart.tv_usec) / 1000000.0;
+} // End method getSessionTime
+
+/**
+ * Method getSessionCpuTime
+ *
+ * Restituisce il tempo di cpu (in secondi) utilizzato nella sessione di
+ * training, calcolato come il tempo del metodo getSessionTime.
+ */
+double Trainer::getSessionCpuTime() const {
+  if (!timerisset(&tstart)) return cpuspent;
+  return cpuspent + (clock() - cstart) / double(CLOCKS_PER_SEC);
+} // End method getSessionCpuTime
+
+/**
+ * Method saveState
+ *
+ * Scrive nel checkpoint passato lo stato corrente del training: stato del
+ * generatore di numeri casuali, epoca da cui riprendere, pesi del modello,
+ * momentum dell'algoritmo, ordine delle istanze del dataset (e sottoinsieme
+ * per la validation), risultati dell'ultima epoca e migliori raggiunti
+ * (compresi i pesi del modello migliore).
+ */
+void Trainer::saveState(Checkpoint& checkpoint) const {
+  checkpoint.rseed = Global::getRandSeed();
+  random.getState(checkpoint.rstate);
+  checkpoint.rcount = random.getCount();
+  checkpoint.epoch = epochs;
+  checkpoint.stopped = stopped;
+  model->getWeights(checkpoint.weights);
+  bestmodel->getWeights(checkpoint.bestweights);
+  algorithm->getMomentum(checkpoint.momentum);
+  dataset.getAccessVectors(checkpoint.av, checkpoint.trav);
+  checkpoint.vasample = vasample;
+  checkpoint.vastrata = vastrata;
+  const real results[] = { trerr, vaerr, tracc, vaacc,
+      mintrerr.first, real(mintrerr.second),
+      minvaerr.first, real(minvaerr.second),
+      maxtracc.first, real(maxtracc.second),
+      maxvaacc.first, real(maxvaacc.second),
+      prevtrerr, real(stoperrch_n),
+      real(samples), real(getSessionTime()), real(getSessionCpuTime()) };
+  checkpoint.results.assign(results,
+      results + sizeof(results)/sizeof(results[0]));
+  return;
+} // End method saveState
+
+/**
+ * Method loadState
+ *
+ * Ripristina lo stato del training salvato nel checkpoint passato (vedere
+ * saveState). Il dataset deve avere le stesse partizioni impostate al momento
+ * del salvataggio (stessi folds e validation fold). La successiva invocazione
+ * del metodo start riprende il training dall'epoca salvata.
+ */
+void Trainer::loadState(const Checkpoint& checkpoint) {
+  assert( model != NULL && algorithm != NULL );
+  if (checkpoint.results.size() != 17)
+    throw read_error("In Trainer::loadState");
+  model->setWeights(checkpoint.weights);
+  bestmodel->setWeights(checkpoint.bestweights);
+  algorithm->setModel(model);
+  algorithm->setMomentum(checkpoint.momentum);
+  dataset.setAccessVectors(checkpoint.av, checkpoint.trav);
+  epochready = false;
+  vasample = checkpoint.vasample;
+  vastrata = checkpoint.vastrata;
+  const std::vector<real>& r = checkpoint.results;
+  trerr = r[0]; vaerr = r[1]; tracc = r[2]; vaacc = r[3];
+  mintrerr = std::make_pair(r[4], uint(r[5]));
+  minvaerr = std::make_pair(r[6], uint(r[7]));
+  maxtracc = std::make_pair(r[8], uint(r[9]));
+  maxvaacc = std::make_pair(r[10], uint(r[11]));
+  prevtrerr = r[12];
+  stoperrch_n = uint(r[13]);
+  samples = (unsigned long long) r[14];
+  spent = r[15];
+  cpuspent = r[16];
+  random.setState(checkpoint.rstate, checkpoint.rcount);
+  epochs = checkpoint.epoch;
+  stopped = checkpoint.stopped;
+  started = true;
+  restored = true;
+  return;
+} // End method loadState
+
 /**
  * Method start
  *
  * Esegue l'algoritmo di training sul modello, fermandosi dopo aver raggiunto un
- * criterio di stop impostato o il numero massimo di epoche.
+ * criterio di stop impostato o il numero massimo di epoche. Se e` stato
+ * ripristinato uno stato (con loadState) il training riprende da tale stato.
  * Prima di eseguire questo metodo assicurarsi di aver impostato tutti i
  * parametri con il relativi metodi (in particolare di aver impostato un
  * dataset).
  */
 void Trainer::start() {
   assert( model != NULL && algorithm != NULL );
-  // imposta il modello nell'algoritmo di training
-  algorithm->setModel(model);
-  // azzera le variabili
-  resetTrainingVariables();
-  // ripete per ogni epoca il training
-  for (epochs = 0; (epochs < maxepochs || maxepochs == 0); ++epochs) {
+  if (!restored) {
+    // imposta il modello (e il momentum iniziale) nell'algoritmo di training
+    algorithm->setModel(model);
+    if (!initmomentum.empty()) algorithm->setMomentum(initmomentum);
+    // azzera le variabili
+    resetTrainingVariables();
+    makeValidationSample();
+    epochs = 0;
+    stopped = false;
+    exhausted = false;
+    samples = 0;
+    spent = 0.0;
+    cpuspent = 0.0;
+  }
+  restored = false;
+  started = true;
+  interrupted = false;
+  // esegue le epoche fino al numero massimo
+  if (!stopped) run(maxepochs);
+  return;
+} // End method start
+
+/**
+ * Method resume
+ *
+ * Prosegue l'ultima sessione di training (avviata con start o resume) per al
+ * massimo nepochs epoche, mantenendo lo stato del modello, dell'algoritmo
+ * (momentum) e i risultati raggiunti. Se non e` stata avviata nessuna sessione
+ * ne viene avviata una nuova. Il training si ferma comunque al raggiungimento
+ * di un criterio di stop o del numero massimo di epoche impostato; una volta
+ * raggiunto un criterio di stop ulteriori invocazioni non hanno effetto.
+ */
+void Trainer::resume(uint nepochs) {
+  assert( model != NULL && algorithm != NULL );
+  if (!started) {
+    algorithm->setModel(model);
+    if (!initmomentum.empty()) algorithm->setMomentum(initmomentum);
+    resetTrainingVariables();
+    makeValidationSample();
+    epochs = 0;
+    started = true;
+    stopped = false;
+    exhausted = false;
+    samples = 0;
+    spent = 0.0;
+    cpuspent = 0.0;
+  }
+  if (stopped || nepochs == 0) return;
+  uint lastepoch = epochs + nepochs;
+  if (maxepochs != 0 && lastepoch > maxepochs) lastepoch = maxepochs;
+  run(lastepoch);
+  return;
+} // End method resume
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method run
+ *
+ * Esegue le epoche di training a partire da quella corrente fino all'epoca
+ * lastepoch (esclusa), fermandosi prima se e` raggiunto un criterio di stop.
+ * Se lastepoch e` 0 continua finche` non e` raggiunto un criterio di stop.
+ */
+void Trainer::run(uint lastepoch) {
+  gettimeofday(&tstart, NULL);
+  cstart = clock();
+  if (pipelined && stream == NULL && hasValidationSet()) {
+    runPipelined(lastepoch);
+    spent = getSessionTime();
+    cpuspent = getSessionCpuTime();
+    timerclear(&tstart);
+    return;
+  }
+  while (epochs < lastepoch || lastepoch == 0) {
     // crea un ordine casuale delle istanze del training set
     if ( (shfepochs != 0) && (epochs % shfepochs == 0) )
-      dataset.randomShuffleTrainingSet();
+      shuffleTrainingSet();
     // esegue training e validation sul dataset
     training();
-    validation();
+    scheduleValidation(lastepoch);
+    if (vadone) validation(model);
     // aggiorna le variabili globali
-    updateTrainingVariables();
+    updateTrainingVariables(model);
+    // controlla il criterio di stop impostato
+    stopped = checkStop();
+    completeValidation(model);
     // salva i risultati di questa epoca
     saveEpochResults();
-    // controlla il criterio di stop impostato
-    if (checkStop()) break;
-  } // end for epochs
+    if (!stopped) ++epochs;
+    // salva lo stato del training
+    if (checkInterruption()) break;
+  } // end while
+  spent = getSessionTime();
+  cpuspent = getSessionCpuTime();
+  timerclear(&tstart);
   return;
-} // End method start
+} // End method run
 
-// ===============
-// PRIVATE METHODS
-// ===============
+/**
+ * Method runPipelined
+ *
+ * Come il metodo run, ma la validation dell'epoca corrente viene eseguita in
+ * un thread separato su una copia dei pesi (vamodel), mentre il thread
+ * principale esegue il training dell'epoca successiva. I risultati dell'epoca
+ * corrente vengono registrati (e i criteri di stop controllati) al termine di
+ * entrambi. Se l'epoca corrente soddisfa un criterio di stop il training gia`
+ * eseguito dell'epoca successiva viene scartato, riportando il modello ai pesi
+ * della copia e il generatore di numeri casuali, il numero di istanze
+ * utilizzate, l'ordine del training set e il momentum dell'algoritmo allo
+ * stato precedente, percui lo stato (anche quello salvato nei checkpoint) e`
+ * identico a quello del metodo run.
+ * Il training dell'epoca successiva non viene anticipato quando al termine
+ * dell'epoca corrente deve essere salvato lo stato (vedere setCheckpoint), in
+ * modo che il checkpoint non contenga un'epoca in piu`.
+ */
+void Trainer::runPipelined(uint lastepoch) {
+  bool ahead = false; // training dell'epoca successiva gia` eseguito
+  real curtrerr, curtracc;
+  bool curexhausted;
+  // stato precedente al training dell'epoca successiva
+  std::vector<real> curmomentum;
+  std::vector<uint> curav, curtrav;
+  while (epochs < lastepoch || lastepoch == 0) {
+    // esegue il training dell'epoca corrente (se non gia` eseguito)
+    if (!ahead) {
+      if ( (shfepochs != 0) && (epochs % shfepochs == 0) )
+        shuffleTrainingSet();
+      training();
+    }
+    curtrerr = trerr;
+    curtracc = tracc;
+    curexhausted = exhausted;
+    // avvia la validation dell'epoca corrente su una copia dei pesi
+    vamodel->copyWeights(*model);
+    scheduleValidation(lastepoch);
+    std::thread vathread;
+    if (vadone) vathread = std::thread(&Trainer::validation, this, vamodel);
+    // nel frattempo esegue il training dell'epoca successiva
+    uint next = epochs + 1;
+    Random currandom = random;
+    unsigned long long cursamples = samples;
+    const bool shuffle = (shfepochs != 0) && (next % shfepochs == 0);
+    ahead = (next < lastepoch || lastepoch == 0) && !exhausted &&
+        !Global::isTerminationRequested() &&
+        !(checkpoint != NULL && chkepochs != 0 && next % chkepochs == 0);
+    if (ahead) {
+      algorithm->getMomentum(curmomentum);
+      if (shuffle) {
+        dataset.getAccessVectors(curav, curtrav);
+        shuffleTrainingSet();
+      }
+      training();
+    }
+    if (vathread.joinable()) vathread.join();
+    // registra i risultati dell'epoca corrente
+    std::swap(trerr, curtrerr);
+    std::swap(tracc, curtracc);
+    std::swap(exhausted, curexhausted);
+    updateTrainingVariables(vamodel);
+    stopped = checkStop();
+    completeValidation(vamodel);
+    saveEpochResults();
+    if (stopped && ahead) {
+      model->copyWeights(*vamodel);
+      random = currandom;
+      samples = cursamples;
+      algorithm->setMomentum(curmomentum);
+      if (shuffle) {
+        dataset.setAccessVectors(curav, curtrav);
+        epochready = false;
+      }
+      ahead = false;
+    }
+    if (!stopped) ++epochs;
+    // passa all'epoca successiva, gia` addestrata (con i suoi risultati)
+    if (ahead) {
+      trerr = curtrerr;
+      tracc = curtracc;
+      exhausted = curexhausted;
+      continue;
+    }
+    // salva lo stato del training
+    if (checkInterruption()) break;
+  } // end while
+  return;
+} // End method runPipelined
 
 /**
  * Method training
@@ -390,52 +1023,385 @@ void Trainer::start() {
  * Aggiorna i valori per le seguenti variabili con gli errori di training:
  *   - trerr : errore quadratico medio di training
  *   - tracc : accuracy sul dataset di training
+ * Se durante l'epoca viene esaurito il budget (vedere setMaxTime e
+ * setMaxSamples) l'epoca viene troncata, gli errori sono calcolati sulle
+ * istanze utilizzate e la variabile exhausted viene impostata a true.
  */
 void Trainer::training() {
+  if (epochbuffer && stream == NULL) {
+    trainingBuffered();
+    return;
+  }
+  if (prefetcher != NULL) {
+    trainingPrefetched();
+    return;
+  }
+  if (stream != NULL) {
+    trainingStream();
+    return;
+  }
   // azzerra le variabili
   trerr = 0.0;
   tracc = 0.0;
-  for (uint element = 0; element < dataset.getTrSetSize(); ++element) {
+  uint size = dataset.getTrSetSize();
+  for (uint element = 0; element < size; ++element) {
+    const Dataset::Instance instance = dataset.trAt(element);
     // esegue l'algoritmo su un elemento del dataset
-    algorithm->compute(
-        dataset.trAt(element).input, dataset.trAt(element).output );
-    // calcola i nuovi errori
-    model->setInputs(dataset.trAt(element).input);
-    model->compute();
-    trerr += modelError(model->getOutputs(), dataset.trAt(element).output);
-    tracc += modelHit(model->getOutputs(), dataset.trAt(element).output);
+    if (trainingStep(instance.input, instance.output)) {
+      size = element + 1;
+      break;
+    }
   } // end for element
-  trerr = trerr / (real(dataset.getTrSetSize()));
-  tracc = tracc / (real(dataset.getTrSetSize()));
+  exhausted = isOverBudget(true);
+  trerr = trerr / (real(size));
+  tracc = tracc / (real(size));
   return;
 } // End method training
 
+/**
+ * Method trainingStream
+ *
+ * Come il metodo training, ma il training set viene letto blocco per blocco
+ * dall'oggetto DatasetStream impostato (vedere setDataStream).
+ */
+void Trainer::trainingStream() {
+  // azzerra le variabili
+  trerr = 0.0;
+  tracc = 0.0;
+  unsigned long long size = 0;
+  bool over = false;
+  Dataset block;
+  stream->rewind();
+  while (!over && stream->next(block, false)) {
+    for (uint element = 0; element < block.getSize(); ++element) {
+      const Dataset::Instance instance = block[element];
+      // esegue l'algoritmo su un elemento del blocco
+      ++size;
+      over = trainingStep(instance.input, instance.output);
+      if (over) break;
+    } // end for element
+  } // end while
+  exhausted = isOverBudget(true);
+  if (size > 0) {
+    trerr = trerr / (real(size));
+    tracc = tracc / (real(size));
+  }
+  return;
+} // End method trainingStream
+
+/**
+ * Method trainingPrefetched
+ *
+ * Come il metodo training (o trainingStream), ma le istanze del training set
+ * vengono lette dai batch preparati in un thread separato (vedere il metodo
+ * setPrefetch), nello stesso ordine.
+ */
+void Trainer::trainingPrefetched() {
+  // azzerra le variabili
+  trerr = 0.0;
+  tracc = 0.0;
+  unsigned long long size = 0;
+  bool over = false;
+  Prefetcher::Batch batch;
+  if (stream != NULL) {
+    stream->rewind();
+    prefetcher->start(*stream);
+  }
+  else prefetcher->start(dataset);
+  while (!over && prefetcher->next(batch)) {
+    for (uint element = 0; element < batch.size; ++element) {
+      // esegue l'algoritmo su un elemento del batch
+      ++size;
+      over = trainingStep(batch.input(element), batch.output(element));
+      if (over) break;
+    } // end for element
+  } // end while
+  prefetcher->stop();
+  exhausted = isOverBudget(true);
+  if (size > 0) {
+    trerr = trerr / (real(size));
+    tracc = tracc / (real(size));
+  }
+  return;
+} // End method trainingPrefetched
+
+/**
+ * Method trainingBuffered
+ *
+ * Come il metodo training, ma le istanze del training set vengono lette in
+ * sequenza da una copia contigua del training set nell'ordine corrente
+ * (vedere il metodo setEpochBuffer), ricostruita quando l'ordine cambia.
+ */
+void Trainer::trainingBuffered() {
+  if (!epochready) {
+    dataset.gatherTrainingSet(epochinputs, epochoutputs,
+        std::max(1u, std::thread::hardware_concurrency()));
+    epochready = true;
+  }
+  // azzerra le variabili
+  trerr = 0.0;
+  tracc = 0.0;
+  const uint nin = dataset.getNumberOfInputs();
+  const uint nout = dataset.getNumberOfOutputs();
+  uint size = dataset.getTrSetSize();
+  for (uint element = 0; element < size; ++element) {
+    const Dataset::Values input(&epochinputs[0] + std::size_t(element) * nin,
+        nin);
+    const Dataset::Values output(&epochoutputs[0] + std::size_t(element) *
+        nout, nout);
+    // esegue l'algoritmo su un elemento del training set
+    if (trainingStep(input, output)) {
+      size = element + 1;
+      break;
+    }
+  } // end for element
+  exhausted = isOverBudget(true);
+  trerr = trerr / (real(size));
+  tracc = tracc / (real(size));
+  return;
+} // End method trainingBuffered
+
+/**
+ * Method trainingStep
+ *
+ * Applica l'algoritmo di training su un'istanza (inputs e outputs passati) e
+ * aggiunge il suo errore e la sua accuracy a trerr e tracc. Restituisce true
+ * se e` stato esaurito il budget (l'epoca va troncata).
+ */
+bool Trainer::trainingStep(const Dataset::Values& input,
+    const Dataset::Values& output) {
+  const real* in = input.data(inbuffer);
+  algorithm->compute(in, output.data());
+  // calcola i nuovi errori
+  model->setInputs(in);
+  model->compute();
+  trerr += modelError(model->getOutputs(), output);
+  tracc += modelHit(model->getOutputs(), output);
+  // conta l'istanza utilizzata
+  ++samples;
+  return isOverBudget(false);
+} // End method trainingStep
+
 /**
  * Method validation
  *
- * Esegue la validazione sulla partizione del dataset impostata.
+ * Esegue la validazione della rete net (il modello o una copia dei suoi pesi)
+ * sulla partizione del dataset impostata (o sul sottoinsieme estratto, se
+ * vasampled e` true, vedere sampleValidation).
  * Aggiorna i valori delle seguenti variabili con gli errori di validation:
  *   - vaerr : errore quadratico medio di validation
  *   - vaacc : accuracy (percentuale) sul dataset di validation
  */
-void Trainer::validation() {
+void Trainer::validation(NeuralNetwork* net) {
+  if (vasampled) {
+    sampleValidation(net);
+    return;
+  }
+  if (stream != NULL) {
+    validationStream(net);
+    return;
+  }
   // azzera le variabili
   vaerr = 0.0;
   vaacc = 0.0;
+  vaerrci = 0.0;
+  vaaccci = 0.0;
   // se il validation set e` vuoto non fa nulla
   if (dataset.getVaSetSize() == 0) return;
   // per ogni elemento della partizione
+  std::vector<real> row;
   for (uint element = 0; element < dataset.getVaSetSize(); ++element) {
-    model->setInputs(dataset.vaAt(element).input);
-    model->compute();
-    vaerr += modelError(model->getOutputs(), dataset.vaAt(element).output);
-    vaacc += modelHit(model->getOutputs(), dataset.vaAt(element).output);
+    const Dataset::Instance instance = dataset.vaAt(element);
+    net->setInputs(instance.input.data(row));
+    net->compute();
+    vaerr += modelError(net->getOutputs(), instance.output);
+    vaacc += modelHit(net->getOutputs(), instance.output);
   }
   vaerr = vaerr / real(dataset.getVaSetSize());
   vaacc = vaacc / real(dataset.getVaSetSize());
   return;
 } // End method validation
 
+/**
+ * Method validationStream
+ *
+ * Come il metodo validation, ma il validation set viene letto blocco per
+ * blocco dall'oggetto DatasetStream impostato (vedere setDataStream).
+ */
+void Trainer::validationStream(NeuralNetwork* net) {
+  // azzera le variabili
+  vaerr = 0.0;
+  vaacc = 0.0;
+  vaerrci = 0.0;
+  vaaccci = 0.0;
+  if (!hasValidationSet()) return;
+  unsigned long long size = 0;
+  Dataset block;
+  std::vector<real> row;
+  stream->rewind();
+  while (stream->next(block, true)) {
+    for (uint element = 0; element < block.getSize(); ++element) {
+      const Dataset::Instance instance = block[element];
+      net->setInputs(instance.input.data(row));
+      net->compute();
+      vaerr += modelError(net->getOutputs(), instance.output);
+      vaacc += modelHit(net->getOutputs(), instance.output);
+    }
+    size += block.getSize();
+  }
+  if (size > 0) {
+    vaerr = vaerr / real(size);
+    vaacc = vaacc / real(size);
+  }
+  return;
+} // End method validationStream
+
+/**
+ * Method shuffleTrainingSet
+ *
+ * Crea un ordine casuale delle istanze del training set (dei blocchi e delle
+ * istanze in ogni blocco, se il dataset e` letto a blocchi o se e` impostato
+ * il riordinamento a blocchi, vedere setBlockShuffle).
+ */
+void Trainer::shuffleTrainingSet() {
+  if (stream != NULL) stream->shuffle(random);
+  else dataset.randomShuffleTrainingSet(random, blockrows);
+  epochready = false;
+  return;
+} // End method shuffleTrainingSet
+
+/**
+ * Method hasValidationSet
+ *
+ * Restituisce true se c'e` un validation set (il dataset e` diviso in piu`
+ * folds e il validation set non e` vuoto).
+ */
+bool Trainer::hasValidationSet() const {
+  if (stream != NULL) return stream->getFolds() > 1;
+  return dataset.getVaSetSize() > 0;
+} // End method hasValidationSet
+
+/**
+ * Method sampleValidation
+ *
+ * Esegue la validazione della rete net sul sottoinsieme stratificato del
+ * validation set (vedere makeValidationSample). Per ogni strato h, con N(h)
+ * istanze nel validation set di cui n(h) nel sottoinsieme, vengono calcolate
+ * la media m(h) e la varianza campionaria s(h)^2 di errore e accuracy; la
+ * stima su tutto il validation set (di N istanze) e la sua varianza sono
+ *   m := Sum( W(h) m(h) ) ,   V := Sum( W(h)^2 (1-n(h)/N(h)) s(h)^2/n(h) )
+ * con W(h) = N(h)/N. Aggiorna vaerr e vaacc con le stime e vaerrci e vaaccci
+ * con la semiampiezza dell'intervallo di confidenza al 95% (1.96 sqrt(V)).
+ */
+void Trainer::sampleValidation(NeuralNetwork* net) {
+  real size = dataset.getVaSetSize();
+  real errvar = 0.0, accvar = 0.0;
+  vaerr = 0.0;
+  vaacc = 0.0;
+  uint begin = 0;
+  std::vector<real> row;
+  for (uint h = 0; h < vastrata.size(); h += 2) {
+    uint end = vastrata[h];
+    real n = end - begin;
+    real w = vastrata[h+1] / size;
+    real errsum = 0.0, errsq = 0.0, hits = 0.0;
+    for (uint i = begin; i < end; ++i) {
+      const Dataset::Instance instance = dataset.vaAt(vasample[i]);
+      net->setInputs(instance.input.data(row));
+      net->compute();
+      real err = modelError(net->getOutputs(), instance.output);
+      errsum += err;
+      errsq += err * err;
+      hits += modelHit(net->getOutputs(), instance.output);
+    }
+    vaerr += w * errsum / n;
+    vaacc += w * hits / n;
+    if (n > 1) {
+      real f = w * w * (1 - n / vastrata[h+1]) / (n * (n - 1));
+      errvar += f * (errsq - errsum * errsum / n);
+      accvar += f * (hits - hits * hits / n);
+    }
+    begin = end;
+  } // end for h
+  vaerrci = 1.96 * sqrt(std::max(errvar, real(0)));
+  vaaccci = 1.96 * sqrt(std::max(accvar, real(0)));
+  return;
+} // End method sampleValidation
+
+/**
+ * Method makeValidationSample
+ *
+ * Estrae il sottoinsieme del validation set su cui fare validation (vedere
+ * setValidationSample). Le istanze vengono divise in strati in base agli
+ * outputs (sopra o sotto la soglia); da ogni strato di N(h) istanze ne vengono
+ * estratte in modo casuale max(1, round(size N(h) / N)). Gli indici estratti
+ * sono salvati (ordinati per strato) in vasample, mentre in vastrata vengono
+ * salvati per ogni strato l'indice di fine in vasample e il valore N(h).
+ */
+void Trainer::makeValidationSample() {
+  vasample.clear();
+  vastrata.clear();
+  uint size = dataset.getVaSetSize();
+  if (vasize == 0 || vasize >= size) return;
+  // divide il validation set in strati
+  std::map< std::vector<bool>, std::vector<uint> > strata;
+  for (uint i = 0; i < size; ++i) {
+    const Dataset::Values output = dataset.vaAt(i).output;
+    std::vector<bool> key(output.size());
+    for (uint j = 0; j < output.size(); ++j) key[j] = output[j] > threshold;
+    strata[key].push_back(i);
+  }
+  // estrae le istanze da ogni strato
+  std::map< std::vector<bool>, std::vector<uint> >::iterator it;
+  for (it = strata.begin(); it != strata.end(); ++it) {
+    std::vector<uint>& stratum = it->second;
+    uint n = uint(real(vasize) * stratum.size() / size + 0.5);
+    n = std::min(std::max(n, uint(1)), uint(stratum.size()));
+    for (uint i = 0; i < n; ++i) {
+      std::swap( stratum[i], stratum[i + random.uniform(stratum.size()-i)] );
+      vasample.push_back(stratum[i]);
+    }
+    std::sort(vasample.end() - n, vasample.end());
+    vastrata.push_back(vasample.size());
+    vastrata.push_back(stratum.size());
+  }
+  return;
+} // End method makeValidationSample
+
+/**
+ * Method scheduleValidation
+ *
+ * Stabilisce la validation da eseguire nell'epoca corrente, dove lastepoch e`
+ * l'epoca (esclusa) a cui si ferma il training (vedere il metodo run):
+ * vadone e` true se la validation va eseguita (ogni vaepochs epoche e
+ * nell'ultima), vasampled e` true se va eseguita sul sottoinsieme (tranne che
+ * nell'ultima epoca).
+ */
+inline
+void Trainer::scheduleValidation(uint lastepoch) {
+  bool last = (epochs + 1 == lastepoch);
+  vadone = last || (epochs + 1) % vaepochs == 0;
+  vasampled = vadone && !last && !vasample.empty();
+  return;
+} // End method scheduleValidation
+
+/**
+ * Method completeValidation
+ *
+ * Se e` stato raggiunto un criterio di stop in un'epoca senza validation
+ * completa, esegue la validation sull'intero validation set della rete net
+ * (con i pesi dell'epoca corrente) e aggiorna le variabili globali.
+ */
+inline
+void Trainer::completeValidation(NeuralNetwork* net) {
+  if (!stopped || (vadone && !vasampled)) return;
+  vadone = true;
+  vasampled = false;
+  validation(net);
+  updateTrainingVariables(net);
+  return;
+} // End method completeValidation
+
 /**
  * Method modelError
  *
@@ -449,7 +1415,7 @@ void Trainer::validation() {
  */
 inline
 real Trainer::modelError(const std::vector<real>& mout,
-    const std::vector<real>& dsout) const {
+    const Dataset::Values& dsout) const {
   assert(mout.size() == dsout.size());
   real error = 0.0;
   for (uint i = 0; i < mout.size(); ++i)
@@ -470,7 +1436,7 @@ real Trainer::modelError(const std::vector<real>& mout,
  */
 inline
 uint Trainer::modelHit(const std::vector<real>& mout,
-    const std::vector<real>& dsout) const {
+    const Dataset::Values& dsout) const {
   assert(mout.size() == dsout.size());
   for (uint i = 0; i < mout.size(); ++i)
     if ( ((dsout[i] > threshold) && (mout[i] <= threshold)) ||
@@ -508,31 +1474,67 @@ void Trainer::resetTrainingVariables() {
  * Aggiorna le seguenti variabili globali al termine di ogni epoca della
  * procedura di training (vedere il metodo start):
  *   - mintrerr
- *   - minvaerr
+ *   - minvaerr (e i pesi del modello migliore, copiati dalla rete current)
+ * (i risultati di validation solo se e` stata eseguita la validation).
  *   - maxtracc
  *   - maxvaacc
+ * I valori di validation vengono presi solo dalla validation sull'intero
+ * validation set: se la validation e` stata eseguita sul sottoinsieme (vedere
+ * setValidationSample) e la stima migliora l'errore minimo o l'accuratezza
+ * massima, la rete current viene prima validata sull'intero validation set
+ * (vedere confirmValidation). Le stime restano nei risultati dell'epoca.
  */
 inline
-void Trainer::updateTrainingVariables() {
+void Trainer::updateTrainingVariables(NeuralNetwork* current) {
   if (trerr < mintrerr.first) {
     mintrerr.first = trerr;
     mintrerr.second = epochs;
   }
-  if (vaerr < minvaerr.first) {
-    minvaerr.first = vaerr;
-    minvaerr.second = epochs;
-  }
   if (tracc > maxtracc.first) {
     maxtracc.first = tracc;
     maxtracc.second = epochs;
   }
-  if (vaacc > maxvaacc.first) {
-    maxvaacc.first = vaacc;
+  if (!vadone) return;
+  real err = vaerr, acc = vaacc;
+  if (vasampled) {
+    if (vaerr >= minvaerr.first && vaacc <= maxvaacc.first) return;
+    confirmValidation(current, err, acc);
+  }
+  if (err < minvaerr.first) {
+    minvaerr.first = err;
+    minvaerr.second = epochs;
+    if (hasValidationSet()) bestmodel->copyWeights(*current);
+  }
+  if (acc > maxvaacc.first) {
+    maxvaacc.first = acc;
     maxvaacc.second = epochs;
   }
   return;
 } // End method updateTrainingVariables
 
+/**
+ * Method confirmValidation
+ *
+ * Esegue la validation della rete net sull'intero validation set e ne
+ * restituisce errore e accuratezza in err e acc, lasciando invariati i
+ * risultati della validation sul sottoinsieme (vaerr, vaacc e gli intervalli
+ * di confidenza) che vengono salvati nei risultati dell'epoca.
+ */
+void Trainer::confirmValidation(NeuralNetwork* net, real& err, real& acc) {
+  const real sampleerr = vaerr, sampleacc = vaacc;
+  const real sampleerrci = vaerrci, sampleaccci = vaaccci;
+  vasampled = false;
+  validation(net);
+  err = vaerr;
+  acc = vaacc;
+  vasampled = true;
+  vaerr = sampleerr;
+  vaacc = sampleacc;
+  vaerrci = sampleerrci;
+  vaaccci = sampleaccci;
+  return;
+} // End method confirmValidation
+
 /**
  * Method checkStop
  *
@@ -551,10 +1553,48 @@ bool Trainer::checkStop() {
   if (tracc >= stopacc) return true;
   // controlla la variazione di errore
   if (checkStopErrorChange()) return true;
+  // e` stato esaurito il budget di tempo o di istanze
+  if (exhausted) return true;
+  // l'errore di validation non migliora da patience epoche
+  if ( patience != 0 && hasValidationSet() &&
+       epochs - minvaerr.second >= patience ) return true;
   // nessuna soglia di stop e` stata raggiunta
   return false;
 } // End method checkStop
 
+/**
+ * Method checkInterruption
+ *
+ * Al termine di un'epoca salva lo stato del training nel checkpoint (se
+ * impostato) quando e` richiesto: ogni chkepochs epoche, alla richiesta di
+ * terminazione o al raggiungimento di un criterio di stop. Restituisce true se
+ * il training deve terminare (criterio di stop o terminazione richiesta).
+ */
+inline
+bool Trainer::checkInterruption() {
+  bool terminate = Global::isTerminationRequested();
+  if ( checkpoint != NULL && ( terminate ||
+       (chkepochs != 0 && epochs % chkepochs == 0) || stopped ) )
+    saveCheckpoint();
+  interrupted = terminate && !stopped;
+  return stopped || interrupted;
+} // End method checkInterruption
+
+/**
+ * Method isOverBudget
+ *
+ * Restituisce true se e` stato esaurito il budget di istanze o di tempo della
+ * sessione di training. Per limitare il costo del controllo, il tempo viene
+ * letto solo ogni 64 istanze (o sempre, se force e` true).
+ */
+inline
+bool Trainer::isOverBudget(bool force) const {
+  if (maxsamples != 0 && samples >= maxsamples) return true;
+  if ( maxtime > 0 && (force || samples % 64 == 0) &&
+       getSessionTime() >= maxtime ) return true;
+  return false;
+} // End method isOverBudget
+
 /**
  * Method checkStopErrorChange
  *
@@ -579,23 +1619,37 @@ bool Trainer::checkStopErrorChange() {
  *
  * Appende una riga nel file "resfile" con il seguente formato:
  *   epochs, trerr, vaerr, tracc, vaacc
- * prendendo i valori dalle relative variabili
+ * prendendo i valori dalle relative variabili (con i campi di validation vuoti
+ * se in questa epoca non e` stata eseguita; vedere setSaveResults per i campi
+ * degli intervalli di confidenza). Il file resta aperto per tutto il training
+ * (vedere la classe ResultWriter) e la riga viene scritta subito su disco,
+ * in modo che il file sia aggiornato anche se il training viene interrotto.
  */
-void Trainer::saveEpochResults() const {
+void Trainer::saveEpochResults() {
   if (resfile.empty()) return;
-  std::ofstream ofs;
-  // modifica il formato di stampa per i numeri floating point
-  std::streamsize prprec = ofs.precision(5);
-  std::ios::fmtflags prflag =
-      ofs.setf(std::ios::scientific, std::ios::floatfield);
-  // apre il file e aggiunge una riga con i risultati
-  ofs.open(resfile.c_str(),  std::ios::out | std::ios::app);
-  if (!ofs.is_open()) throw file_error("In Trainer::saveEpochResults");
-  ofs <<(epochs+1) <<"," <<trerr <<"," <<vaerr <<"," <<tracc <<"," <<vaacc;
-  ofs <<std::endl;
-  ofs.close();
-  // ripristina il formato stampa
-  ofs.precision(prprec);
-  ofs.setf(prflag, std::ios::floatfield);
+  results <<(epochs+1) <<',' <<trerr <<',';
+  if (vadone) results <<vaerr;
+  results <<',' <<tracc <<',';
+  if (vadone) results <<vaacc;
+  if (vasize != 0) {
+    results <<',';
+    if (vadone) results <<vaerrci;
+    results <<',';
+    if (vadone) results <<vaaccci;
+  }
+  results.endLine();
+  results.flush();
   return;
 } // End method saveEpochResults
+
+/**
+ * Method saveCheckpoint
+ *
+ * Scrive lo stato corrente del training nel checkpoint impostato (vedere
+ * setCheckpoint) e lo salva su file.
+ */
+void Trainer::saveCheckpoint() {
+  saveState(*checkpoint);
+  checkpoint->save(chkfile);
+  return;
+} // End method saveCheckpoint
@@ -3,10 +3,16 @@
 
 #include <string>
 #include <vector>
+#include <ctime>
+#include <sys/time.h>
 #include "global.h"
 #include "neuralnetwork.h"
 #include "backpropagation.h"
 #include "dataset.h"
+#include "datasetstream.h"
+#include "prefetcher.h"
+#include "checkpoint.h"
+#include "resultwriter.h"
 
 typedef Global::uint uint;
 typedef Global::real real;
@@ -29,8 +35,43 @@ typedef Global::real real;
  * saranno nulli.
  * E` possibile impostare piu` di un criterio di stop dove interrompere la
  * procedura di training (numero massimo di epoche, errore minimo, ecc.).
+ * Con il metodo setInitialModel il training (di ogni fold) parte dai pesi di
+ * una rete gia` addestrata invece che da pesi casuali, eventualmente con lo
+ * stato dell'algoritmo (momentum) impostato con setInitialMomentum.
+ * Durante il training vengono mantenuti (in una copia del modello allocata
+ * alla costruzione) i pesi dell'epoca con il minimo errore di validation,
+ * accessibili con il metodo getBestModel.
  * Con il metodo start si avvia il training; una volta terminato il training si
- * possono leggere i risultati finali con gli appositi metodi.
+ * possono leggere i risultati finali con gli appositi metodi. Con il metodo
+ * resume si puo` proseguire il training per un numero limitato di epoche
+ * (senza ripartire da zero), ad esempio per allocare gradualmente le epoche tra
+ * piu` configurazioni (vedere la classe Scheduler).
+ * Con il metodo setCheckpoint il trainer salva periodicamente su file il
+ * proprio stato (vedere la classe Checkpoint) che puo` essere ripristinato con
+ * il metodo loadState per riprendere il training esattamente da dove era
+ * arrivato.
+ * Con il metodo setPipelinedValidation la validation di ogni epoca viene
+ * eseguita in un thread separato, in parallelo al training dell'epoca
+ * successiva. Con i metodi setValidationEpochs e setValidationSample si puo`
+ * ridurre il costo della validation, eseguendola solo ogni n epoche o su un
+ * sottoinsieme del validation set (con un intervallo di confidenza); la
+ * validation completa viene comunque eseguita nell'ultima epoca.
+ * Con il metodo setDataStream il training viene fatto leggendo il dataset a
+ * blocchi da un oggetto DatasetStream, invece che dal dataset in memoria, per
+ * dataset piu` grandi della memoria disponibile. Con il metodo setPrefetch le
+ * istanze del training set vengono copiate in batch contigui da un thread
+ * separato (vedere la classe Prefetcher) durante il training. Con il metodo
+ * setEpochBuffer il training set viene copiato, nell'ordine dell'epoca, in
+ * matrici contigue lette in sequenza, e con il metodo setBlockShuffle viene
+ * riordinato a blocchi di istanze vicine in memoria.
+ * I numeri casuali utilizzati durante il training (ordine delle istanze e
+ * sottoinsieme per la validation) sono generati da una sottosequenza propria
+ * del trainer (vedere il metodo setRandStream), per cui i risultati di ogni
+ * fold o configurazione non dipendono da quelli eseguiti prima.
+ * Con i metodi setMaxTime e setMaxSamples si puo` limitare il tempo o il
+ * numero di istanze utilizzate per il training: il budget viene controllato
+ * durante l'epoca e, una volta esaurito, il training si ferma (il modello
+ * migliore trovato fino a quel momento resta disponibile con getBestModel).
  */
 class Trainer
 {
@@ -39,6 +80,12 @@ class Trainer
     virtual ~Trainer ( );
 
     void setDataSet ( const std::string& file );
+    void setDataSet ( const Dataset& dataset );
+    void setDataStream ( DatasetStream* stream );
+    void setPrefetch ( uint batchsize );
+    void setRandStream ( unsigned long long k );
+    void setEpochBuffer ( bool enable );
+    void setBlockShuffle ( uint rows );
     void setFolds ( uint n );
     void setValidationOn ( uint k );
     void setMaxEpochs ( uint value );
@@ -46,10 +93,23 @@ class Trainer
     void setStopError ( real error );
     void setStopErrorChange ( float variation, uint epochs );
     void setStopAccuracy ( real accuracy );
+    void setStopValidation ( uint patience );
+    void setMaxTime ( double seconds );
+    void setMaxSamples ( unsigned long long n );
     void setThreshold ( real threshold );
-    void setSaveResults ( const std::string& file );
+    void setPipelinedValidation ( bool enable );
+    void setValidationEpochs ( uint n );
+    void setValidationSample ( uint size );
+    void setSaveResults ( const std::string& file, bool append = false );
+    void setCheckpoint ( Checkpoint* checkpoint, const std::string& file,
+        uint epochs );
+    void setInitialModel ( const NeuralNetwork& init );
+    void setInitialMomentum ( const std::vector<real>& momentum );
     void resetModel ( );
+    const NeuralNetwork& getModel ( ) const;
+    const NeuralNetwork& getBestModel ( ) const;
     uint getEpochs ( ) const;
+    unsigned long long getSamples ( ) const;
     real getTrainingError ( ) const;
     real getValidationError ( ) const;
     real getTrainingAccuracy ( ) const;
@@ -61,13 +121,33 @@ class Trainer
     uint getFolds ( ) const;
     uint getFoldDimension ( uint i ) const;
     uint getDatasetDimension ( ) const;
+    const Dataset& getDataSet ( ) const;
+    bool isStopped ( ) const;
+    bool isInterrupted ( ) const;
+    bool isExhausted ( ) const;
+    double getSessionTime ( ) const;
+    double getSessionCpuTime ( ) const;
+    void saveState ( Checkpoint& checkpoint ) const;
+    void loadState ( const Checkpoint& checkpoint );
     void start ( );
+    void resume ( uint nepochs );
 
   private:
     NeuralNetwork* model;
     NeuralNetwork* initmodel;
+    NeuralNetwork* bestmodel;
+    NeuralNetwork* vamodel;
     BackPropagation* algorithm;
+    std::vector<real> initmomentum;
     Dataset dataset;
+    DatasetStream* stream;
+    Prefetcher* prefetcher;
+    Random random;
+    unsigned long long rstream;
+    bool epochbuffer, epochready;
+    std::vector<real> epochinputs, epochoutputs; // training set ordinato
+    std::vector<real> inbuffer; // inputs convertiti (dataset compresso)
+    uint blockrows;
     uint epochs, maxepochs, shfepochs;
     real vaerr, trerr, stoperr;
     real vaacc, tracc, stopacc;
@@ -76,19 +156,53 @@ class Trainer
     real prevtrerr;
     float stoperrch_var;
     uint stoperrch_ep, stoperrch_n;
+    uint patience;
+    double maxtime, spent, cpuspent;
+    unsigned long long maxsamples, samples;
+    timeval tstart;
+    clock_t cstart;
+    bool exhausted;
+    uint vaepochs, vasize;
+    std::vector<uint> vasample, vastrata;
+    real vaerrci, vaaccci;
+    bool vadone, vasampled;
     std::string resfile;
+    ResultWriter results;
+    bool started, stopped, restored, interrupted;
+    bool pipelined;
+    Checkpoint* checkpoint;
+    std::string chkfile;
+    uint chkepochs;
 
+    void run ( uint lastepoch );
+    void runPipelined ( uint lastepoch );
     void training();
-    void validation();
+    void trainingStream ( );
+    void trainingPrefetched ( );
+    void trainingBuffered ( );
+    bool trainingStep ( const Dataset::Values& input,
+        const Dataset::Values& output );
+    void validation ( NeuralNetwork* net );
+    void validationStream ( NeuralNetwork* net );
+    void shuffleTrainingSet ( );
+    bool hasValidationSet ( ) const;
+    void sampleValidation ( NeuralNetwork* net );
+    void makeValidationSample ( );
+    void scheduleValidation ( uint lastepoch );
+    void completeValidation ( NeuralNetwork* net );
     real modelError ( const std::vector<real>& mout,
-        const std::vector<real>& dsout) const;
+        const Dataset::Values& dsout) const;
     uint modelHit ( const std::vector<real>& mout,
-        const std::vector<real>& dsout) const;
+        const Dataset::Values& dsout) const;
     void resetTrainingVariables ( );
-    void updateTrainingVariables ( );
+    void updateTrainingVariables ( NeuralNetwork* current );
+    void confirmValidation ( NeuralNetwork* net, real& err, real& acc );
     bool checkStop ( );
+    bool checkInterruption ( );
+    bool isOverBudget ( bool force ) const;
     bool checkStopErrorChange ( );
-    void saveEpochResults ( ) const;
+    void saveEpochResults ( );
+    void saveCheckpoint ( );
 
 }; // End class Trainer
 
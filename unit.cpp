@@ -113,6 +113,37 @@ void Unit::setWeights(const std::vector<real>& weights) {
   return;
 } // End method setWeights
 
+/**
+ * Method copyWeights
+ *
+ * Copia i pesi dell'unita` passata, che deve avere lo stesso numero di pesi,
+ * senza allocare memoria.
+ */
+void Unit::copyWeights(const Unit& unit) {
+  if (unit.numberOfWeights != numberOfWeights)
+    throw std::out_of_range("In class Unit");
+  std::copy(unit.weights.begin(), unit.weights.end(), weights.begin());
+  return;
+} // End method copyWeights
+
+/**
+ * Method assign
+ *
+ * Reimposta l'unita` con i nweights pesi (quindi nweights-1 inputs) a partire
+ * da quello puntato da weights, come il metodo read ma senza analisi del
+ * testo (vedere NeuralNetwork::loadFromFile).
+ */
+void Unit::assign(const real* weights, uint nweights) {
+  if (nweights == 0) throw std::invalid_argument("In Unit::assign");
+  numberOfWeights = nweights;
+  numberOfInputs = nweights - 1;
+  this->weights.assign(weights, weights + nweights);
+  inputs.assign(nweights, 0.0);
+  inputs[0] = 1;
+  lastOutput = 0.0;
+  return;
+} // End method assign
+
 /**
  * Method sumToWeight
  *
@@ -281,15 +312,6 @@ real Unit::calcOutput() const {
   return activationFunction(net);
 } // end method calcOutput
 
-/**
- * Method activationFunction()
- *
- * Calcola la funzione di attivazione f(net) = 1/(1 + e^(-net))
- */
-real Unit::activationFunction(real net) const {
-  return 1 / ( 1 + exp(-net*1) );
-} // end method activation
-
 // =================
 // RELATED FUNCTIONS
 // =================
@@ -4,6 +4,7 @@
 #include <ostream>
 #include <string>
 #include <vector>
+#include <cmath>
 #include "global.h"
 
 typedef Global::uint uint;
@@ -13,7 +14,8 @@ typedef Global::real real;
  * Class Unit
  *
  * Rappresenta un'unita` di una rete neurale con le seguenti caratteristiche:
- *   - Funzione di attivazione f(x) = 1/(1 + e^(-x))
+ *   - Funzione di attivazione f(x) = 1/(1 + e^(-x)) (metodo statico
+ *     activationFunction, utilizzato anche dalla classe Ensemble)
  *   - Output y = f(net), dove net e` la combinazione lineare degli input
  *     impostati, pesati con i pesi dell'unita`
  *   - Un numero arbitrario di input (passato nel costruttore dell'oggetto)
@@ -41,6 +43,8 @@ class Unit
     void setInputs ( const std::vector<real>& inputs );
     void setWeight ( uint i, real weight );
     void setWeights ( const std::vector<real>& weights );
+    void copyWeights ( const Unit& unit );
+    void assign ( const real* weights, uint nweights );
     void sumToWeight ( uint i, real value );
     real getLastInput ( uint i ) const;
     real getLastOutput ( ) const;
@@ -48,6 +52,7 @@ class Unit
     uint getNumberOfWeights ( ) const;
     real getWeight ( uint i ) const;
     real computeOutput ( );
+    static real activationFunction ( real net );
     const Unit& write ( std::ostream& os ) const;
     Unit& read ( std::istream& is );
 
@@ -61,9 +66,19 @@ class Unit
     void initWeightsRandom();
     static void setRandomValue(real& val);
     real calcOutput() const;
-    real activationFunction(real net) const;
 }; // End class Unit
 
+/**
+ * Method activationFunction
+ *
+ * Calcola la funzione di attivazione f(net) = 1/(1 + e^(-net)). E` definito
+ * nell'header perche` venga espanso inline nei cicli di NeuralNetwork ed
+ * Ensemble, che devono calcolare gli stessi outputs.
+ */
+inline real Unit::activationFunction(real net) {
+  return 1 / ( 1 + exp(-net*1) );
+} // End method activationFunction
+
 std::ostream& operator<<(std::ostream&, const Unit&);
 std::istream& operator>>(std::istream&, Unit&);
 